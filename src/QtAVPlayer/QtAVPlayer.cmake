@@ -43,6 +43,17 @@ set(QtAVPlayer_PRIVATE_HEADERS
     ${QT_AVPLAYER_DIR}/qavstreamframe_p.h
     ${QT_AVPLAYER_DIR}/qavframe_p.h
     ${QT_AVPLAYER_DIR}/qavpacketqueue_p.h
+    ${QT_AVPLAYER_DIR}/qavringbuffer_p.h
+    ${QT_AVPLAYER_DIR}/qavframecache_p.h
+    ${QT_AVPLAYER_DIR}/qavscheduler_p.h
+    ${QT_AVPLAYER_DIR}/qavmetrics_p.h
+    ${QT_AVPLAYER_DIR}/qavfreelist_p.h
+    ${QT_AVPLAYER_DIR}/qavguardedpointer_p.h
+    ${QT_AVPLAYER_DIR}/qavframepool_p.h
+    ${QT_AVPLAYER_DIR}/qavswscache_p.h
+    ${QT_AVPLAYER_DIR}/qavpcmring_p.h
+    ${QT_AVPLAYER_DIR}/qavaudiotempo_p.h
+    ${QT_AVPLAYER_DIR}/qavaudiomixer_p.h
     ${QT_AVPLAYER_DIR}/qavvideobuffer_p.h
     ${QT_AVPLAYER_DIR}/qavvideobuffer_cpu_p.h
     ${QT_AVPLAYER_DIR}/qavvideobuffer_gpu_p.h
@@ -80,6 +91,13 @@ set(QtAVPlayer_PUBLIC_HEADERS
     ${QT_AVPLAYER_DIR}/qavmuxerframes.h
     ${QT_AVPLAYER_DIR}/qavsubtitletextparser.h
     ${QT_AVPLAYER_DIR}/qavchapter.h
+    ${QT_AVPLAYER_DIR}/qavbufferingpolicy.h
+    ${QT_AVPLAYER_DIR}/qavcodecthreading.h
+    ${QT_AVPLAYER_DIR}/qavplaylist.h
+    ${QT_AVPLAYER_DIR}/qavplayermetrics.h
+    ${QT_AVPLAYER_DIR}/qavclock.h
+    ${QT_AVPLAYER_DIR}/qavframesink.h
+    ${QT_AVPLAYER_DIR}/qavframepool.h
 )
 
 set(QtAVPlayer_SOURCES
@@ -118,6 +136,14 @@ set(QtAVPlayer_SOURCES
     ${QT_AVPLAYER_DIR}/qavformatcontext.cpp
     ${QT_AVPLAYER_DIR}/qavhwdevice_cuda.cpp
     ${QT_AVPLAYER_DIR}/qavchapter.cpp
+    ${QT_AVPLAYER_DIR}/qavbufferingpolicy.cpp
+    ${QT_AVPLAYER_DIR}/qavscheduler.cpp
+    ${QT_AVPLAYER_DIR}/qavplaylist.cpp
+    ${QT_AVPLAYER_DIR}/qavplayermetrics.cpp
+    ${QT_AVPLAYER_DIR}/qavframepool.cpp
+    ${QT_AVPLAYER_DIR}/qavswscache.cpp
+    ${QT_AVPLAYER_DIR}/qavaudiotempo.cpp
+    ${QT_AVPLAYER_DIR}/qavaudiomixer.cpp
 )
 
 if(WIN32)
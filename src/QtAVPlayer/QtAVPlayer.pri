@@ -16,6 +16,17 @@ PRIVATE_HEADERS += \
     $$PWD/qavstreamframe_p.h \
     $$PWD/qavframe_p.h \
     $$PWD/qavpacketqueue_p.h \
+    $$PWD/qavringbuffer_p.h \
+    $$PWD/qavframecache_p.h \
+    $$PWD/qavscheduler_p.h \
+    $$PWD/qavmetrics_p.h \
+    $$PWD/qavfreelist_p.h \
+    $$PWD/qavguardedpointer_p.h \
+    $$PWD/qavframepool_p.h \
+    $$PWD/qavswscache_p.h \
+    $$PWD/qavpcmring_p.h \
+    $$PWD/qavaudiotempo_p.h \
+    $$PWD/qavaudiomixer_p.h \
     $$PWD/qavvideobuffer_p.h \
     $$PWD/qavvideobuffer_cpu_p.h \
     $$PWD/qavvideobuffer_gpu_p.h \
@@ -52,6 +63,13 @@ PUBLIC_HEADERS += \
     $$PWD/qavmuxerframes.h \
     $$PWD/qavsubtitletextparser.h \
     $$PWD/qavchapter.h \
+    $$PWD/qavbufferingpolicy.h \
+    $$PWD/qavcodecthreading.h \
+    $$PWD/qavplaylist.h \
+    $$PWD/qavplayermetrics.h \
+    $$PWD/qavclock.h \
+    $$PWD/qavframesink.h \
+    $$PWD/qavframepool.h \
 
 SOURCES += \
     $$PWD/qavplayer.cpp \
@@ -89,6 +107,14 @@ SOURCES += \
     $$PWD/qavformatcontext.cpp \
     $$PWD/qavhwdevice_cuda.cpp \
     $$PWD/qavchapter.cpp \
+    $$PWD/qavbufferingpolicy.cpp \
+    $$PWD/qavscheduler.cpp \
+    $$PWD/qavplaylist.cpp \
+    $$PWD/qavplayermetrics.cpp \
+    $$PWD/qavframepool.cpp \
+    $$PWD/qavswscache.cpp \
+    $$PWD/qavaudiotempo.cpp \
+    $$PWD/qavaudiomixer.cpp \
 
 contains(DEFINES, QT_AVPLAYER_MULTIMEDIA) {
     QT += multimedia
@@ -7,7 +7,9 @@
 
 #include "qavaudiocodec_p.h"
 #include "qavcodec_p_p.h"
+#include "qavaudioconverter_p.h"
 #include <QDebug>
+#include <QMutex>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -15,11 +17,27 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
+class QAVAudioCodecPrivate : public QAVCodecPrivate
+{
+public:
+    // Shared by the frames of the stream, so the resampler is not created for each frame
+    QMutex mutex;
+    QAVAudioConverter converter;
+};
+
 QAVAudioCodec::QAVAudioCodec(const AVCodec *codec)
+    : QAVFrameCodec(*new QAVAudioCodecPrivate)
 {
     setCodec(codec);
 }
 
+QByteArray QAVAudioCodec::data(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat) const
+{
+    auto d = static_cast<QAVAudioCodecPrivate *>(d_ptr.get());
+    QMutexLocker locker(&d->mutex);
+    return d->converter.data(frame, outputFormat);
+}
+
 QAVAudioFormat QAVAudioCodec::audioFormat() const
 {
     Q_D(const QAVCodec);
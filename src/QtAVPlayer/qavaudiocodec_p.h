@@ -21,6 +21,7 @@
 
 #include "qavframecodec_p.h"
 #include "qavaudioformat.h"
+#include "qavaudioframe.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -29,6 +30,8 @@ class Q_AVPLAYER_EXPORT QAVAudioCodec : public QAVFrameCodec
 public:
     QAVAudioCodec(const AVCodec *codec = nullptr);
     QAVAudioFormat audioFormat() const;
+    // Converts the frames of this stream with the same resampler
+    QByteArray data(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat) const;
 
 private:
     Q_DISABLE_COPY(QAVAudioCodec)
@@ -8,6 +8,7 @@
 #include "qavaudioconverter_p.h"
 #include "qavcodec_p.h"
 #include <QDebug>
+#include <cmath>
 
 extern "C" {
 #include <libswresample/swresample.h>
@@ -19,145 +20,257 @@ QT_BEGIN_NAMESPACE
 class QAVAudioConverterPrivate
 {
 public:
+    ~QAVAudioConverterPrivate()
+    {
+        swr_free(&swr_ctx);
+#if LIBAVUTIL_VERSION_INT > AV_VERSION_INT(57, 23, 0)
+        av_channel_layout_uninit(&inChannelLayout);
+#endif
+    }
+
+    // Returns 1 if the frame needs to be converted by swr_ctx, 0 if the data could be used as is
+    int prepare(const QAVAudioFrame &audioFrame, const QAVAudioFormat &outputFormat);
+    // Drops the samples kept by the resampler if the frame does not follow the previous one
+    int follow(const QAVAudioFrame &audioFrame);
+
     SwrContext *swr_ctx = nullptr;
 #if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
     int64_t outChannelLayout = 0;
+    int64_t inChannelLayout = 0;
 #else
-    AVChannelLayout outChannelLayout;
+    AVChannelLayout outChannelLayout = {};
+    AVChannelLayout inChannelLayout = {};
 #endif
     AVSampleFormat outFormat = AV_SAMPLE_FMT_NONE;
     int outSampleRate = 0;
+    int inFormat = AV_SAMPLE_FMT_NONE;
+    int inSampleRate = 0;
+    // Expected pts of the next converted frame
+    double nextPts = NAN;
 
-    uint8_t *audioBuf = nullptr;
+    // Returned by data() and reused if the caller does not keep it
+    QByteArray buffer;
+    quint64 allocations = 0;
 };
 
-QAVAudioConverter::QAVAudioConverter()
-    : d_ptr(new QAVAudioConverterPrivate)
-{
-}
-
-QAVAudioConverter::~QAVAudioConverter()
+static AVSampleFormat sampleFormat(QAVAudioFormat::SampleFormat format)
 {
-    Q_D(QAVAudioConverter);
-    swr_free(&d->swr_ctx);
-    av_freep(&d->audioBuf);
+    switch (format) {
+    case QAVAudioFormat::UInt8:
+        return AV_SAMPLE_FMT_U8;
+    case QAVAudioFormat::Int16:
+        return AV_SAMPLE_FMT_S16;
+    case QAVAudioFormat::Int32:
+        return AV_SAMPLE_FMT_S32;
+    case QAVAudioFormat::Float:
+        return AV_SAMPLE_FMT_FLT;
+    default:
+        return AV_SAMPLE_FMT_NONE;
+    }
 }
 
-QByteArray QAVAudioConverter::data(const QAVAudioFrame &audioFrame, const QAVAudioFormat &outputFormat)
+int QAVAudioConverterPrivate::prepare(const QAVAudioFrame &audioFrame, const QAVAudioFormat &outputFormat)
 {
-    Q_D(QAVAudioConverter);
     const auto frame = audioFrame.frame();
     if (!frame || !outputFormat)
-        return {};
+        return AVERROR(EINVAL);
 
-    QByteArray audioData;
-    AVSampleFormat outFormat = AV_SAMPLE_FMT_NONE;
-#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
-    int64_t outChannelLayout = av_get_default_channel_layout(outputFormat.channelCount());
-#else
-    AVChannelLayout outChannelLayout;
-    av_channel_layout_default(&outChannelLayout, outputFormat.channelCount());
-#endif
-    int outSampleRate = outputFormat.sampleRate();
-
-    switch (outputFormat.sampleFormat()) {
-    case QAVAudioFormat::UInt8:
-        outFormat = AV_SAMPLE_FMT_U8;
-        break;
-    case QAVAudioFormat::Int16:
-        outFormat = AV_SAMPLE_FMT_S16;
-        break;
-    case QAVAudioFormat::Int32:
-        outFormat = AV_SAMPLE_FMT_S32;
-        break;
-    case QAVAudioFormat::Float:
-        outFormat = AV_SAMPLE_FMT_FLT;
-        break;
-    default:
+    const AVSampleFormat format = sampleFormat(outputFormat.sampleFormat());
+    if (format == AV_SAMPLE_FMT_NONE) {
         qWarning() << "Could not negotiate output format:" << outputFormat.sampleFormat();
-        return {};
+        return AVERROR(EINVAL);
     }
+    const int sampleRate = outputFormat.sampleRate();
 
 #if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
-    int64_t channelLayout = (frame->channel_layout && frame->channels == av_get_channel_layout_nb_channels(frame->channel_layout))
+    int64_t channelLayout = av_get_default_channel_layout(outputFormat.channelCount());
+    int64_t frameChannelLayout = (frame->channel_layout && frame->channels == av_get_channel_layout_nb_channels(frame->channel_layout))
         ? frame->channel_layout
         : av_get_default_channel_layout(frame->channels);
-    bool needsConvert = frame->format != outFormat || channelLayout != outChannelLayout || frame->sample_rate != d->outSampleRate;
+    bool needsConvert = frame->format != format || frameChannelLayout != channelLayout || frame->sample_rate != sampleRate;
 #else
-    AVChannelLayout channelLayout = frame->ch_layout;
-    bool needsConvert = frame->format != outFormat || av_channel_layout_compare(&channelLayout, &outChannelLayout) || frame->sample_rate != outSampleRate;
+    AVChannelLayout channelLayout;
+    av_channel_layout_default(&channelLayout, outputFormat.channelCount());
+    const AVChannelLayout &frameChannelLayout = frame->ch_layout;
+    bool needsConvert = frame->format != format || av_channel_layout_compare(&frameChannelLayout, &channelLayout) || frame->sample_rate != sampleRate;
 #endif
 
     // Convert int24 bit frames even if format is AV_SAMPLE_FMT_S32
     auto codec = audioFrame.stream().codec();
-    if (codec && codec->codec() && codec->codec()->id == AV_CODEC_ID_PCM_S24BE) {
+    if (codec && codec->codec() && codec->codec()->id == AV_CODEC_ID_PCM_S24BE)
         needsConvert = true;
-    }
 
-    if (needsConvert) {
-        bool needsCtxChange = outFormat != d->outFormat || outSampleRate != d->outSampleRate ||
+    if (!needsConvert)
+        return 0;
+
+    // The resampler is kept while the input and output are the same
+    const bool changed = !swr_ctx || format != outFormat || sampleRate != outSampleRate
+        || frame->format != inFormat || frame->sample_rate != inSampleRate ||
 #if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
-            outChannelLayout != d->outChannelLayout;
+        channelLayout != outChannelLayout || frameChannelLayout != inChannelLayout;
 #else
-            av_channel_layout_compare(&outChannelLayout, &d->outChannelLayout);
+        av_channel_layout_compare(&channelLayout, &outChannelLayout) || av_channel_layout_compare(&frameChannelLayout, &inChannelLayout);
 #endif
-        if (needsCtxChange || !d->swr_ctx) {
-            swr_free(&d->swr_ctx);
+    if (!changed)
+        return 1;
+
+    swr_free(&swr_ctx);
 #if LIBSWRESAMPLE_VERSION_INT <= AV_VERSION_INT(4, 4, 0)
-            d->swr_ctx = swr_alloc_set_opts(nullptr,
-                                            outChannelLayout, outFormat, outSampleRate,
-                                            channelLayout, AVSampleFormat(frame->format), frame->sample_rate,
-                                            0, nullptr);
+    swr_ctx = swr_alloc_set_opts(nullptr,
+                                 channelLayout, format, sampleRate,
+                                 frameChannelLayout, AVSampleFormat(frame->format), frame->sample_rate,
+                                 0, nullptr);
 #else
-            swr_alloc_set_opts2(&d->swr_ctx,
-                                &outChannelLayout, outFormat, outSampleRate,
-                                &channelLayout, AVSampleFormat(frame->format), frame->sample_rate,
-                                0, nullptr);
+    swr_alloc_set_opts2(&swr_ctx,
+                        &channelLayout, format, sampleRate,
+                        &frameChannelLayout, AVSampleFormat(frame->format), frame->sample_rate,
+                        0, nullptr);
 #endif
-            int ret = swr_init(d->swr_ctx);
-            if (!d->swr_ctx || ret < 0) {
-                qWarning() << "Could not init SwrContext:" << ret;
-                return {};
-            }
-            d->outChannelLayout = outChannelLayout;
-            d->outFormat = outFormat;
-            d->outSampleRate = outSampleRate;
-        }
+    ++allocations;
+    int ret = swr_ctx ? swr_init(swr_ctx) : AVERROR(ENOMEM);
+    if (ret < 0) {
+        qWarning() << "Could not init SwrContext:" << ret;
+        swr_free(&swr_ctx);
+        return ret;
     }
+    outChannelLayout = channelLayout;
+    outFormat = format;
+    outSampleRate = sampleRate;
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+    inChannelLayout = frameChannelLayout;
+#else
+    av_channel_layout_uninit(&inChannelLayout);
+    av_channel_layout_copy(&inChannelLayout, &frameChannelLayout);
+#endif
+    inFormat = frame->format;
+    inSampleRate = frame->sample_rate;
+    nextPts = NAN;
+    return 1;
+}
 
-    if (d->swr_ctx) {
-        const uint8_t **in = (const uint8_t **)frame->extended_data;
-        int outCount = (int64_t)frame->nb_samples * outSampleRate / frame->sample_rate + 256;
-        int outSize = av_samples_get_buffer_size(nullptr, outputFormat.channelCount(), outCount, outFormat, 0);
-
-        av_freep(&d->audioBuf);
-        uint8_t **out = &d->audioBuf;
-        unsigned bufSize = 0;
-        av_fast_malloc(&d->audioBuf, &bufSize, outSize);
+int QAVAudioConverterPrivate::follow(const QAVAudioFrame &audioFrame)
+{
+    const auto frame = audioFrame.frame();
+    const double pts = audioFrame.pts();
+    double duration = audioFrame.duration();
+    if (duration <= 0 && frame->sample_rate > 0)
+        duration = double(frame->nb_samples) / frame->sample_rate;
+    // Repeated, reordered or seeked frames would get the delayed samples of other frames
+    const bool follows = std::isnan(pts) || std::isnan(nextPts) || std::abs(pts - nextPts) <= duration / 2;
+    nextPts = std::isnan(pts) ? NAN : pts + duration;
+    if (follows)
+        return 0;
 
-        int samples = swr_convert(d->swr_ctx, out, outCount, in, frame->nb_samples);
-        if (samples < 0) {
-            qWarning() << "Could not convert audio samples";
-            return {};
-        }
+    const int ret = swr_init(swr_ctx);
+    if (ret < 0) {
+        qWarning() << "Could not reset SwrContext:" << ret;
+        swr_free(&swr_ctx);
+    }
+    return ret;
+}
 
-        int size = samples * outputFormat.channelCount() * av_get_bytes_per_sample(outFormat);
-        // Make deep copy
-        audioData = QByteArray((const char *)d->audioBuf, size);
-    } else {
-        int size = av_samples_get_buffer_size(nullptr,
+static int frameBytes(const AVFrame *frame)
+{
+    return av_samples_get_buffer_size(nullptr,
 #if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
-                                              frame->channels,
+                                      frame->channels,
 #else
-                                              outChannelLayout.nb_channels,
+                                      frame->ch_layout.nb_channels,
 #endif
-                                              frame->nb_samples,
-                                              AVSampleFormat(frame->format), 1);
-        // Return data from the frame
-        audioData = QByteArray::fromRawData((const char *)frame->data[0], size);
+                                      frame->nb_samples,
+                                      AVSampleFormat(frame->format), 1);
+}
+
+QAVAudioConverter::QAVAudioConverter()
+    : d_ptr(new QAVAudioConverterPrivate)
+{
+}
+
+QAVAudioConverter::~QAVAudioConverter() = default;
+
+QByteArray QAVAudioConverter::data(const QAVAudioFrame &audioFrame, const QAVAudioFormat &outputFormat)
+{
+    Q_D(QAVAudioConverter);
+    const int ret = d->prepare(audioFrame, outputFormat);
+    if (ret < 0)
+        return {};
+
+    const auto frame = audioFrame.frame();
+    // Return data from the frame
+    if (ret == 0)
+        return QByteArray::fromRawData((const char *)frame->data[0], frameBytes(frame));
+    if (d->follow(audioFrame) < 0)
+        return {};
+
+    const int bytesPerFrame = outputFormat.channelCount() * av_get_bytes_per_sample(d->outFormat);
+    const int outCount = swr_get_out_samples(d->swr_ctx, frame->nb_samples);
+    const int outSize = outCount * bytesPerFrame;
+    // Reallocated only if the caller still keeps previous data or more space is needed
+    if (!d->buffer.isDetached() || d->buffer.capacity() < outSize) {
+        d->buffer = QByteArray();
+        d->buffer.reserve(outSize);
+        ++d->allocations;
+    }
+    d->buffer.resize(outSize);
+
+    const uint8_t **in = (const uint8_t **)frame->extended_data;
+    uint8_t *out = reinterpret_cast<uint8_t *>(d->buffer.data());
+    int samples = swr_convert(d->swr_ctx, &out, outCount, in, frame->nb_samples);
+    if (samples < 0) {
+        qWarning() << "Could not convert audio samples";
+        return {};
+    }
+
+    d->buffer.resize(samples * bytesPerFrame);
+    return d->buffer;
+}
+
+int QAVAudioConverter::convertedSize(const QAVAudioFrame &audioFrame, const QAVAudioFormat &outputFormat)
+{
+    Q_D(QAVAudioConverter);
+    const int ret = d->prepare(audioFrame, outputFormat);
+    if (ret <= 0)
+        return ret < 0 ? ret : frameBytes(audioFrame.frame());
+
+    const int bytesPerFrame = outputFormat.channelCount() * av_get_bytes_per_sample(d->outFormat);
+    return swr_get_out_samples(d->swr_ctx, audioFrame.frame()->nb_samples) * bytesPerFrame;
+}
+
+int QAVAudioConverter::convert(const QAVAudioFrame &audioFrame, const QAVAudioFormat &outputFormat, uchar *out, int size)
+{
+    Q_D(QAVAudioConverter);
+    const int ret = d->prepare(audioFrame, outputFormat);
+    if (ret < 0)
+        return ret;
+
+    const auto frame = audioFrame.frame();
+    if (ret == 0) {
+        const int bytes = frameBytes(frame);
+        if (bytes > size) {
+            qWarning() << "Could not fit audio samples:" << bytes << ">" << size;
+            return AVERROR(ENOSPC);
+        }
+        memcpy(out, frame->data[0], size_t(bytes));
+        return bytes;
     }
+    const int err = d->follow(audioFrame);
+    if (err < 0)
+        return err;
 
-    return audioData;
+    const int bytesPerFrame = outputFormat.channelCount() * av_get_bytes_per_sample(d->outFormat);
+    const uint8_t **in = (const uint8_t **)frame->extended_data;
+    int samples = swr_convert(d->swr_ctx, &out, size / bytesPerFrame, in, frame->nb_samples);
+    if (samples < 0) {
+        qWarning() << "Could not convert audio samples";
+        return samples;
+    }
+    return samples * bytesPerFrame;
+}
+
+quint64 QAVAudioConverter::allocations() const
+{
+    Q_D(const QAVAudioConverter);
+    return d->allocations;
 }
 
 double QAVAudioConverter::seconds(const QAVAudioFormat &outputFormat, quint64 bytes)
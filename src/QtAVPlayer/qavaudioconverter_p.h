@@ -33,6 +33,19 @@ public:
     // Converts audio data to outputFormat if the frame is in different format
     QByteArray data(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat);
 
+    // Max bytes convert() could write for the frame, negative on error
+    int convertedSize(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat);
+    /**
+     * Writes converted audio data to the memory of the caller without allocations,
+     * returns written bytes or negative on error.
+     * The samples which do not fit are kept by the resampler for the next frame,
+     * and dropped if the next frame does not follow this one by pts.
+     */
+    int convert(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat, uchar *out, int size);
+
+    // How many times the resampler or the buffer were allocated
+    quint64 allocations() const;
+
     // Returns seconds in bytes based on format
     static double seconds(const QAVAudioFormat &outputFormat, quint64 bytes);
 
@@ -7,68 +7,63 @@
 
 #include "qavaudioframe.h"
 #include "qavaudioconverter_p.h"
-#include "qavframe_p.h"
 #include "qavaudiocodec_p.h"
+#include "qavframe_p.h"
 #include <QDebug>
 
 QT_BEGIN_NAMESPACE
 
-class QAVAudioFramePrivate : public QAVFramePrivate
-{
-public:
-    QAVAudioFormat outAudioFormat;
-    QByteArray data;
-};
-
 QAVAudioFrame::QAVAudioFrame()
-    : QAVFrame(*new QAVAudioFramePrivate)
+    : QAVFrame()
 {
 }
 
 QAVAudioFrame::QAVAudioFrame(const QAVFrame &other)
-    : QAVFrame(*new QAVAudioFramePrivate)
+    : QAVFrame(other)
 {
-    operator=(other);
 }
 
 QAVAudioFrame::QAVAudioFrame(const QAVAudioFrame &other)
-    : QAVFrame(*new QAVAudioFramePrivate)
+    : QAVFrame(other)
+{
+}
+
+QAVAudioFrame::QAVAudioFrame(QAVAudioFrame &&other) noexcept
+    : QAVFrame(std::move(other))
 {
-    operator=(other);
 }
 
 QAVAudioFrame::QAVAudioFrame(const QAVAudioFormat &format, const QByteArray &data)
     : QAVAudioFrame()
 {
-    Q_D(QAVAudioFrame);
-    d->outAudioFormat = format;
-    d->data = data;
+    Q_D(QAVFrame);
+    d->audioFormat = format;
+    d->audioData = data;
 }
 
 QAVAudioFrame &QAVAudioFrame::operator=(const QAVFrame &other)
 {
-    Q_D(QAVAudioFrame);
     QAVFrame::operator=(other);
-    d->data.clear();
-
     return *this;
 }
 
 QAVAudioFrame &QAVAudioFrame::operator=(const QAVAudioFrame &other)
 {
-    Q_D(QAVAudioFrame);
     QAVFrame::operator=(other);
-    auto rhs = reinterpret_cast<QAVAudioFramePrivate *>(other.d_ptr.get());
-    d->outAudioFormat = rhs->outAudioFormat;
-    d->data = rhs->data;
+    return *this;
+}
 
+QAVAudioFrame &QAVAudioFrame::operator=(QAVAudioFrame &&other) noexcept
+{
+    QAVFrame::operator=(std::move(other));
     return *this;
 }
 
 QAVAudioFrame::operator bool() const
 {
-    Q_D(const QAVAudioFrame);
-    return (d->outAudioFormat &&!d->data.isEmpty()) || QAVFrame::operator bool();
+    Q_D(const QAVFrame);
+    QMutexLocker locker(&d->audioMutex);
+    return (d->audioFormat && !d->audioData.isEmpty()) || QAVFrame::operator bool();
 }
 
 static const QAVAudioCodec *audioCodec(const QAVCodec *c)
@@ -78,14 +73,18 @@ static const QAVAudioCodec *audioCodec(const QAVCodec *c)
 
 QAVAudioFormat QAVAudioFrame::format() const
 {
-    Q_D(const QAVAudioFrame);
-    if (d->outAudioFormat)
-        return d->outAudioFormat;
+    Q_D(const QAVFrame);
+    {
+        QMutexLocker locker(&d->audioMutex);
+        if (d->audioFormat)
+            return d->audioFormat;
+    }
 
-    if (!d->stream)
+    const auto s = stream();
+    if (!s)
         return {};
 
-    auto c = audioCodec(d->stream.codec().data());
+    auto c = audioCodec(s.codec().data());
     if (!c)
         return {};
 
@@ -94,12 +93,20 @@ QAVAudioFormat QAVAudioFrame::format() const
 
 QByteArray QAVAudioFrame::data() const
 {
-    auto d = const_cast<QAVAudioFramePrivate *>(reinterpret_cast<QAVAudioFramePrivate *>(d_ptr.get()));
-    if (d->data.isEmpty()) {
-        d->outAudioFormat = format();
-        d->data = QAVAudioConverter().data(*this, format());
+    // Cached in the shared data, so the copies of the frame are converted once
+    auto d = const_cast<QAVFramePrivate *>(d_func());
+    const auto fmt = format();
+    QMutexLocker locker(&d->audioMutex);
+    if (d->audioData.isEmpty()) {
+        const auto s = stream();
+        auto c = s ? audioCodec(s.codec().data()) : nullptr;
+        const auto data = c ? c->data(*this, fmt) : QAVAudioConverter().data(*this, fmt);
+        if (!data.isEmpty()) {
+            d->audioFormat = fmt;
+            d->audioData = data;
+        }
     }
-    return d->data;
+    return d->audioData;
 }
 
 QT_END_NAMESPACE
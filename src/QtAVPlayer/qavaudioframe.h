@@ -14,23 +14,21 @@
 QT_BEGIN_NAMESPACE
 
 class QAVAudioCodec;
-class QAVAudioFramePrivate;
 class Q_AVPLAYER_EXPORT QAVAudioFrame : public QAVFrame
 {
 public:
     QAVAudioFrame();
     QAVAudioFrame(const QAVFrame &other);
     QAVAudioFrame(const QAVAudioFrame &other);
+    QAVAudioFrame(QAVAudioFrame &&other) noexcept;
     QAVAudioFrame(const QAVAudioFormat &format, const QByteArray &data);
     QAVAudioFrame &operator=(const QAVFrame &other);
     QAVAudioFrame &operator=(const QAVAudioFrame &other);
+    QAVAudioFrame &operator=(QAVAudioFrame &&other) noexcept;
     operator bool() const;
 
     QAVAudioFormat format() const;
     QByteArray data() const;
-
-private:
-    Q_DECLARE_PRIVATE(QAVAudioFrame)
 };
 
 Q_DECLARE_METATYPE(QAVAudioFrame)
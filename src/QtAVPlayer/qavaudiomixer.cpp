@@ -0,0 +1,285 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavaudiomixer_p.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define QAV_MIX_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QAV_MIX_NEON
+#endif
+
+QT_BEGIN_NAMESPACE
+
+QAVAudioMixer::QAVAudioMixer() = default;
+QAVAudioMixer::~QAVAudioMixer() = default;
+
+void QAVAudioMixer::setFormat(int sampleRate, int channelCount)
+{
+    if (m_format.sampleRate() == sampleRate && m_format.channelCount() == channelCount)
+        return;
+    m_format.setSampleFormat(QAVAudioFormat::Float);
+    m_format.setSampleRate(sampleRate);
+    m_format.setChannelCount(channelCount);
+    clear();
+}
+
+QAVAudioFormat QAVAudioMixer::format() const
+{
+    return m_format;
+}
+
+QAVAudioMixer::Input &QAVAudioMixer::input(int id)
+{
+    Input &in = m_inputs[id];
+    if (!in.conv)
+        in.conv.reset(new QAVAudioConverter);
+    return in;
+}
+
+void QAVAudioMixer::setGain(int input, float gain)
+{
+    this->input(input).gain = gain;
+}
+
+float QAVAudioMixer::gain(int input) const
+{
+    auto it = m_inputs.find(input);
+    return it != m_inputs.end() ? it->second.gain : 1.0f;
+}
+
+void QAVAudioMixer::setPan(int input, float pan)
+{
+    this->input(input).pan = qBound(-1.0f, pan, 1.0f);
+}
+
+float QAVAudioMixer::pan(int input) const
+{
+    auto it = m_inputs.find(input);
+    return it != m_inputs.end() ? it->second.pan : 0.0f;
+}
+
+void QAVAudioMixer::removeInput(int input)
+{
+    m_inputs.erase(input);
+}
+
+QList<int> QAVAudioMixer::inputs() const
+{
+    QList<int> ids;
+    for (const auto &it : m_inputs)
+        ids.push_back(it.first);
+    return ids;
+}
+
+void QAVAudioMixer::setMaxDelay(int ms)
+{
+    m_maxDelay = qMax(0, ms);
+}
+
+void QAVAudioMixer::clear()
+{
+    for (auto &it : m_inputs) {
+        Input &in = it.second;
+        // The resampler keeps the samples of the previous frames
+        in.conv.reset(new QAVAudioConverter);
+        in.samples.clear();
+        in.start = 0;
+        in.offset = 0;
+        in.hasTimeline = false;
+        in.hasData = false;
+    }
+    m_position = 0;
+    m_offset = 0;
+    m_hasTimeline = false;
+}
+
+bool QAVAudioMixer::write(int id, const QAVAudioFrame &frame)
+{
+    if (!m_format)
+        return false;
+    Input &in = input(id);
+    const int size = in.conv->convertedSize(frame, m_format);
+    if (size <= 0)
+        return false;
+    const size_t floats = size_t(size) / sizeof(float) + 1;
+    if (m_converted.size() < floats)
+        m_converted.resize(floats);
+    const int bytes = in.conv->convert(frame, m_format, reinterpret_cast<uchar *>(m_converted.data()), size);
+    if (bytes < 0)
+        return false;
+    const int count = bytes / int(sizeof(float)) / m_format.channelCount();
+    if (count > 0)
+        place(in, frame.pts(), m_converted.data(), count);
+    return true;
+}
+
+void QAVAudioMixer::place(Input &in, double pts, const float *data, int count)
+{
+    const int channels = m_format.channelCount();
+    const int rate = m_format.sampleRate();
+    const qint64 end = in.hasData ? in.end(channels) : m_position;
+    qint64 pos = end;
+    if (!std::isnan(pts)) {
+        const qint64 ptsSamples = llrint(pts * rate);
+        if (!m_hasTimeline) {
+            m_offset = m_position - ptsSamples;
+            m_hasTimeline = true;
+        }
+        if (!in.hasTimeline) {
+            in.offset = m_offset;
+            in.hasTimeline = true;
+        }
+        pos = ptsSamples + in.offset;
+        // After seeks or if the input uses another timeline, continues from its current position
+        const qint64 delay = qint64(m_maxDelay) * rate / 1000;
+        const qint64 next = qMax(end, m_position);
+        if (pos < m_position - delay || pos > next + 5 * qint64(rate)) {
+            in.offset = next - ptsSamples;
+            pos = next;
+        }
+        // Rounding of pts and the delay of the resampler should not produce gaps or clicks
+        if (in.hasData && qAbs(pos - end) <= rate / 500)
+            pos = end;
+    }
+
+    // The samples behind the mixed position are too late
+    if (pos < m_position) {
+        const qint64 late = m_position - pos;
+        if (late >= count)
+            return;
+        data += late * channels;
+        count -= int(late);
+        pos = m_position;
+    }
+
+    if (in.samples.empty()) {
+        in.start = pos;
+    } else if (pos >= end) {
+        // Silence for the missing samples
+        in.samples.resize(in.samples.size() + size_t((pos - end) * channels), 0.0f);
+    } else {
+        // Replaces the overlapped samples
+        const qint64 keep = qMax<qint64>(0, pos - in.start);
+        in.samples.resize(size_t(keep * channels));
+        if (pos < in.start)
+            in.start = pos;
+    }
+    in.samples.insert(in.samples.end(), data, data + size_t(count) * channels);
+    in.hasData = true;
+}
+
+int QAVAudioMixer::read(std::vector<float> &out)
+{
+    if (!m_format)
+        return 0;
+    const int channels = m_format.channelCount();
+    const qint64 delay = qint64(m_maxDelay) * m_format.sampleRate() / 1000;
+
+    qint64 maxEnd = m_position;
+    for (const auto &it : m_inputs) {
+        if (it.second.hasData)
+            maxEnd = qMax(maxEnd, it.second.end(channels));
+    }
+    // Waits for the inputs which are not too far behind
+    qint64 target = maxEnd;
+    for (const auto &it : m_inputs) {
+        const qint64 end = it.second.end(channels);
+        if (it.second.hasData && maxEnd - end <= delay)
+            target = qMin(target, end);
+    }
+    const qint64 count = target - m_position;
+    if (count <= 0)
+        return 0;
+
+    out.assign(size_t(count * channels), 0.0f);
+    for (auto &it : m_inputs) {
+        Input &in = it.second;
+        if (!in.hasData)
+            continue;
+        const qint64 end = in.end(channels);
+        const qint64 from = qMax(m_position, in.start);
+        const qint64 to = qMin(target, end);
+        if (to > from) {
+            float gains[4] = {in.gain, in.gain, in.gain, in.gain};
+            if (channels == 2) {
+                const float left = in.gain * qMin(1.0f, 1.0f - in.pan);
+                const float right = in.gain * qMin(1.0f, 1.0f + in.pan);
+                gains[0] = gains[2] = left;
+                gains[1] = gains[3] = right;
+            }
+            mix(out.data() + (from - m_position) * channels,
+                in.samples.data() + (from - in.start) * channels,
+                int((to - from) * channels),
+                gains);
+        }
+        const qint64 consumed = qMin(end, target) - in.start;
+        if (consumed > 0) {
+            in.samples.erase(in.samples.begin(), in.samples.begin() + consumed * channels);
+            in.start += consumed;
+        }
+    }
+    m_position = target;
+    return int(count);
+}
+
+void QAVAudioMixer::mix(float *dst, const float *src, int count, const float gains[4])
+{
+    int i = 0;
+#if defined(QAV_MIX_SSE)
+    const __m128 g = _mm_loadu_ps(gains);
+    for (; i + 8 <= count; i += 8) {
+        const __m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        const __m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(dst + i, a);
+        _mm_storeu_ps(dst + i + 4, b);
+    }
+#elif defined(QAV_MIX_NEON)
+    const float32x4_t g = vld1q_f32(gains);
+    for (; i + 8 <= count; i += 8) {
+        vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+        vst1q_f32(dst + i + 4, vmlaq_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), g));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] += src[i] * gains[i % 4];
+}
+
+int QAVAudioMixer::store(const float *src, int count, QAVAudioFormat::SampleFormat format, char *dst)
+{
+    switch (format) {
+    case QAVAudioFormat::Float:
+        memcpy(dst, src, size_t(count) * sizeof(float));
+        return count * int(sizeof(float));
+    case QAVAudioFormat::Int16: {
+        auto out = reinterpret_cast<qint16 *>(dst);
+        for (int i = 0; i < count; ++i)
+            out[i] = qint16(lrintf(qBound(-1.0f, src[i], 1.0f) * 32767.0f));
+        return count * int(sizeof(qint16));
+    }
+    case QAVAudioFormat::Int32: {
+        auto out = reinterpret_cast<qint32 *>(dst);
+        for (int i = 0; i < count; ++i)
+            out[i] = qint32(llrint(double(qBound(-1.0f, src[i], 1.0f)) * 2147483647.0));
+        return count * int(sizeof(qint32));
+    }
+    case QAVAudioFormat::UInt8: {
+        auto out = reinterpret_cast<quint8 *>(dst);
+        for (int i = 0; i < count; ++i)
+            out[i] = quint8(lrintf(qBound(-1.0f, src[i], 1.0f) * 127.0f) + 128);
+        return count;
+    }
+    default:
+        return 0;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,110 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVAUDIOMIXER_P_H
+#define QAVAUDIOMIXER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qavaudioconverter_p.h"
+#include <QtAVPlayer/qavaudioformat.h>
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QList>
+#include <map>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Mixes the audio frames of several inputs, f.e. streams or players, to interleaved float samples.
+ * The frames are placed on one timeline by their pts, so the inputs stay aligned to the sample.
+ * Each input has own gain and pan, the pan is applied to stereo output only.
+ * Not thread safe.
+ */
+class QAVAudioMixer
+{
+public:
+    QAVAudioMixer();
+    ~QAVAudioMixer();
+
+    // Sample rate and channels of the mixed samples, changing them drops the queued samples
+    void setFormat(int sampleRate, int channelCount);
+    QAVAudioFormat format() const;
+
+    // Linear gain, 1.0 by default
+    void setGain(int input, float gain);
+    float gain(int input) const;
+    // From -1.0 (left) to 1.0 (right), 0 by default
+    void setPan(int input, float pan);
+    float pan(int input) const;
+    void removeInput(int input);
+    QList<int> inputs() const;
+
+    /**
+     * How long the mixing waits for an input which is behind the others, 200 ms by default.
+     * The missing samples of the input are mixed as silence then.
+     */
+    void setMaxDelay(int ms);
+
+    // Converts the frame and queues the samples at its pts
+    bool write(int input, const QAVAudioFrame &frame);
+    // Mixes the samples queued for all the inputs, returns the count of the samples per channel
+    int read(std::vector<float> &out);
+    // Drops the queued samples and the timeline
+    void clear();
+
+    // dst[i] += src[i] * gains[i % 4] for count floats
+    static void mix(float *dst, const float *src, int count, const float gains[4]);
+    // Converts the mixed samples to the sample format, returns written bytes
+    static int store(const float *src, int count, QAVAudioFormat::SampleFormat format, char *dst);
+
+private:
+    struct Input
+    {
+        std::unique_ptr<QAVAudioConverter> conv;
+        std::vector<float> samples;
+        // Position of the first queued sample on the timeline
+        qint64 start = 0;
+        // Added to the pts in samples to get the position on the timeline
+        qint64 offset = 0;
+        bool hasTimeline = false;
+        bool hasData = false;
+        float gain = 1.0f;
+        float pan = 0.0f;
+
+        qint64 end(int channels) const { return start + qint64(samples.size()) / channels; }
+    };
+
+    Input &input(int id);
+    void place(Input &in, double pts, const float *data, int count);
+
+    QAVAudioFormat m_format;
+    std::map<int, Input> m_inputs;
+    std::vector<float> m_converted;
+    // Position of the next mixed sample
+    qint64 m_position = 0;
+    // Offset of the timeline set by the first frame with pts
+    qint64 m_offset = 0;
+    bool m_hasTimeline = false;
+    int m_maxDelay = 200;
+
+    Q_DISABLE_COPY(QAVAudioMixer)
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "qavaudiooutput.h"
 #include "qavaudiooutputdevice_p.h"
+#include "qavaudiomixer_p.h"
 #include <QDebug>
 #include <QtConcurrent/qtconcurrentrun.h>
 #include <QFuture>
@@ -119,6 +120,7 @@ public:
     AudioOutput *audioOutput = nullptr;
     qreal volume = 1.0;
     int bufferSize = 0;
+    int latency = 500;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 4, 0)
     QAudioFormat::ChannelConfig channelConfig = QAudioFormat::ChannelConfigUnknown;
 #endif
@@ -139,6 +141,47 @@ public:
     bool resetPending = false;
     mutable QMutex mutex;
 
+    // Format of the mixed frames sent to AudioDevice, set by the first mixed frame
+    QAVAudioFormat mixFormat;
+    QAVAudioMixer mixer;
+    mutable QMutex mixerMutex;
+    std::vector<float> mixed;
+    // The mixed chunks are written to the device without the locks in the order of their tickets,
+    // when the frames are played from several threads
+    quint64 nextTicket = 0;
+    quint64 servingTicket = 0;
+    QMutex ticketMutex;
+    QWaitCondition ticketCond;
+
+    // Returns false if the audio output is being recreated for the frame format,
+    // otherwise replaces the format by the format of the data sent to AudioDevice
+    bool prepare(QAVAudioFormat &frameFormat)
+    {
+        bool reset = false;
+        {
+            QMutexLocker locker(&mutex);
+            // Check if the format has been changed or not yet initialized
+            if (frameInputFormat != frameFormat) {
+                if (resetPending)
+                    return false;
+                frameInputFormat = {};
+                resetPending = true;
+                reset = true;
+            } else {
+                frameFormat = frameOutputFormat;
+            }
+        }
+        if (reset) {
+            device->stop();
+            // Reset the output on QAVAudioOutput's thread
+            qtavplayer_invokeMethod(this, [frameFormat, this] {
+                resetIfNeeded(frameFormat, bufferSize, volume);
+            });
+            return false;
+        }
+        return true;
+    }
+
     void resetIfNeeded(const QAVAudioFormat &frameFormat, int bsize, qreal v)
     {
         QMutexLocker locker(&mutex);
@@ -173,6 +216,7 @@ public:
                 audioOutput->stop();
                 audioOutput->deleteLater();
                 audioOutput = nullptr;
+                device->setSink(nullptr);
             }
             if (audioDevice.isNull() || deviceName.toLower() == QLatin1String("null audio device")) {
                 qDebug() << "Audio device is not supported:" << deviceName;
@@ -194,15 +238,15 @@ public:
             if (bsize > 0)
                 audioOutput->setBufferSize(bsize);
             audioOutput->setVolume(v);
-            // Start sending the audio frames from the queue to render
-            device->start();
             audioOutputFormat = fmt;
             frameInputFormat = frameFormat;
             frameOutputFormat = format(fmt);
+            device->setSink(audioOutput);
+            // Start sending the audio frames from the queue to render
+            device->start(frameOutputFormat, latency);
             resetPending = false;
             locker.unlock();
             // Start the output without the lock to allow to add frames to the device.
-            // This could wait for frames available.
             audioOutput->start(device.get());
         }
     }
@@ -220,6 +264,10 @@ QAVAudioOutput::QAVAudioOutput(QObject *parent)
     d->device.reset(new QAVAudioOutputDevice);
     d->device->open(QIODevice::ReadOnly);
     d->device->moveToThread(d->audioThread.get());
+    // The timer of the device is stopped on its thread
+    QObject::connect(d->audioThread.get(), &QThread::finished, d->device.get(), [device = d->device.get()] {
+        device->setSink(nullptr);
+    }, Qt::DirectConnection);
     d->audioThread->start();
 }
 
@@ -262,6 +310,21 @@ int QAVAudioOutput::bufferSize() const
     return d->bufferSize;
 }
 
+void QAVAudioOutput::setLatency(int ms)
+{
+    Q_D(QAVAudioOutput);
+    QMutexLocker locker(&d->mutex);
+    d->latency = qMax(1, ms);
+    d->frameInputFormat = {};
+}
+
+int QAVAudioOutput::latency() const
+{
+    Q_D(const QAVAudioOutput);
+    QMutexLocker locker(&d->mutex);
+    return d->latency;
+}
+
 void QAVAudioOutput::setAudioDevice(const AudioDevice &device)
 {
     Q_D(QAVAudioOutput);
@@ -301,10 +364,25 @@ QAudioFormat::ChannelConfig QAVAudioOutput::channelConfig() const
 bool QAVAudioOutput::play(const QAVAudioFrame &frame)
 {
     Q_D(QAVAudioOutput);
-    if (!frame) {
-        d->device->flush();
+    if (!frame)
+        return false;
+    if (QThread::currentThread() == d->audioThread.get()) {
+        qCritical() << "QAVAudioOutput::play() must not be called on the audio thread";
         return false;
     }
+    QAVAudioFormat frameFormat = frame.format();
+    if (!frameFormat || !d->prepare(frameFormat))
+        return false;
+    // Add frames on current thread
+    d->device->play(frame, frameFormat);
+    return true;
+}
+
+bool QAVAudioOutput::play(const QAVAudioFrame &frame, int input)
+{
+    Q_D(QAVAudioOutput);
+    if (!frame)
+        return false;
     if (QThread::currentThread() == d->audioThread.get()) {
         qCritical() << "QAVAudioOutput::play() must not be called on the audio thread";
         return false;
@@ -312,38 +390,92 @@ bool QAVAudioOutput::play(const QAVAudioFrame &frame)
     QAVAudioFormat frameFormat = frame.format();
     if (!frameFormat)
         return false;
-    bool reset = false;
     {
         QMutexLocker locker(&d->mutex);
-        // Check if the format has been changed or not yet initialized
-        if (d->frameInputFormat != frameFormat) {
-            if (d->resetPending)
-                return false;
-            d->frameInputFormat = {};
-            d->resetPending = true;
-            reset = true;
-        } else {
-            frameFormat = d->frameOutputFormat;
+        // All the inputs are resampled to one format, so the audio output is not recreated
+        if (!d->mixFormat) {
+            d->mixFormat.setSampleFormat(QAVAudioFormat::Float);
+            d->mixFormat.setSampleRate(frameFormat.sampleRate());
+            d->mixFormat.setChannelCount(frameFormat.channelCount());
         }
+        frameFormat = d->mixFormat;
     }
-    if (reset) {
-        d->device->stop();
-        // Reset the output on QAVAudioOutput's thread
-
-        qtavplayer_invokeMethod(d, [frameFormat, d] {
-            d->resetIfNeeded(frameFormat, d->bufferSize, d->volume);
-        });
+    if (!d->prepare(frameFormat))
         return false;
+
+    static thread_local std::vector<char> mixedBytes;
+    int bytes = 0;
+    quint64 ticket = 0;
+    {
+        QMutexLocker locker(&d->mixerMutex);
+        d->mixer.setFormat(frameFormat.sampleRate(), frameFormat.channelCount());
+        if (!d->mixer.write(input, frame))
+            return false;
+        const int count = d->mixer.read(d->mixed);
+        if (count <= 0)
+            return true;
+        const int samples = count * frameFormat.channelCount();
+        mixedBytes.resize(size_t(samples) * sizeof(float));
+        bytes = QAVAudioMixer::store(d->mixed.data(), samples, frameFormat.sampleFormat(), mixedBytes.data());
+        ticket = d->nextTicket++;
     }
-    // Add frames on current thread
-    d->device->play(frame, frameFormat);
+
+    {
+        QMutexLocker locker(&d->ticketMutex);
+        while (d->servingTicket != ticket)
+            d->ticketCond.wait(&d->ticketMutex);
+    }
+    // Waits for the space in the device, the mixer is not locked meanwhile
+    d->device->enqueue(mixedBytes.data(), size_t(bytes));
+    QMutexLocker locker(&d->ticketMutex);
+    ++d->servingTicket;
+    d->ticketCond.wakeAll();
     return true;
 }
 
+void QAVAudioOutput::setInputGain(int input, qreal gain)
+{
+    Q_D(QAVAudioOutput);
+    QMutexLocker locker(&d->mixerMutex);
+    d->mixer.setGain(input, float(gain));
+}
+
+qreal QAVAudioOutput::inputGain(int input) const
+{
+    Q_D(const QAVAudioOutput);
+    QMutexLocker locker(&d->mixerMutex);
+    return d->mixer.gain(input);
+}
+
+void QAVAudioOutput::setInputPan(int input, qreal pan)
+{
+    Q_D(QAVAudioOutput);
+    QMutexLocker locker(&d->mixerMutex);
+    d->mixer.setPan(input, float(pan));
+}
+
+qreal QAVAudioOutput::inputPan(int input) const
+{
+    Q_D(const QAVAudioOutput);
+    QMutexLocker locker(&d->mixerMutex);
+    return d->mixer.pan(input);
+}
+
+void QAVAudioOutput::removeInput(int input)
+{
+    Q_D(QAVAudioOutput);
+    QMutexLocker locker(&d->mixerMutex);
+    d->mixer.removeInput(input);
+}
+
 void QAVAudioOutput::stop()
 {
     Q_D(QAVAudioOutput);
     d->device->stop();
+    {
+        QMutexLocker locker(&d->mixerMutex);
+        d->mixer.clear();
+    }
     QMutexLocker locker(&d->mutex);
     if (d->audioOutput) {
         qtavplayer_invokeMethod(d, [audioOutput=d->audioOutput] {
@@ -356,6 +488,8 @@ void QAVAudioOutput::clearQueue()
 {
     Q_D(QAVAudioOutput);
     d->device->clear();
+    QMutexLocker locker(&d->mixerMutex);
+    d->mixer.clear();
 }
 
 void QAVAudioOutput::suspend()
@@ -386,4 +520,10 @@ void QAVAudioOutput::resume()
     }
 }
 
+double QAVAudioOutput::time() const
+{
+    Q_D(const QAVAudioOutput);
+    return d->device->time();
+}
+
 QT_END_NAMESPACE
@@ -9,6 +9,7 @@
 #define QAVAUDIOOUTPUT_H
 
 #include <QtAVPlayer/qavaudioframe.h>
+#include <QtAVPlayer/qavclock.h>
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QAudioFormat>
 #include <QObject>
@@ -28,7 +29,12 @@ using AudioDevice = QAudioDeviceInfo;
 QT_BEGIN_NAMESPACE
 
 class QAVAudioOutputPrivate;
-class Q_AVPLAYER_EXPORT QAVAudioOutput : public QObject
+/**
+ * Plays the audio frames on the audio device.
+ * Also the clock of the position actually played by the device,
+ * pass it to QAVPlayer::setAudioDeviceClock() to sync the video with the sound.
+ */
+class Q_AVPLAYER_EXPORT QAVAudioOutput : public QObject, public QAVClock
 {
     Q_OBJECT
 public:
@@ -41,6 +47,13 @@ public:
     void setBufferSize(int bytes);
     int bufferSize() const;
 
+    /**
+     * Max duration of the audio queued to be read by the audio device, 500 ms by default.
+     * play() waits if the queue is full, and silence is played if the queue is empty.
+     */
+    void setLatency(int ms);
+    int latency() const;
+
     /**
      * Sets the audio device used for playback. Pass a default-constructed
      * AudioDevice to resume using the system default output device.
@@ -63,6 +76,24 @@ public:
      */
     bool play(const QAVAudioFrame &frame);
 
+    /**
+     * Mixes the frame with the frames of other inputs and plays the mix on the same audio device,
+     * f.e. several audio streams of one player or several players.
+     * The input is any id chosen by the caller, f.e. index of the stream.
+     * The frames of each input are resampled to one format and aligned by pts.
+     * An input which is behind the others by more than 200 ms is mixed as silence.
+     * Should not be used together with play(frame) on the same output.
+     */
+    bool play(const QAVAudioFrame &frame, int input);
+    // Linear gain of the mixed input, 1.0 by default
+    void setInputGain(int input, qreal gain);
+    qreal inputGain(int input) const;
+    // Stereo balance of the mixed input from -1.0 (left) to 1.0 (right), 0 by default
+    void setInputPan(int input, qreal pan);
+    qreal inputPan(int input) const;
+    // Drops the queued frames and the settings of the input
+    void removeInput(int input);
+
     // Clears playing queue
     void clearQueue();
 
@@ -72,6 +103,14 @@ public:
     // Resumes reading from the queue
     void resume();
 
+    /**
+     * Pts of the audio played by the device: the position processed by the audio output
+     * minus the data queued in it and in the queue, negative if nothing is played yet
+     * or if the frames are mixed.
+     * Does not depend on the buffer size and the latency. Thread safe.
+     */
+    double time() const override;
+
 public Q_SLOTS:
     // No audio should be rendered if stopped even if play() is called
     void stop();
@@ -7,26 +7,203 @@
 
 #include "qavaudiooutputdevice_p.h"
 #include "qavaudioconverter_p.h"
+#include "qavpcmring_p.h"
 #include <QDebug>
 #include <QMutex>
 #include <QWaitCondition>
-#include <QThread>
+#include <QTimer>
+#include <cmath>
+#include <atomic>
+#include <vector>
+
+extern "C" {
+#include <libavutil/time.h>
+}
 
 QT_BEGIN_NAMESPACE
 
+// How often the position played by the sink is taken on the audio thread, in ms
+static const int ClockInterval = 10;
+// How many last chunks returned by readData() are kept to map the played bytes to the ring
+static const int ChunksCount = 64;
+
+// Maps the positions of the ring to pts of the last written frame
+struct QAVAudioClockAnchor
+{
+    bool valid = false;
+    // Position of the first frame after the reset, the earlier bytes are not known
+    quint64 base = 0;
+    quint64 position = 0;
+    double pts = 0;
+    double secondsPerByte = 0;
+};
+
 class QAVAudioOutputDevicePrivate
 {
 public:
-    QList<QByteArray> frames;
-    qint64 offset = 0;
-    quint64 bytes = 0;
-    std::unique_ptr<QAVAudioConverter> conv;
-    mutable QMutex mutex;
-    QWaitCondition cond;
-    bool quit = false;
-    bool flush = false;
+    QAVPcmRing ring;
+    QAVAudioConverter conv;
+    // Used if the converted frame does not fit to the contiguous region of the ring
+    std::vector<char> scratch;
+    // Serializes the producer side, readData() never locks it
+    QMutex writeMutex;
+    // The producer waits for the space, readData() locks it only to wake up the waiting producer
+    QMutex spaceMutex;
+    QWaitCondition spaceCond;
+    std::atomic<bool> writerWaiting{false};
+    std::atomic<bool> quit{true};
+    std::atomic<int> bytesPerSecond{0};
+    std::atomic<quint64> underruns{0};
+
+    // Used only on the audio thread
+    AudioOutput *sink = nullptr;
+    // Takes the position played by the sink, which is not asked from readData()
+    QTimer *clockTimer = nullptr;
+    // Bytes returned by readData() including the silence, and the last returned chunk
+    std::atomic<quint64> sent{0};
+    std::atomic<qint64> lastRead{0};
+
+    // Chunk returned by readData(), written only by readData()
+    struct Chunk
+    {
+        // Offset of the chunk in the sent bytes and its length
+        std::atomic<quint64> sent{0};
+        std::atomic<quint64> len{0};
+        // Position of the first byte in the ring and how many bytes are taken from it, the rest is silence
+        std::atomic<quint64> ring{0};
+        std::atomic<quint64> bytes{0};
+    };
+    Chunk chunks[ChunksCount];
+    std::atomic<quint64> chunksCount{0};
+
+    mutable QMutex clockMutex;
+    QAVAudioClockAnchor anchor;
+    // Position of the ring played by the sink, -1 if not known yet
+    qint64 playedPosition = -1;
+    // Up to where the ring is played without silence from the played position
+    qint64 playedLimit = 0;
+    // When the played position has been taken, in microseconds
+    qint64 playedAt = 0;
+    // The last position returned by time(), it never goes backwards
+    mutable qint64 lastPosition = -1;
+
+    void resetClock()
+    {
+        QMutexLocker locker(&clockMutex);
+        anchor = {};
+        playedPosition = -1;
+        lastPosition = -1;
+    }
+
+    void addChunk(quint64 offset, quint64 len, quint64 ringPosition, quint64 bytes)
+    {
+        const quint64 count = chunksCount;
+        Chunk &c = chunks[count % ChunksCount];
+        c.sent = offset;
+        c.len = len;
+        c.ring = ringPosition;
+        c.bytes = bytes;
+        chunksCount = count + 1;
+    }
+
+    bool ringPosition(quint64 offset, qint64 &position, qint64 &limit) const;
+
+    void wakeWriter()
+    {
+        if (!writerWaiting)
+            return;
+        QMutexLocker locker(&spaceMutex);
+        spaceCond.wakeAll();
+    }
+
+    void updatePlayedPosition();
+    void setProcessed(quint64 bytes);
+    void setAnchor(const QAVAudioFrame &frame, int size);
+    void write(const char *data, size_t size);
 };
 
+static int bytesPerSample(const QAVAudioFormat &format)
+{
+    switch (format.sampleFormat()) {
+    case QAVAudioFormat::UInt8:
+        return 1;
+    case QAVAudioFormat::Int16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+// Maps the offset in the sent bytes to the ring, the silence sent on underruns takes no space in the ring.
+// The limit is the ring position where the next silence starts, the sink plays the ring contiguously up to it.
+bool QAVAudioOutputDevicePrivate::ringPosition(quint64 offset, qint64 &position, qint64 &limit) const
+{
+    const quint64 count = chunksCount;
+    if (count == 0)
+        return false;
+    // The slot which could be written right now is skipped
+    const quint64 first = count >= ChunksCount ? count - ChunksCount + 1 : 0;
+    qint64 newerRing = -1;
+    for (quint64 i = count; i-- > first;) {
+        const Chunk &c = chunks[i % ChunksCount];
+        const qint64 sentOffset = qint64(c.sent.load());
+        const qint64 len = qint64(c.len.load());
+        const qint64 ring = qint64(c.ring.load());
+        const qint64 bytes = qint64(c.bytes.load());
+        // The chunk has been overwritten while it was read
+        if (chunksCount.load() >= i + ChunksCount)
+            return false;
+
+        const qint64 end = ring + bytes;
+        // The ring is played without gaps up to the newer chunk
+        if (bytes < len || newerRing != end)
+            limit = end;
+        newerRing = ring;
+        if (qint64(offset) >= sentOffset || i == first) {
+            position = ring + qBound<qint64>(0, qint64(offset) - sentOffset, bytes);
+            // Nothing is played from the ring while the silence is played
+            if (qint64(offset) - sentOffset >= bytes)
+                limit = position;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Called on the audio thread by the timer, readData() only records the sent chunks
+void QAVAudioOutputDevicePrivate::updatePlayedPosition()
+{
+    const int bps = bytesPerSecond;
+    if (!sink || bps <= 0 || quit)
+        return;
+
+    const qint64 total = qint64(sent.load());
+    const qint64 len = lastRead;
+    if (total <= 0)
+        return;
+    // The sent data which has not been processed by the sink yet
+    const qint64 processed = sink->processedUSecs() * bps / 1000000;
+    qint64 queued = total - processed;
+    // Some backends report the data taken from the device as processed
+    if (queued <= len || queued > total)
+        queued = qMax<qint64>(0, sink->bufferSize() - sink->bytesFree()) + len;
+    setProcessed(quint64(qMax<qint64>(0, total - queued)));
+}
+
+void QAVAudioOutputDevicePrivate::setProcessed(quint64 bytes)
+{
+    qint64 position = 0;
+    qint64 limit = 0;
+    if (!ringPosition(bytes, position, limit))
+        return;
+    // Not beyond the last byte handed out from the ring
+    const qint64 readPosition = qint64(ring.readPosition());
+    QMutexLocker locker(&clockMutex);
+    playedAt = av_gettime_relative();
+    playedPosition = qMin(position, readPosition);
+    playedLimit = qMin(limit, readPosition);
+}
+
 QAVAudioOutputDevice::QAVAudioOutputDevice(QObject *parent)
     : QIODevice(parent)
     , d_ptr(new QAVAudioOutputDevicePrivate)
@@ -41,107 +218,201 @@ QAVAudioOutputDevice::~QAVAudioOutputDevice()
 qint64 QAVAudioOutputDevice::readData(char *data, qint64 len)
 {
     Q_D(QAVAudioOutputDevice);
-    if (!len)
+    if (!len || d->quit.load(std::memory_order_acquire))
         return 0;
-    QMutexLocker locker(&d->mutex);
-    qint64 bytesWritten = 0;
-    while (len && !d->quit) {
-        if (d->frames.isEmpty()) {
-            d->cond.wait(&d->mutex);
-            if (d->quit || d->flush || d->frames.isEmpty()) {
-                d->flush = true;
-                break;
-            }
-        }
-        auto &sampleData = d->frames.front();
-        const int toWrite = qMin(sampleData.size() - d->offset, len);
-        auto src = sampleData.constData() + d->offset;
-        memcpy(data, src, toWrite);
-        bytesWritten += toWrite;
-        data += toWrite;
-        len -= toWrite;
-        d->offset += toWrite;
-        if (d->offset >= sampleData.size()) {
-            d->offset = 0;
-            d->bytes -= sampleData.size();
-            d->frames.removeFirst();
-        }
+    const quint64 ringPosition = d->ring.readPosition();
+    const qint64 bytes = qint64(d->ring.read(data, size_t(len)));
+    if (bytes > 0)
+        d->wakeWriter();
+    if (bytes < len) {
+        // Never waits for the frames, silence is played instead
+        memset(data + bytes, 0, size_t(len - bytes));
+        d->underruns.fetch_add(1, std::memory_order_relaxed);
     }
-    if (d->quit || d->flush) {
-        // Silence for entire buffer
-        memset(data - bytesWritten, 0, static_cast<size_t>(len + bytesWritten));
-        bytesWritten = len + bytesWritten;
-        d->flush = false;
+    d->addChunk(d->sent, quint64(len), ringPosition, quint64(bytes));
+    d->lastRead = len;
+    d->sent += quint64(len);
+    return len;
+}
+
+// Waits for the space until the data is played, cleared or the device is stopped
+void QAVAudioOutputDevicePrivate::write(const char *data, size_t size)
+{
+    size_t written = ring.write(data, size);
+    data += written;
+    size -= written;
+    if (size == 0)
+        return;
+
+    QMutexLocker locker(&spaceMutex);
+    writerWaiting = true;
+    while (size > 0 && !quit) {
+        // Written again with the lock, so the wake up by readData() is not missed
+        written = ring.write(data, size);
+        data += written;
+        size -= written;
+        if (size > 0 && !quit)
+            spaceCond.wait(&spaceMutex);
     }
-    return d->quit ? 0 : bytesWritten;
+    writerWaiting = false;
+}
+
+// Called by the producer before the frame is written to the ring
+void QAVAudioOutputDevicePrivate::setAnchor(const QAVAudioFrame &frame, int size)
+{
+    const double pts = frame.pts();
+    const int bps = bytesPerSecond;
+    if (std::isnan(pts) || bps <= 0)
+        return;
+    // The frames could be played faster or slower than their duration
+    const double duration = frame.duration();
+    QMutexLocker locker(&clockMutex);
+    if (!anchor.valid)
+        anchor.base = ring.writePosition();
+    anchor.valid = true;
+    anchor.position = ring.writePosition();
+    anchor.pts = pts;
+    anchor.secondsPerByte = duration > 0 ? duration / size : 1.0 / bps;
 }
 
 void QAVAudioOutputDevice::play(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat)
 {
     Q_D(QAVAudioOutputDevice);
-    {
-        QMutexLocker locker(&d->mutex);
-        if (!d->conv || d->quit)
-            return;
-        auto data = d->conv->data(frame, outputFormat);
-        d->bytes += data.size();
-        d->frames.push_back(std::move(data));
+    QMutexLocker locker(&d->writeMutex);
+    if (d->quit || !d->ring.capacity())
+        return;
+    const int size = d->conv.convertedSize(frame, outputFormat);
+    if (size <= 0)
+        return;
+    d->setAnchor(frame, size);
+
+    // Converts directly to the ring if possible
+    const size_t bytesPerFrame = size_t(bytesPerSample(outputFormat) * outputFormat.channelCount());
+    size_t region = 0;
+    char *dst = d->ring.writeRegion(region);
+    region -= region % bytesPerFrame;
+    if (region >= size_t(size)) {
+        const int bytes = d->conv.convert(frame, outputFormat, reinterpret_cast<uchar *>(dst), size);
+        if (bytes > 0)
+            d->ring.commit(size_t(bytes));
+        return;
     }
-    d->cond.wakeAll();
+
+    if (d->scratch.size() < size_t(size))
+        d->scratch.resize(size_t(size));
+    const int bytes = d->conv.convert(frame, outputFormat, reinterpret_cast<uchar *>(d->scratch.data()), size);
+    d->write(d->scratch.data(), bytes > 0 ? size_t(bytes) : 0);
 }
 
-void QAVAudioOutputDevice::start()
+void QAVAudioOutputDevice::enqueue(const char *data, size_t size)
 {
     Q_D(QAVAudioOutputDevice);
-    {
-        QMutexLocker locker(&d->mutex);
-        d->quit = false;
-        d->conv = std::make_unique<QAVAudioConverter>();
-    }
-    d->cond.wakeAll();
+    QMutexLocker locker(&d->writeMutex);
+    if (d->quit || !d->ring.capacity())
+        return;
+    // The data has no pts
+    d->resetClock();
+    d->write(data, size);
+}
+
+void QAVAudioOutputDevice::start(const QAVAudioFormat &format, int latencyMs)
+{
+    Q_D(QAVAudioOutputDevice);
+    QMutexLocker locker(&d->writeMutex);
+    const int bytesPerFrame = bytesPerSample(format) * format.channelCount();
+    const int bytesPerSecond = bytesPerFrame * format.sampleRate();
+    // Whole frames fit to the end of the ring
+    const qint64 frames = qMax<qint64>(1, qint64(bytesPerSecond) * latencyMs / 1000 / qMax(1, bytesPerFrame));
+    d->ring.reset(size_t(frames * bytesPerFrame));
+    d->bytesPerSecond = bytesPerSecond;
+    d->sent = 0;
+    d->chunksCount = 0;
+    d->resetClock();
+    d->quit = false;
 }
 
 void QAVAudioOutputDevice::stop()
 {
     Q_D(QAVAudioOutputDevice);
-    {
-        QMutexLocker locker(&d->mutex);
-        d->quit = true;
-        d->conv.reset();
-        d->frames.clear();
-        d->offset = 0;
-        d->bytes = 0;
-    }
-    d->cond.wakeAll();
+    d->quit = true;
+    d->ring.clear();
+    d->resetClock();
+    d->wakeWriter();
 }
 
 void QAVAudioOutputDevice::clear()
 {
     Q_D(QAVAudioOutputDevice);
-    {
-        QMutexLocker locker(&d->mutex);
-        d->frames.clear();
-        d->offset = 0;
-        d->bytes = 0;
-    }
-    d->cond.wakeAll();
+    d->ring.clear();
+    d->resetClock();
+    d->wakeWriter();
 }
 
-void QAVAudioOutputDevice::flush()
+quint64 QAVAudioOutputDevice::bytesInQueue() const
+{
+    Q_D(const QAVAudioOutputDevice);
+    return d->ring.size();
+}
+
+double QAVAudioOutputDevice::queuedDuration() const
+{
+    Q_D(const QAVAudioOutputDevice);
+    const int bytesPerSecond = d->bytesPerSecond;
+    return bytesPerSecond > 0 ? double(d->ring.size()) / bytesPerSecond : 0.0;
+}
+
+quint64 QAVAudioOutputDevice::underruns() const
+{
+    Q_D(const QAVAudioOutputDevice);
+    return d->underruns;
+}
+
+void QAVAudioOutputDevice::setSink(AudioOutput *sink)
 {
     Q_D(QAVAudioOutputDevice);
-    {
-        QMutexLocker locker(&d->mutex);
-        d->flush = true;
+    d->sink = sink;
+    if (!sink) {
+        if (d->clockTimer)
+            d->clockTimer->stop();
+        return;
     }
-    d->cond.wakeAll();
+    if (!d->clockTimer) {
+        d->clockTimer = new QTimer(this);
+        d->clockTimer->setTimerType(Qt::PreciseTimer);
+        d->clockTimer->setInterval(ClockInterval);
+        connect(d->clockTimer, &QTimer::timeout, this, [d] { d->updatePlayedPosition(); });
+    }
+    d->clockTimer->start();
 }
 
-quint64 QAVAudioOutputDevice::bytesInQueue() const
+void QAVAudioOutputDevice::setProcessedBytes(quint64 bytes)
+{
+    Q_D(QAVAudioOutputDevice);
+    d->setProcessed(bytes);
+}
+
+double QAVAudioOutputDevice::time() const
 {
     Q_D(const QAVAudioOutputDevice);
-    QMutexLocker locker(&d->mutex);
-    return d->bytes;
+    const int bps = d->bytesPerSecond;
+    if (bps <= 0 || d->quit)
+        return -1;
+    QMutexLocker locker(&d->clockMutex);
+    const QAVAudioClockAnchor &anchor = d->anchor;
+    const qint64 played = d->playedPosition;
+    if (!anchor.valid || played < 0)
+        return -1;
+
+    // The sink keeps playing between the updates, but not beyond the data sent to it and not the silence
+    const qint64 elapsed = av_gettime_relative() - d->playedAt;
+    qint64 position = played + qMax<qint64>(0, elapsed) * bps / 1000000;
+    position = qMin(position, qMax(played, d->playedLimit));
+    position = qMin(position, qint64(d->ring.readPosition()));
+    position = qMax(position, qint64(anchor.base));
+    // The sink reports the processed data in periods, so the update could be behind the estimated position
+    position = qMax(position, d->lastPosition);
+    d->lastPosition = position;
+    return anchor.pts + double(position - qint64(anchor.position)) * anchor.secondsPerByte;
 }
 
 QT_END_NAMESPACE
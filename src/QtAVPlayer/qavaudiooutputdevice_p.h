@@ -20,6 +20,7 @@
 //
 
 #include <QtAVPlayer/qavaudioframe.h>
+#include <QtAVPlayer/qavaudiooutput.h>
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QIODevice>
 #include <memory>
@@ -41,17 +42,29 @@ public:
     bool isSequential() const override { return false; }
     bool atEnd() const override { return false; }
 
-    // Enqueues the audio frame to be sent from readData()
+    // Converts the audio frame to the ring, waits if the ring is full
     void play(const QAVAudioFrame &frame, const QAVAudioFormat &outputFormat);
-    // Start sending the audio data from readData()
-    void start();
+    // Writes the data in the output format to the ring, waits if the ring is full
+    void enqueue(const char *data, size_t size);
+    // Start sending the audio data from readData(), the ring keeps up to latency of the format
+    void start(const QAVAudioFormat &format, int latencyMs);
     // Don't send the audio data from readData()
     void stop();
     // Clears queue of submitted frames
     void clear();
-    // Returns empty buffer data from readData()
-    void flush();
     quint64 bytesInQueue() const;
+    // Seconds of the queued audio data
+    double queuedDuration() const;
+    // How many times readData() has not had enough data and returned silence
+    quint64 underruns() const;
+
+    // Audio output reading the device, its played position is taken periodically on the audio thread,
+    // must be called on the audio thread
+    void setSink(AudioOutput *sink);
+    // Bytes returned by readData() which have been played, taken from the sink
+    void setProcessedBytes(quint64 bytes);
+    // Pts of the audio played by the audio output, negative if unknown
+    double time() const;
 
 protected:
     std::unique_ptr<QAVAudioOutputDevicePrivate> d_ptr;
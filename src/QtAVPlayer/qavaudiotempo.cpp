@@ -0,0 +1,182 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavaudiotempo_p.h"
+#include "qavaudiofilter_p.h"
+#include "qavfiltergraph_p.h"
+#include "qavaudioframe.h"
+#include <QDebug>
+#include <QStringList>
+#include <cmath>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+#include <libavformat/avformat.h>
+#include <libavutil/mathematics.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+// Gap between the source frames which is treated as a discontinuity of the stream,
+// seeks reset the filters before
+static const double MaxGap = 0.1;
+
+// Older atempo supports only 0.5-2.0 per filter, so bigger changes are split to several stages
+static int stagesCount(qreal speed)
+{
+    return qMax(1, int(std::ceil(std::abs(std::log2(double(speed))) - 1e-9)));
+}
+
+static QString tempoValue(qreal speed, int stages)
+{
+    return QString::number(std::pow(double(speed), 1.0 / stages), 'f', 6);
+}
+
+QAVAudioTempo::QAVAudioTempo() = default;
+QAVAudioTempo::~QAVAudioTempo() = default;
+
+void QAVAudioTempo::reset()
+{
+    m_filter.reset();
+    m_graph.reset();
+    m_format = {};
+    m_speed = 1.0;
+    m_stages = 0;
+    m_nextPts = -1;
+    m_startPts = 0;
+    m_outSamples = 0;
+    m_filterName.clear();
+}
+
+int QAVAudioTempo::init(const QAVFrame &frame, qreal speed)
+{
+    reset();
+    const int stages = stagesCount(speed);
+    QStringList filters;
+    for (int i = 0; i < stages; ++i)
+        filters << QLatin1String("atempo=tempo=") + tempoValue(speed, stages);
+
+    std::unique_ptr<QAVFilterGraph> graph(new QAVFilterGraph);
+    int ret = graph->parse(filters.join(QLatin1Char(',')));
+    if (ret >= 0)
+        ret = graph->apply(frame);
+    if (ret >= 0)
+        ret = graph->config();
+    if (ret < 0) {
+        qWarning() << "Could not create atempo filters:" << ret;
+        return ret;
+    }
+
+    m_filter.reset(new QAVAudioFilter(
+        frame.stream(),
+        QLatin1String("atempo"),
+        graph->audioInputFilters(),
+        graph->audioOutputFilters(),
+        graph->mutex()));
+    m_graph = std::move(graph);
+    m_format = QAVAudioFrame(frame).format();
+    m_speed = speed;
+    m_stages = stages;
+    return 0;
+}
+
+int QAVAudioTempo::setSpeed(qreal speed)
+{
+    const int stages = stagesCount(speed);
+    if (!m_graph || stages != m_stages)
+        return AVERROR(EINVAL);
+
+    const QByteArray value = tempoValue(speed, stages).toLatin1();
+    int ret = 0;
+    {
+        QMutexLocker locker(&m_graph->mutex());
+        // All the stages get the same tempo
+        ret = avfilter_graph_send_command(m_graph->graph(), "atempo", "tempo", value.constData(), nullptr, 0, 0);
+    }
+    if (ret < 0)
+        return ret;
+
+    // The samples produced after the change are stretched differently
+    if (m_format.sampleRate() > 0)
+        m_startPts += m_outSamples * m_speed / m_format.sampleRate();
+    m_outSamples = 0;
+    m_speed = speed;
+    return 0;
+}
+
+int QAVAudioTempo::process(const QAVFrame &frame, qreal speed, const std::function<void(const QAVFrame &frame)> &cb)
+{
+    if (!frame || speed <= 0)
+        return AVERROR(EINVAL);
+
+    const double pts = frame.pts();
+    const bool gap = !std::isnan(pts) && m_nextPts >= 0 && std::abs(pts - m_nextPts) > MaxGap;
+    int ret = 0;
+    if (!m_filter || gap || QAVAudioFrame(frame).format() != m_format) {
+        // The buffered samples end the previous segment
+        flush(cb);
+        ret = init(frame, speed);
+        m_startPts = std::isnan(pts) ? 0 : pts;
+    } else if (!qFuzzyCompare(speed, m_speed) && setSpeed(speed) < 0) {
+        // Only the number of stages is changed, the buffered samples are sent with the previous speed
+        flush(cb, false);
+        const double startPts = m_startPts + (m_format.sampleRate() > 0 ? m_outSamples * m_speed / m_format.sampleRate() : 0);
+        ret = init(frame, speed);
+        m_startPts = startPts;
+    }
+    if (ret < 0) {
+        reset();
+        return ret;
+    }
+
+    if (!std::isnan(pts))
+        m_nextPts = pts + frame.duration();
+    m_filterName = frame.filterName();
+
+    ret = m_filter->write(frame);
+    if (ret < 0)
+        return ret;
+    drain(cb);
+    return 0;
+}
+
+void QAVAudioTempo::flush(const std::function<void(const QAVFrame &frame)> &cb, bool resetAfter)
+{
+    if (m_filter) {
+        // The null frame makes atempo return the samples kept for the overlap
+        m_filter->flush();
+        drain(cb);
+    }
+    if (resetAfter)
+        reset();
+}
+
+void QAVAudioTempo::drain(const std::function<void(const QAVFrame &frame)> &cb)
+{
+    QAVFrame out;
+    while (m_filter->read(out) >= 0) {
+        AVFrame *f = out.frame();
+        const int rate = f->sample_rate > 0 ? f->sample_rate : m_format.sampleRate();
+        if (rate <= 0 || f->nb_samples <= 0)
+            continue;
+        // Media time of the stretched samples
+        const double start = m_startPts + m_outSamples * m_speed / rate;
+        m_outSamples += f->nb_samples;
+        f->pts = llrint(start * rate);
+        out.setTimeBase(AVRational{1, rate});
+        const int64_t duration = av_rescale_q(llrint(f->nb_samples * m_speed), AVRational{1, rate}, out.stream().stream()->time_base);
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 30, 0)
+        f->pkt_duration = duration;
+#else
+        f->duration = duration;
+#endif
+        out.setFilterName(m_filterName);
+        cb(out);
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,78 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVAUDIOTEMPO_P_H
+#define QAVAUDIOTEMPO_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QtAVPlayer/qavframe.h>
+#include <QtAVPlayer/qavaudioformat.h>
+#include <functional>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QAVFilterGraph;
+class QAVFilter;
+
+/**
+ * Changes the tempo of the audio frames without changing the pitch and the sample rate,
+ * using atempo filters of FFmpeg (WSOLA).
+ * The speed is changed on the fly without recreating the filters if possible.
+ * Pts and duration of the stretched frames are in the media time of the source frames.
+ * Not thread safe, used by the audio thread of the player.
+ */
+class QAVAudioTempo
+{
+public:
+    QAVAudioTempo();
+    ~QAVAudioTempo();
+
+    // Sends the stretched frames to cb, returns negative error if the frame could not be stretched
+    int process(const QAVFrame &frame, qreal speed, const std::function<void(const QAVFrame &frame)> &cb);
+    // Sends the buffered samples to cb and resets, called at the end of the stream
+    // and before the frames are sent without changing the tempo
+    void flush(const std::function<void(const QAVFrame &frame)> &cb) { flush(cb, true); }
+    // Drops the buffered samples, called after seeks
+    void reset();
+    bool isActive() const { return m_filter != nullptr; }
+
+private:
+    void flush(const std::function<void(const QAVFrame &frame)> &cb, bool resetAfter);
+    void drain(const std::function<void(const QAVFrame &frame)> &cb);
+    int init(const QAVFrame &frame, qreal speed);
+    int setSpeed(qreal speed);
+
+    std::unique_ptr<QAVFilterGraph> m_graph;
+    std::unique_ptr<QAVFilter> m_filter;
+    QAVAudioFormat m_format;
+    qreal m_speed = 1.0;
+    int m_stages = 0;
+    // Expected pts of the next source frame, used to detect discontinuities
+    double m_nextPts = -1;
+    // Media time of the first sample after the last speed change
+    double m_startPts = 0;
+    qint64 m_outSamples = 0;
+    QString m_filterName;
+
+    Q_DISABLE_COPY(QAVAudioTempo)
+};
+
+QT_END_NAMESPACE
+
+#endif
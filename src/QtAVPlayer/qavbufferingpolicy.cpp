@@ -0,0 +1,88 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavbufferingpolicy.h"
+
+QT_BEGIN_NAMESPACE
+
+QAVBufferingPolicy::QAVBufferingPolicy()
+{
+    for (int source : {FileSource, LiveSource}) {
+        m_bytes[source][AllStreams] = 15 * 1024 * 1024;
+        m_duration[source][AllStreams] = 1.0;
+    }
+}
+
+qint64 QAVBufferingPolicy::maxBytes(Streams streams, Source source) const
+{
+    return m_bytes[source][streams];
+}
+
+void QAVBufferingPolicy::setMaxBytes(qint64 bytes, Streams streams, Source source)
+{
+    m_bytes[source][streams] = qMax<qint64>(bytes, 0);
+}
+
+double QAVBufferingPolicy::maxDuration(Streams streams, Source source) const
+{
+    return m_duration[source][streams];
+}
+
+void QAVBufferingPolicy::setMaxDuration(double sec, Streams streams, Source source)
+{
+    m_duration[source][streams] = qMax(sec, 0.0);
+}
+
+double QAVBufferingPolicy::lowWatermark() const
+{
+    return m_lowWatermark;
+}
+
+void QAVBufferingPolicy::setLowWatermark(double ratio)
+{
+    m_lowWatermark = qMax(ratio, 0.0);
+}
+
+double QAVBufferingPolicy::highWatermark() const
+{
+    return m_highWatermark;
+}
+
+void QAVBufferingPolicy::setHighWatermark(double ratio)
+{
+    m_highWatermark = qMax(ratio, 0.0);
+}
+
+bool QAVBufferingPolicy::operator==(const QAVBufferingPolicy &other) const
+{
+    for (int source : {FileSource, LiveSource}) {
+        for (int streams = 0; streams < StreamsCount; ++streams) {
+            if (m_bytes[source][streams] != other.m_bytes[source][streams]
+                || !qFuzzyCompare(1.0 + m_duration[source][streams], 1.0 + other.m_duration[source][streams]))
+            {
+                return false;
+            }
+        }
+    }
+    return qFuzzyCompare(m_lowWatermark, other.m_lowWatermark)
+        && qFuzzyCompare(m_highWatermark, other.m_highWatermark);
+}
+
+#ifndef QT_NO_DEBUG_STREAM
+QDebug operator<<(QDebug dbg, const QAVBufferingPolicy &policy)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace() << "QAVBufferingPolicy(file=" << policy.maxBytes() << "b/" << policy.maxDuration() << "s"
+                  << ", live=" << policy.maxBytes(QAVBufferingPolicy::AllStreams, QAVBufferingPolicy::LiveSource) << "b/"
+                  << policy.maxDuration(QAVBufferingPolicy::AllStreams, QAVBufferingPolicy::LiveSource) << "s"
+                  << ", watermarks=" << policy.lowWatermark() << "-" << policy.highWatermark()
+                  << ')';
+    return dbg;
+}
+#endif
+
+QT_END_NAMESPACE
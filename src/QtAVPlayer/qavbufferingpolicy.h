@@ -0,0 +1,80 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVBUFFERINGPOLICY_H
+#define QAVBUFFERINGPOLICY_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QDebug>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Limits the amount of the packets queued by the demuxer.
+ * The buffer level is the biggest ratio of the queued bytes or duration to the limits.
+ * Demuxing is paused when the level reaches the high watermark,
+ * and resumed when it drops below the low watermark.
+ * Zero limit means no limit.
+ */
+class Q_AVPLAYER_EXPORT QAVBufferingPolicy
+{
+public:
+    enum Source
+    {
+        FileSource,
+        // Not seekable sources or without duration
+        LiveSource
+    };
+
+    enum Streams
+    {
+        // Bytes are summed up for all the streams,
+        // duration is reached when both video and audio have queued it
+        AllStreams,
+        VideoStreams,
+        AudioStreams,
+        SubtitleStreams
+    };
+
+    QAVBufferingPolicy();
+
+    // Max bytes of queued packets
+    qint64 maxBytes(Streams streams = AllStreams, Source source = FileSource) const;
+    void setMaxBytes(qint64 bytes, Streams streams = AllStreams, Source source = FileSource);
+
+    // Max duration of queued packets in seconds
+    double maxDuration(Streams streams = AllStreams, Source source = FileSource) const;
+    void setMaxDuration(double sec, Streams streams = AllStreams, Source source = FileSource);
+
+    // Ratio of the limits when demuxing is resumed
+    double lowWatermark() const;
+    void setLowWatermark(double ratio);
+
+    // Ratio of the limits when demuxing is paused
+    double highWatermark() const;
+    void setHighWatermark(double ratio);
+
+    bool operator==(const QAVBufferingPolicy &other) const;
+    bool operator!=(const QAVBufferingPolicy &other) const { return !(*this == other); }
+
+private:
+    static constexpr int StreamsCount = SubtitleStreams + 1;
+    qint64 m_bytes[2][StreamsCount] = {};
+    double m_duration[2][StreamsCount] = {};
+    double m_lowWatermark = 0.5;
+    double m_highWatermark = 1.0;
+};
+
+#ifndef QT_NO_DEBUG_STREAM
+Q_AVPLAYER_EXPORT QDebug operator<<(QDebug dbg, const QAVBufferingPolicy &policy);
+#endif
+
+Q_DECLARE_METATYPE(QAVBufferingPolicy)
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,31 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVCLOCK_H
+#define QAVCLOCK_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Source of the media time the frames are synchronized with,
+ * f.e. the position played by the audio device or a wall clock shared by several players.
+ * Called from the player threads, so should be thread safe.
+ */
+class Q_AVPLAYER_EXPORT QAVClock
+{
+public:
+    virtual ~QAVClock() = default;
+
+    // Media time in seconds comparable to pts of the frames, negative if unknown yet
+    virtual double time() const = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -42,6 +42,40 @@ void QAVCodec::setCodec(const AVCodec *c)
     d_func()->codec = c;
 }
 
+QAVCodecThreading QAVCodec::threading() const
+{
+    return d_func()->threading;
+}
+
+void QAVCodec::setThreading(const QAVCodecThreading &threading)
+{
+    d_func()->threading = threading;
+}
+
+static void applyThreading(AVCodecContext *avctx, const QAVCodecThreading &threading)
+{
+    if (threading.isNull())
+        return;
+
+    if (threading.threadCount() >= 0)
+        avctx->thread_count = threading.threadCount();
+    switch (threading.type()) {
+        case QAVCodecThreading::FrameThreading:
+            avctx->thread_type = FF_THREAD_FRAME;
+            break;
+        case QAVCodecThreading::SliceThreading:
+            avctx->thread_type = FF_THREAD_SLICE;
+            break;
+        case QAVCodecThreading::FrameAndSliceThreading:
+            avctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+        default:
+            break;
+    }
+    if (threading.isLowDelay())
+        avctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+}
+
 bool QAVCodec::open(AVStream *stream, AVDictionary** opts)
 {
     Q_D(QAVCodec);
@@ -65,6 +99,7 @@ bool QAVCodec::open(AVStream *stream, AVDictionary** opts)
     }
 
     d->avctx->codec_id = d->codec->id;
+    applyThreading(d->avctx, d->threading);
     ret = avcodec_open2(d->avctx, d->codec, opts);
     if (ret < 0) {
         qWarning() << "Could not open the codec:" << d->codec->name << d->codec->id << ret;
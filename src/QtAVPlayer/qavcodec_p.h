@@ -21,6 +21,7 @@
 
 #include "qavpacket.h"
 #include "qavframe.h"
+#include "qavcodecthreading.h"
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QSize>
 #include <memory>
@@ -46,6 +47,10 @@ public:
     const AVCodec *codec() const;
     QSize size() const;
 
+    // Applied when the codec is opened, the options passed to open() take precedence
+    QAVCodecThreading threading() const;
+    void setThreading(const QAVCodecThreading &threading);
+
     void flushBuffers();
 
     // Sends a packet
@@ -34,6 +34,7 @@ public:
     AVCodecContext *avctx = nullptr;
     const AVCodec *codec = nullptr;
     AVStream *stream = nullptr;
+    QAVCodecThreading threading;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,93 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVCODECTHREADING_H
+#define QAVCODECTHREADING_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QDebug>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Threading options of the decoders, applied when the codecs are opened.
+ * Null value keeps the defaults of FFmpeg.
+ */
+class Q_AVPLAYER_EXPORT QAVCodecThreading
+{
+public:
+    enum Type
+    {
+        DefaultThreading,
+        // Decodes several frames at once, adds a delay of one frame per thread
+        FrameThreading,
+        // Decodes several parts of one frame at once, if the codec and the stream support it
+        SliceThreading,
+        FrameAndSliceThreading
+    };
+
+    QAVCodecThreading() = default;
+    // Zero thread count means auto detection
+    QAVCodecThreading(int threadCount, Type type = DefaultThreading, bool lowDelay = false)
+        : m_threadCount(threadCount)
+        , m_type(type)
+        , m_lowDelay(lowDelay)
+    {
+    }
+
+    // Slice threading without the frame delay
+    static QAVCodecThreading lowDelayPreset(int threadCount = 0)
+    {
+        return { threadCount, SliceThreading, true };
+    }
+
+    bool isNull() const { return m_threadCount < 0 && m_type == DefaultThreading && !m_lowDelay; }
+
+    int threadCount() const { return m_threadCount; }
+    void setThreadCount(int count) { m_threadCount = count; }
+
+    Type type() const { return m_type; }
+    void setType(Type type) { m_type = type; }
+
+    bool isLowDelay() const { return m_lowDelay; }
+    void setLowDelay(bool lowDelay) { m_lowDelay = lowDelay; }
+
+    friend bool operator==(const QAVCodecThreading &a, const QAVCodecThreading &b)
+    {
+        return a.m_threadCount == b.m_threadCount &&
+               a.m_type == b.m_type &&
+               a.m_lowDelay == b.m_lowDelay;
+    }
+
+    friend bool operator!=(const QAVCodecThreading &a, const QAVCodecThreading &b)
+    {
+        return !(a == b);
+    }
+
+private:
+    int m_threadCount = -1;
+    Type m_type = DefaultThreading;
+    bool m_lowDelay = false;
+};
+
+#ifndef QT_NO_DEBUG_STREAM
+inline QDebug operator<<(QDebug dbg, const QAVCodecThreading &threading)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace() << "QAVCodecThreading(threads=" << threading.threadCount()
+                  << ", type=" << threading.type()
+                  << ", lowDelay=" << threading.isLowDelay()
+                  << ')';
+    return dbg;
+}
+#endif
+
+Q_DECLARE_METATYPE(QAVCodecThreading)
+
+QT_END_NAMESPACE
+
+#endif
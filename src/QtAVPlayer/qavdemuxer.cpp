@@ -46,10 +46,17 @@ extern "C" {
 #include "qavhwdevice_cuda_p.h"
 
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
 #include <QSharedPointer>
 #include <QMutexLocker>
 #include <atomic>
+#include <cmath>
 #include <cstring>
+#include <limits>
+#include <map>
 #include <QDebug>
 
 extern "C" {
@@ -89,6 +96,135 @@ struct QAVDictionaryHolder
 
 } // namespace
 
+// Stream info found by avformat_find_stream_info() to skip probing on reopen
+class QAVStreamInfoCache
+{
+public:
+    static QAVStreamInfoCache &instance()
+    {
+        static QAVStreamInfoCache cache;
+        return cache;
+    }
+
+    void insert(const QString &id, const QString &url, const AVFormatContext *ctx)
+    {
+        Entry entry;
+        if (!key(url, ctx, entry))
+            return;
+        entry.duration = ctx->duration;
+        entry.startTime = ctx->start_time;
+        for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+            const AVStream *st = ctx->streams[i];
+            Stream s;
+            s.par.reset(avcodec_parameters_alloc(), [](AVCodecParameters *p) { avcodec_parameters_free(&p); });
+            if (!s.par || avcodec_parameters_copy(s.par.get(), st->codecpar) < 0)
+                return;
+            s.timeBase = st->time_base;
+            s.avgFrameRate = st->avg_frame_rate;
+            s.rFrameRate = st->r_frame_rate;
+            s.duration = st->duration;
+            s.startTime = st->start_time;
+            s.framesCount = st->nb_frames;
+            entry.streams.append(s);
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (m_entries.size() >= MaxEntries && !m_entries.contains(id))
+            m_entries.erase(m_entries.begin());
+        m_entries[id] = entry;
+    }
+
+    // Restores the stream info if the source has not been changed
+    bool restore(const QString &id, const QString &url, AVFormatContext *ctx) const
+    {
+        Entry current;
+        if (!key(url, ctx, current))
+            return false;
+
+        Entry entry;
+        {
+            QMutexLocker locker(&m_mutex);
+            auto it = m_entries.find(id);
+            if (it == m_entries.end())
+                return false;
+            entry = it.value();
+        }
+        if (entry.size != current.size || entry.modified != current.modified || entry.format != current.format
+            || int(ctx->nb_streams) != entry.streams.size())
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+            if (ctx->streams[i]->codecpar->codec_type != entry.streams[int(i)].par->codec_type)
+                return false;
+        }
+
+        for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+            AVStream *st = ctx->streams[i];
+            const auto &s = entry.streams[int(i)];
+            if (avcodec_parameters_copy(st->codecpar, s.par.get()) < 0)
+                return false;
+            st->time_base = s.timeBase;
+            st->avg_frame_rate = s.avgFrameRate;
+            st->r_frame_rate = s.rFrameRate;
+            st->duration = s.duration;
+            st->start_time = s.startTime;
+            st->nb_frames = s.framesCount;
+        }
+        ctx->duration = entry.duration;
+        ctx->start_time = entry.startTime;
+        return true;
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_entries.clear();
+    }
+
+private:
+    struct Stream
+    {
+        std::shared_ptr<AVCodecParameters> par;
+        AVRational timeBase = {0, 1};
+        AVRational avgFrameRate = {0, 1};
+        AVRational rFrameRate = {0, 1};
+        int64_t duration = AV_NOPTS_VALUE;
+        int64_t startTime = AV_NOPTS_VALUE;
+        int64_t framesCount = 0;
+    };
+
+    struct Entry
+    {
+        qint64 size = -1;
+        QDateTime modified;
+        QByteArray format;
+        int64_t duration = AV_NOPTS_VALUE;
+        int64_t startTime = AV_NOPTS_VALUE;
+        QList<Stream> streams;
+    };
+
+    // Only local files are cached, validated by size, modification time and the opened format,
+    // the streams of network sources and devices could be changed without changing the url
+    static bool key(const QString &url, const AVFormatContext *ctx, Entry &entry)
+    {
+        QString path = url;
+        if (path.startsWith(QLatin1String("file:")))
+            path = path.mid(5);
+        QFileInfo file(path);
+        if (path.isEmpty() || !file.isFile())
+            return false;
+        entry.size = file.size();
+        entry.modified = file.lastModified();
+        entry.format = ctx->iformat ? QByteArray(ctx->iformat->name) : QByteArray();
+        return true;
+    }
+
+    static const int MaxEntries = 64;
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+};
+
 class QAVDemuxerPrivate
 {
     Q_DECLARE_PUBLIC(QAVDemuxer)
@@ -114,12 +250,130 @@ public:
     QString inputVideoCodec;
     QMap<QString, QString> inputOptions;
     QMap<QString, QString> videoCodecOptions;
+    QMap<int, QAVCodecThreading> codecThreading;
+    QAVFramePoolOptions framePoolOptions;
+    qint64 probeSize = 0;
+    qint64 analyzeDuration = 0;
+    bool fastOpen = false;
+    bool lowLatency = false;
+    bool streamInfoRestored = false;
 
     bool eof = false;
     QList<QAVPacket> packets;
     QString bsfs;
+
+    // Keyframes of one stream seen while demuxing,
+    // used to jump to already demuxed positions by byte seek.
+    struct KeyFrame
+    {
+        int64_t pos = -1;
+        // Not normalized pts to verify the seek
+        int64_t pts = AV_NOPTS_VALUE;
+    };
+    bool indexKeyFrames = false;
+    int keyFrameStream = -1;
+    std::map<double, KeyFrame> keyFrames;
+    // Start and max pts of the continuously demuxed ranges, the overlapping ones are merged
+    std::map<double, double> ranges;
+    // Start of the range being demuxed, new one is started after seek
+    double rangeStart = NAN;
+
+    void extendRange(double sec);
+
+    void resetKeyFrames(int stream);
+    void indexPacket(const QAVPacket &pkt, int64_t pts);
+    bool findKeyFrame(double sec, KeyFrame &keyFrame) const;
 };
 
+// Limits memory for long sources, intra-only codecs and scrubbing
+static const size_t MaxKeyFrames = 1 << 16;
+static const size_t MaxRanges = 1 << 10;
+static const double MinKeyFrameDistance = 0.1;
+
+void QAVDemuxerPrivate::resetKeyFrames(int stream)
+{
+    keyFrameStream = stream;
+    keyFrames.clear();
+    ranges.clear();
+    rangeStart = NAN;
+}
+
+void QAVDemuxerPrivate::extendRange(double sec)
+{
+    if (std::isnan(rangeStart)) {
+        // Continues the range which is demuxed again
+        auto it = ranges.upper_bound(sec);
+        if (it != ranges.begin() && std::prev(it)->second >= sec) {
+            rangeStart = std::prev(it)->first;
+        } else {
+            // The oldest ranges are dropped, their keyframes are not used anymore
+            if (ranges.size() >= MaxRanges)
+                ranges.erase(ranges.begin());
+            rangeStart = sec;
+            ranges.emplace(sec, sec);
+        }
+    }
+
+    auto it = ranges.find(rangeStart);
+    if (it == ranges.end() || sec <= it->second)
+        return;
+    it->second = sec;
+    // Merges the next ranges which are reached
+    auto next = std::next(it);
+    while (next != ranges.end() && next->first <= it->second) {
+        it->second = qMax(it->second, next->second);
+        next = ranges.erase(next);
+    }
+}
+
+void QAVDemuxerPrivate::indexPacket(const QAVPacket &pkt, int64_t pts)
+{
+    const auto &streams = !currentVideoStreams.isEmpty() ? currentVideoStreams : currentAudioStreams;
+    const AVPacket *packet = pkt.packet();
+    if (!indexKeyFrames || streams.isEmpty() || packet->stream_index != streams.first().index() || pts == AV_NOPTS_VALUE)
+        return;
+
+    if (keyFrameStream != packet->stream_index)
+        resetKeyFrames(packet->stream_index);
+
+    const double sec = pkt.pts();
+    extendRange(sec);
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || packet->pos < 0 || keyFrames.size() >= MaxKeyFrames)
+        return;
+
+    auto it = keyFrames.lower_bound(sec);
+    if (it != keyFrames.end() && it->first - sec < MinKeyFrameDistance)
+        return;
+    if (it != keyFrames.begin() && sec - std::prev(it)->first < MinKeyFrameDistance)
+        return;
+    keyFrames.emplace_hint(it, sec, KeyFrame{ packet->pos, pts });
+}
+
+bool QAVDemuxerPrivate::findKeyFrame(double sec, KeyFrame &keyFrame) const
+{
+    if (!indexKeyFrames)
+        return false;
+    auto it = keyFrames.upper_bound(sec);
+    if (it == keyFrames.begin())
+        return false;
+    --it;
+    // The position must be demuxed after the keyframe without gaps
+    auto range = ranges.upper_bound(it->first);
+    if (range == ranges.begin() || std::prev(range)->second < sec)
+        return false;
+    keyFrame = it->second;
+    return true;
+}
+
+static int indexEntriesCount(const AVStream *stream)
+{
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+    return avformat_index_get_entries_count(stream);
+#else
+    return stream->nb_index_entries;
+#endif
+}
+
 static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
 {
     /* Do we need to log ? */
@@ -402,6 +656,10 @@ static int apply_bsf(const QString &bsf, AVFormatContext *ctx, AVBSFContext *&bs
     return ret;
 }
 
+// Probing budget of the fast open if it is not set explicitly
+static const qint64 FastOpenProbeSize = 512 * 1024;
+static const qint64 FastOpenAnalyzeDuration = 500;
+
 int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
 {
     Q_D(QAVDemuxer);
@@ -409,6 +667,11 @@ int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
     Q_ASSERT(!d->ctx);
     d->ctx = QAVFormatContext::alloc();
     d->ctx->ctx()->flags |= AVFMT_FLAG_GENPTS;
+    if (d->lowLatency) {
+        // Packets are returned as soon as they are received, `fflags` input option takes precedence
+        d->ctx->ctx()->flags |= AVFMT_FLAG_NOBUFFER | AVFMT_FLAG_FLUSH_PACKETS;
+        d->ctx->ctx()->max_delay = 0;
+    }
     if (dev) {
         d->ctx->ctx()->pb = dev->ctx();
         d->ctx->ctx()->flags |= AVFMT_FLAG_CUSTOM_IO;
@@ -431,13 +694,46 @@ int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
     for (const auto & key: d->inputOptions.keys())
         av_dict_set(&opts.dict, key.toUtf8().constData(), d->inputOptions[key].toUtf8().constData(),
                     0);
+    // Explicit input options take precedence
+    qint64 probeSize = d->probeSize;
+    qint64 analyzeDuration = d->analyzeDuration;
+    if (d->fastOpen || d->lowLatency) {
+        probeSize = probeSize > 0 ? probeSize : FastOpenProbeSize;
+        analyzeDuration = analyzeDuration > 0 ? analyzeDuration : FastOpenAnalyzeDuration;
+    }
+    if (probeSize > 0)
+        d->ctx->ctx()->probesize = probeSize;
+    if (analyzeDuration > 0)
+        d->ctx->ctx()->max_analyze_duration = analyzeDuration * 1000;
+
     int ret = avformat_open_input(&d->ctx->ctx(), url.toUtf8().constData(), inputFormat, &opts.dict);
     if (ret < 0)
         return ret;
 
-    ret = avformat_find_stream_info(d->ctx->ctx(), NULL);
-    if (ret < 0)
-        return ret;
+    // The index read from the header belongs to the container,
+    // f.e. MPEG-PS adds the entries only while the packets are read by probing
+    bool containerIndex = false;
+    for (unsigned i = 0; i < d->ctx->ctx()->nb_streams; ++i)
+        containerIndex |= indexEntriesCount(d->ctx->ctx()->streams[i]) > 0;
+
+    // The streams of custom IO could be changed without changing the url
+    const bool cacheable = d->fastOpen && !dev;
+    // The stream info depends on the input format and options used to open the source
+    QString id;
+    if (cacheable) {
+        QStringList parts = { url, d->inputFormat, QString::number(probeSize), QString::number(analyzeDuration) };
+        for (auto it = d->inputOptions.cbegin(); it != d->inputOptions.cend(); ++it)
+            parts << it.key() + QLatin1Char('=') + it.value();
+        id = parts.join(QLatin1Char('\n'));
+    }
+    d->streamInfoRestored = cacheable && QAVStreamInfoCache::instance().restore(id, url, d->ctx->ctx());
+    if (!d->streamInfoRestored) {
+        ret = avformat_find_stream_info(d->ctx->ctx(), NULL);
+        if (ret < 0)
+            return ret;
+        if (cacheable)
+            QAVStreamInfoCache::instance().insert(id, url, d->ctx->ctx());
+    }
 
 #if LIBAVUTIL_VERSION_INT < AV_VERSION_INT(59, 8, 0)
     d->seekable = d->ctx->ctx()->iformat->read_seek || d->ctx->ctx()->iformat->read_seek2;
@@ -482,6 +778,16 @@ int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
     if (subtitleStreamIndex >= 0)
         d->currentSubtitleStreams.push_back(d->availableStreams[subtitleStreamIndex]);
 
+    // Build own index only if the container does not provide it and byte seek is supported,
+    // f.e. MPEG-TS, MPEG-PS or raw streams.
+    const int keyFrameStream = videoStreamIndex >= 0 ? videoStreamIndex : audioStreamIndex;
+    d->indexKeyFrames = keyFrameStream >= 0
+        && d->ctx->ctx()->pb
+        && (d->ctx->ctx()->pb->seekable & AVIO_SEEKABLE_NORMAL)
+        && !(d->ctx->ctx()->iformat->flags & AVFMT_NO_BYTE_SEEK)
+        && !containerIndex;
+    d->resetKeyFrames(keyFrameStream);
+
     if (ret < 0)
         return ret;
 
@@ -510,11 +816,18 @@ int QAVDemuxer::resetCodecs()
                     av_dict_set(&opts.dict, key.toUtf8().constData(), d->videoCodecOptions[key].toUtf8().constData(), 0);
 
                 QSharedPointer<QAVCodec> codec(new QAVVideoCodec);
+                auto threading = d->codecThreading.value(int(i), d->codecThreading.value(-1));
+                // Frame threading delays the frames
+                if (threading.isNull() && d->lowLatency)
+                    threading = QAVCodecThreading::lowDelayPreset();
+                codec->setThreading(threading);
+                static_cast<QAVVideoCodec *>(codec.data())->setFramePoolOptions(d->framePoolOptions);
                 d->availableStreams.push_back({ int(i), d->ctx, codec });
                 ret = setup_video_codec(d->inputVideoCodec, d->availableStreams.last(), *static_cast<QAVVideoCodec *>(codec.data()), &opts.dict);
             } break;
             case AVMEDIA_TYPE_AUDIO:
                 d->availableStreams.push_back({ int(i), d->ctx, QSharedPointer<QAVCodec>(new QAVAudioCodec) });
+                d->availableStreams.last().codec()->setThreading(d->codecThreading.value(int(i), d->codecThreading.value(-1)));
                 if (!d->availableStreams.last().codec()->open(d->ctx->ctx()->streams[i]))
                     qWarning() << "Could not open audio codec for stream:" << i;
                 break;
@@ -700,6 +1013,9 @@ void QAVDemuxer::unload()
     d->currentSubtitleStreams.clear();
     d->availableStreams.clear();
     d->progress.clear();
+    d->indexKeyFrames = false;
+    d->resetKeyFrames(-1);
+    d->streamInfoRestored = false;
     av_bsf_free(&d->bsf_ctx);
     d->bsf_ctx = nullptr;
 }
@@ -727,9 +1043,11 @@ int QAVDemuxer::read(QAVPacket &pkt)
         }
     }
 
-    av_packet_unref(pkt.packet());
+    // Don't overwrite the data shared with the copies of the packet
+    pkt = QAVPacket();
     bool eof = false;
     int ret = av_read_frame(d->ctx->ctx(), pkt.packet());
+    const int64_t pts = pkt.packet()->pts;
     if (ret < 0) {
         if (ret == AVERROR_EOF || avio_feof(d->ctx->ctx()->pb)) {
             eof = true;
@@ -752,13 +1070,18 @@ int QAVDemuxer::read(QAVPacket &pkt)
                 pkt.packet()->pts -= stream.stream()->start_time;
                 pkt.packet()->dts -= stream.stream()->start_time;
             }
+            if (ret >= 0)
+                d->indexPacket(pkt, pts);
         }
         // Allow EOF to flush BSF (send NULL)
         if ((ret >= 0 || eof) && d->bsf_ctx) {
             int bsf_ret = av_bsf_send_packet(d->bsf_ctx, d->eof ? NULL : pkt.packet());
-            if (bsf_ret >= 0) {
-                while ((bsf_ret = av_bsf_receive_packet(d->bsf_ctx, pkt.packet())) >= 0)
-                    d->packets.append(pkt);
+            while (bsf_ret >= 0) {
+                QAVPacket out;
+                out.setStream(pkt.stream());
+                bsf_ret = av_bsf_receive_packet(d->bsf_ctx, out.packet());
+                if (bsf_ret >= 0)
+                    d->packets.append(out);
             }
             if (bsf_ret < 0 && bsf_ret != AVERROR_EOF && bsf_ret != AVERROR(EAGAIN)) {
                 qWarning() << "Error applying bitstream filters to an output:" << bsf_ret;
@@ -830,6 +1153,25 @@ bool QAVDemuxer::seekable() const
     return d_func()->seekable;
 }
 
+// Seeks to the byte position and makes sure the expected packet is returned
+static bool seekToKeyFrame(AVFormatContext *ctx, int stream, int64_t pos, int64_t pts)
+{
+    if (av_seek_frame(ctx, -1, pos, AVSEEK_FLAG_BYTE) < 0)
+        return false;
+
+    bool found = false;
+    AVPacket *pkt = av_packet_alloc();
+    for (int i = 0; i < 64 && av_read_frame(ctx, pkt) >= 0; ++i) {
+        const bool sameStream = pkt->stream_index == stream;
+        found = sameStream && pkt->pts == pts;
+        av_packet_unref(pkt);
+        if (sameStream)
+            break;
+    }
+    av_packet_free(&pkt);
+    return found && av_seek_frame(ctx, -1, pos, AVSEEK_FLAG_BYTE) >= 0;
+}
+
 int QAVDemuxer::seek(double sec)
 {
     Q_D(QAVDemuxer);
@@ -838,8 +1180,22 @@ int QAVDemuxer::seek(double sec)
         return AVERROR(EINVAL);
 
     d->eof = false;
+    QAVDemuxerPrivate::KeyFrame keyFrame;
+    const bool found = d->findKeyFrame(sec, keyFrame);
+    const int keyFrameStream = d->keyFrameStream;
+    d->rangeStart = NAN;
     locker.unlock();
 
+    if (found) {
+        if (seekToKeyFrame(d->ctx->ctx(), keyFrameStream, keyFrame.pos, keyFrame.pts))
+            return 0;
+        // F.e. the demuxer computes pts from its own state
+        qDebug() << "Could not seek to keyframe at" << keyFrame.pos << ", disabling keyframe index";
+        locker.relock();
+        d->indexKeyFrames = false;
+        locker.unlock();
+    }
+
     int flags = AVSEEK_FLAG_BACKWARD;
     int64_t target = sec * AV_TIME_BASE;
     int64_t min = INT_MIN;
@@ -889,6 +1245,16 @@ QMap<QString, QString> QAVDemuxer::metadata() const
     return result;
 }
 
+QList<double> QAVDemuxer::keyFrames() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    QList<double> result;
+    for (const auto &keyFrame : d->keyFrames)
+        result.push_back(keyFrame.first);
+    return result;
+}
+
 QList<QAVChapter> QAVDemuxer::chapters() const
 {
     Q_D(const QAVDemuxer);
@@ -988,6 +1354,118 @@ void QAVDemuxer::setVideoCodecOptions(const QMap<QString, QString> &opts)
     d->videoCodecOptions = opts;
 }
 
+QAVCodecThreading QAVDemuxer::codecThreading(int streamIndex) const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->codecThreading.value(streamIndex, d->codecThreading.value(-1));
+}
+
+void QAVDemuxer::setCodecThreading(const QAVCodecThreading &threading, int streamIndex)
+{
+    Q_D(QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    if (threading.isNull())
+        d->codecThreading.remove(streamIndex);
+    else
+        d->codecThreading[streamIndex] = threading;
+}
+
+QAVFramePoolOptions QAVDemuxer::framePoolOptions() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->framePoolOptions;
+}
+
+void QAVDemuxer::setFramePoolOptions(const QAVFramePoolOptions &options)
+{
+    Q_D(QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    d->framePoolOptions = options;
+}
+
+QAVFramePoolStats QAVDemuxer::framePoolStats() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    QAVFramePoolStats stats;
+    for (const auto &stream : d->availableStreams) {
+        auto codec = stream.codec();
+        if (codec && stream.stream()->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            stats += static_cast<const QAVVideoCodec *>(codec.data())->framePoolStats();
+    }
+    return stats;
+}
+
+qint64 QAVDemuxer::probeSize() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->probeSize;
+}
+
+void QAVDemuxer::setProbeSize(qint64 bytes)
+{
+    Q_D(QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    d->probeSize = qMax<qint64>(bytes, 0);
+}
+
+qint64 QAVDemuxer::analyzeDuration() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->analyzeDuration;
+}
+
+void QAVDemuxer::setAnalyzeDuration(qint64 ms)
+{
+    Q_D(QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    d->analyzeDuration = qMax<qint64>(ms, 0);
+}
+
+bool QAVDemuxer::isFastOpen() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->fastOpen;
+}
+
+void QAVDemuxer::setFastOpen(bool enabled)
+{
+    Q_D(QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    d->fastOpen = enabled;
+}
+
+bool QAVDemuxer::isLowLatency() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->lowLatency;
+}
+
+void QAVDemuxer::setLowLatency(bool enabled)
+{
+    Q_D(QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    d->lowLatency = enabled;
+}
+
+bool QAVDemuxer::isStreamInfoRestored() const
+{
+    Q_D(const QAVDemuxer);
+    QMutexLocker locker(&d->mutex);
+    return d->streamInfoRestored;
+}
+
+void QAVDemuxer::clearStreamInfoCache()
+{
+    QAVStreamInfoCache::instance().clear();
+}
+
 void QAVDemuxer::onFrameSent(const QAVStreamFrame &frame)
 {
     Q_D(QAVDemuxer);
@@ -24,6 +24,8 @@
 #include "qavframe.h"
 #include "qavsubtitleframe.h"
 #include "qavchapter.h"
+#include "qavcodecthreading.h"
+#include "qavframepool.h"
 #include <QMap>
 #include <memory>
 
@@ -85,6 +87,13 @@ public:
     QMap<QString, QString> metadata() const;
     QList<QAVChapter> chapters() const;
 
+    /**
+     * Returns pts of the keyframes seen while demuxing,
+     * seek() jumps straight to them using byte seek.
+     * Filled only for the sources without own index.
+     */
+    QList<double> keyFrames() const;
+
     QString bitstreamFilter() const;
     int applyBitstreamFilter(const QString &bsfs);
 
@@ -100,6 +109,49 @@ public:
     QMap<QString, QString> videoCodecOptions() const;
     void setVideoCodecOptions(const QMap<QString, QString> &opts);
 
+    /**
+     * Threading of the decoders, applied on next load.
+     * Stream index -1 sets the default for all the streams,
+     * which is used if a stream has no own threading.
+     */
+    QAVCodecThreading codecThreading(int streamIndex = -1) const;
+    void setCodecThreading(const QAVCodecThreading &threading, int streamIndex = -1);
+
+    /**
+     * Pool of the decoded video frames, applied on next load.
+     * Stats are summed over the video codecs of the loaded source.
+     */
+    QAVFramePoolOptions framePoolOptions() const;
+    void setFramePoolOptions(const QAVFramePoolOptions &options);
+    QAVFramePoolStats framePoolStats() const;
+
+    /**
+     * Limits of probing the streams on load: max bytes and duration in milliseconds,
+     * 0 keeps the defaults of FFmpeg.
+     */
+    qint64 probeSize() const;
+    void setProbeSize(qint64 bytes);
+    qint64 analyzeDuration() const;
+    void setAnalyzeDuration(qint64 ms);
+
+    /**
+     * Probes less data and restores the stream info of already loaded sources
+     * from the cache shared by all the demuxers instead of probing again.
+     * Local files are validated by their size and modification time.
+     */
+    bool isFastOpen() const;
+    void setFastOpen(bool enabled);
+    // Returns true if the streams have not been probed on last load
+    bool isStreamInfoRestored() const;
+    static void clearStreamInfoCache();
+
+    /**
+     * Does not buffer the packets on load and while reading,
+     * probes less data and decodes the video without delay, applied on load.
+     */
+    bool isLowLatency() const;
+    void setLowLatency(bool enabled);
+
     void onFrameSent(const QAVStreamFrame &frame);
     QAVStream::Progress progress(const QAVStream &s) const;
 
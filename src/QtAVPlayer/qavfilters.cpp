@@ -135,42 +135,62 @@ int QAVFilters::write(
 static int readFrames(
     const QAVFrame &decodedFrame,
     const std::vector<std::unique_ptr<QAVFilter>> &filters,
-    QList<QAVFrame> &filteredFrames)
+    std::vector<QAVFrame> &filteredFrames)
 {
-    QAVFrame frame;
     if (filters.empty()) {
         if (decodedFrame)
-            filteredFrames.append(decodedFrame);
+            filteredFrames.push_back(decodedFrame);
         return 0;
     }
 
     // Read all frames from all filters at once
     for (size_t i = 0; i < filters.size(); ++i) {
         do {
+            QAVFrame frame;
             int ret = filters[i]->read(frame);
             if (ret >= 0 && (!frame.filterName().isEmpty() || i == 0))
-                filteredFrames.append(frame);
+                filteredFrames.push_back(std::move(frame));
         } while (!filters[i]->isEmpty());
     }
     return 0;
 }
 
+static bool filtersEmpty(const std::vector<std::unique_ptr<QAVFilter>> &filters)
+{
+    for (const auto &filter : filters)
+        if (!filter->isEmpty())
+            return false;
+    return true;
+}
+
 int QAVFilters::read(
     AVMediaType mediaType,
     const QAVFrame &decodedFrame,
-    QList<QAVFrame> &filteredFrames)
+    std::vector<QAVFrame> &filteredFrames)
 {
-    QMutexLocker locker(&m_mutex);
-    switch (mediaType) {
-    case AVMEDIA_TYPE_VIDEO:
-        return readFrames(decodedFrame, m_videoFilters, filteredFrames);
-    case AVMEDIA_TYPE_AUDIO:
-        return readFrames(decodedFrame, m_audioFilters, filteredFrames);
-    default:
-        qWarning() << "Unsupported codec type:" << mediaType;
-        break;
+    int ret = AVERROR(ENOTSUP);
+    bool drained = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        switch (mediaType) {
+        case AVMEDIA_TYPE_VIDEO:
+            ret = readFrames(decodedFrame, m_videoFilters, filteredFrames);
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            ret = readFrames(decodedFrame, m_audioFilters, filteredFrames);
+            break;
+        default:
+            qWarning() << "Unsupported codec type:" << mediaType;
+            return ret;
+        }
+        drained = (!m_videoFilters.empty() || !m_audioFilters.empty())
+            && filtersEmpty(m_videoFilters)
+            && filtersEmpty(m_audioFilters);
     }
-    return AVERROR(ENOTSUP);
+    // Not under the lock, since the callback could check the filters
+    if (drained && m_drained)
+        m_drained();
+    return ret;
 }
 
 QList<QString> QAVFilters::filterDescs() const
@@ -179,14 +199,6 @@ QList<QString> QAVFilters::filterDescs() const
     return m_filterDescs;
 }
 
-static bool filtersEmpty(const std::vector<std::unique_ptr<QAVFilter>> &filters)
-{
-    for (const auto &filter : filters)
-        if (!filter->isEmpty())
-            return false;
-    return true;
-}
-
 bool QAVFilters::isEmpty() const
 {
     QMutexLocker locker(&m_mutex);
@@ -214,4 +226,9 @@ void QAVFilters::clear()
     m_filterGraphs.clear();
 }
 
+void QAVFilters::setDrainedCallback(const std::function<void()> &cb)
+{
+    m_drained = cb;
+}
+
 QT_END_NAMESPACE
@@ -26,6 +26,7 @@
 #include <QMutex>
 #include <vector>
 #include <memory>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 
@@ -44,12 +45,15 @@ public:
     int read(
         AVMediaType mediaType,
         const QAVFrame &decodedFrame,
-        QList<QAVFrame> &filteredFrames);
+        std::vector<QAVFrame> &filteredFrames);
     QList<QString> filterDescs() const;
     bool isEmpty() const;
     void flush();
     void clear();
 
+    // Called by read() when all filters are read out, set when no threads are using the filters
+    void setDrainedCallback(const std::function<void()> &cb);
+
 private:
     Q_DISABLE_COPY(QAVFilters)
 
@@ -58,6 +62,7 @@ private:
     std::vector<std::unique_ptr<QAVFilter>> m_videoFilters;
     std::vector<std::unique_ptr<QAVFilter>> m_audioFilters;
     mutable QMutex m_mutex;
+    std::function<void()> m_drained;
 };
 
 QT_END_NAMESPACE
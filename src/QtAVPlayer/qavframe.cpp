@@ -8,6 +8,7 @@
 #include "qavframe.h"
 #include "qavstream.h"
 #include "qavframe_p.h"
+#include "qavfreelist_p.h"
 #include <QDebug>
 
 extern "C" {
@@ -16,55 +17,116 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
+static void freeFrame(AVFrame *frame)
+{
+    av_frame_free(&frame);
+}
+
+static void freePrivate(void *ptr)
+{
+    ::operator delete(ptr);
+}
+
+// The frames are often released by other threads than allocated, f.e. decoded and then rendered,
+// so each thread reuses what it has released itself
+using QAVFreeFrames = QAVFreeList<AVFrame, freeFrame>;
+using QAVFreePrivates = QAVFreeList<void, freePrivate>;
+
+QAVFramePrivate::QAVFramePrivate()
+{
+    auto list = QAVFreeFrames::local();
+    frame = list ? list->take() : nullptr;
+    if (!frame)
+        frame = av_frame_alloc();
+}
+
+QAVFramePrivate::QAVFramePrivate(const QAVFramePrivate &other)
+    : QAVFramePrivate()
+{
+    stream = other.stream;
+    // Frames without buffers could not be referenced, but still keep the properties like pts
+    if (av_frame_ref(frame, other.frame) < 0)
+        av_frame_copy_props(frame, other.frame);
+    frameRate = other.frameRate;
+    timeBase = other.timeBase;
+    filterName = other.filterName;
+    QMutexLocker locker(&other.audioMutex);
+    audioFormat = other.audioFormat;
+    audioData = other.audioData;
+}
+
+QAVFramePrivate::~QAVFramePrivate()
+{
+    av_frame_unref(frame);
+    auto list = QAVFreeFrames::local();
+    if (!list || !list->put(frame))
+        av_frame_free(&frame);
+}
+
+void *QAVFramePrivate::operator new(size_t size)
+{
+    auto list = size == sizeof(QAVFramePrivate) ? QAVFreePrivates::local() : nullptr;
+    void *ptr = list ? list->take() : nullptr;
+    return ptr ? ptr : ::operator new(size);
+}
+
+void QAVFramePrivate::operator delete(void *ptr, size_t size)
+{
+    auto list = size == sizeof(QAVFramePrivate) ? QAVFreePrivates::local() : nullptr;
+    if (!list || !list->put(ptr))
+        ::operator delete(ptr);
+}
+
 QAVFrame::QAVFrame()
     : QAVFrame(*new QAVFramePrivate)
 {
 }
 
 QAVFrame::QAVFrame(const QAVFrame &other)
-    : QAVFrame()
+    : QAVStreamFrame(other)
+{
+}
+
+QAVFrame::QAVFrame(QAVFrame &&other) noexcept
+    : QAVStreamFrame(std::move(other))
 {
-    *this = other;
 }
 
 QAVFrame::QAVFrame(QAVFramePrivate &d)
     : QAVStreamFrame(d)
 {
-    d.frame = av_frame_alloc();
 }
 
 QAVFrame &QAVFrame::operator=(const QAVFrame &other)
 {
-    Q_D(QAVFrame);
     QAVStreamFrame::operator=(other);
+    return *this;
+}
 
-    auto other_priv = static_cast<QAVFramePrivate *>(other.d_ptr.get());
-    int64_t pts = d->frame->pts;
-    av_frame_unref(d->frame);
-    av_frame_ref(d->frame, other_priv->frame);
-
-    if (d->frame->pts < 0)
-        d->frame->pts = pts;
-
-    d->frameRate = other_priv->frameRate;
-    d->timeBase = other_priv->timeBase;
-    d->filterName = other_priv->filterName;
+QAVFrame &QAVFrame::operator=(QAVFrame &&other) noexcept
+{
+    QAVStreamFrame::operator=(std::move(other));
     return *this;
 }
 
 QAVFrame::operator bool() const
 {
     Q_D(const QAVFrame);
-    return QAVStreamFrame::operator bool() && d->frame && (d->frame->data[0] || d->frame->data[1] || d->frame->data[2] || d->frame->data[3]);
+    return QAVStreamFrame::operator bool() && (d->frame->data[0] || d->frame->data[1] || d->frame->data[2] || d->frame->data[3]);
 }
 
 QAVFrame::~QAVFrame()
 {
+}
+
+AVFrame *QAVFrame::frame()
+{
+    detach();
     Q_D(QAVFrame);
-    av_frame_free(&d->frame);
+    return d->frame;
 }
 
-AVFrame *QAVFrame::frame() const
+const AVFrame *QAVFrame::frame() const
 {
     Q_D(const QAVFrame);
     return d->frame;
@@ -72,23 +134,27 @@ AVFrame *QAVFrame::frame() const
 
 void QAVFrame::setFrameRate(const AVRational &value)
 {
+    detach();
     Q_D(QAVFrame);
     d->frameRate = value;
 }
 
 void QAVFrame::setTimeBase(const AVRational &value)
 {
+    detach();
     Q_D(QAVFrame);
     d->timeBase = value;
 }
 
 QString QAVFrame::filterName() const
 {
-    return d_func()->filterName;
+    Q_D(const QAVFrame);
+    return d->filterName;
 }
 
 void QAVFrame::setFilterName(const QString &name)
 {
+    detach();
     Q_D(QAVFrame);
     d->filterName = name;
 }
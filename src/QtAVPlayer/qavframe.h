@@ -22,9 +22,13 @@ public:
     QAVFrame();
     ~QAVFrame();
     QAVFrame(const QAVFrame &other);
+    QAVFrame(QAVFrame &&other) noexcept;
     QAVFrame &operator=(const QAVFrame &other);
+    QAVFrame &operator=(QAVFrame &&other) noexcept;
     operator bool() const;
-    AVFrame *frame() const;
+    // Detaches from the copies of the frame, so it can be changed
+    AVFrame *frame();
+    const AVFrame *frame() const;
 
     void setFrameRate(const AVRational &value);
     void setTimeBase(const AVRational &value);
@@ -20,6 +20,8 @@
 //
 
 #include "qavstreamframe_p.h"
+#include "qavaudioformat.h"
+#include <QMutex>
 
 extern "C" {
 #include <libavutil/frame.h>
@@ -31,6 +33,17 @@ struct AVFrame;
 class QAVFramePrivate : public QAVStreamFramePrivate
 {
 public:
+    QAVFramePrivate();
+    // References the same buffers
+    QAVFramePrivate(const QAVFramePrivate &other);
+    ~QAVFramePrivate();
+
+    QAVStreamFramePrivate *clone() const override { return new QAVFramePrivate(*this); }
+    QAVStreamFramePrivate *sharedNull() const override { return qavSharedNull<QAVFramePrivate>(); }
+
+    // Created for every decoded frame, so the memory is reused instead of going to the heap
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
 
     double pts() const override;
     double duration() const override;
@@ -41,6 +54,10 @@ public:
     AVRational timeBase{};
     // Name of a filter the frame has retrieved from
     QString filterName;
+    // Converted by QAVAudioFrame::data() and shared by the copies of the frame
+    mutable QMutex audioMutex;
+    QAVAudioFormat audioFormat;
+    QByteArray audioData;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,258 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFRAMECACHE_P_H
+#define QAVFRAMECACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qavframe.h"
+#include <QMutex>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Keeps the last decoded video frames within the memory budget
+ * to step and play backward without decoding the GOP again.
+ * The frames are inserted in presentation order and are always continuous,
+ * the cursor points to the cached frame that is shown instead of the last inserted one.
+ * The storage is reused, so no memory is allocated per frame once the cache is filled.
+ * The budget is sized to the largest GOP seen so far, the max bytes only caps it,
+ * so the streams with short GOPs do not keep more frames than needed.
+ */
+class QAVFrameCache
+{
+public:
+    qint64 maxBytes() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_maxBytes;
+    }
+
+    void setMaxBytes(qint64 bytes)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxBytes = bytes;
+        evict();
+    }
+
+    // Bytes of the frames that are kept, less than the max bytes if the whole GOP fits
+    qint64 budget() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return doBudget();
+    }
+
+    void insert(const QAVFrame &frame)
+    {
+        QMutexLocker locker(&m_mutex);
+        const double pts = frame.pts();
+        const qint64 bytes = frameBytes(frame);
+        // Hw frames are not cached to not exhaust the pools of the decoders,
+        // and too big frames would not leave enough room for the others.
+        const bool cacheable = !isnan(pts)
+            && !frame.frame()->hw_frames_ctx
+            && bytes > 0
+            && bytes <= m_maxBytes / 4;
+        // Skipped frames or seeking back break the continuity
+        if (!cacheable || (!isEmpty() && pts <= m_frames.back().pts))
+            doClear();
+        if (!cacheable)
+            return;
+
+        // A keyframe completes the previous GOP
+        if (isKeyFrame(frame)) {
+            if (m_gopStarted)
+                m_maxGopBytes = qMax(m_maxGopBytes, m_gopBytes);
+            m_gopStarted = true;
+            m_gopBytes = 0;
+        }
+        m_gopBytes += bytes;
+
+        // Reuse the room of the evicted frames before growing
+        if (m_first > 0 && m_frames.size() == m_frames.capacity()) {
+            m_frames.erase(m_frames.begin(), m_frames.begin() + m_first);
+            m_first = 0;
+        }
+        m_frames.push_back({pts, frame});
+        m_bytes += bytes;
+        evict();
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        doClear();
+    }
+
+    // Also forgets the size of the GOPs, f.e. when new media is loaded
+    void reset()
+    {
+        QMutexLocker locker(&m_mutex);
+        doClear();
+        m_maxGopBytes = 0;
+    }
+
+    // Returns pts of the cursor or the last inserted frame
+    double position() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return doPosition();
+    }
+
+    bool hasPrevious() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return !isEmpty() && m_frames[m_first].pts < doPosition();
+    }
+
+    // Returns the frame before the position
+    bool previous(QAVFrame &frame) const
+    {
+        QMutexLocker locker(&m_mutex);
+        if (isEmpty())
+            return false;
+        const auto begin = m_frames.begin() + m_first;
+        auto it = std::lower_bound(begin, m_frames.end(), doPosition(), [](const Entry &e, double pts) { return e.pts < pts; });
+        if (it == begin)
+            return false;
+        --it;
+        frame = it->frame;
+        return true;
+    }
+
+    // Returns the frame after the cursor
+    bool next(QAVFrame &frame) const
+    {
+        QMutexLocker locker(&m_mutex);
+        if (isnan(m_cursor))
+            return false;
+        auto it = std::upper_bound(m_frames.begin() + m_first, m_frames.end(), m_cursor, [](double pts, const Entry &e) { return pts < e.pts; });
+        if (it == m_frames.end())
+            return false;
+        frame = it->frame;
+        return true;
+    }
+
+    // The cursor is reset when the last inserted frame is reached
+    void setCursor(double pts)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cursor = !isEmpty() && pts < m_frames.back().pts ? pts : NAN;
+    }
+
+    int size() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return int(m_frames.size() - m_first);
+    }
+
+    qint64 bytes() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_bytes;
+    }
+
+private:
+    struct Entry
+    {
+        double pts = NAN;
+        QAVFrame frame;
+    };
+
+    bool isEmpty() const
+    {
+        return m_first >= m_frames.size();
+    }
+
+    static qint64 frameBytes(const QAVFrame &frame)
+    {
+        qint64 bytes = 0;
+        for (auto buf : frame.frame()->buf) {
+            if (buf)
+                bytes += buf->size;
+        }
+        return bytes;
+    }
+
+    static bool isKeyFrame(const QAVFrame &frame)
+    {
+#ifdef AV_FRAME_FLAG_KEY
+        return frame.frame()->flags & AV_FRAME_FLAG_KEY;
+#else
+        return frame.frame()->key_frame;
+#endif
+    }
+
+    qint64 doBudget() const
+    {
+        // Some room over the GOP, since the next GOP could be bigger than the measured ones
+        return m_maxGopBytes > 0 ? qMin(m_maxBytes, m_maxGopBytes + m_maxGopBytes / 8) : m_maxBytes;
+    }
+
+    double doPosition() const
+    {
+        if (!isnan(m_cursor))
+            return m_cursor;
+        return !isEmpty() ? m_frames.back().pts : NAN;
+    }
+
+    void doClear()
+    {
+        m_frames.clear();
+        m_first = 0;
+        m_bytes = 0;
+        m_cursor = NAN;
+        // The GOP is measured again from the next keyframe
+        m_gopStarted = false;
+        m_gopBytes = 0;
+    }
+
+    // The oldest frames are removed first
+    void evict()
+    {
+        const qint64 budget = doBudget();
+        while (!isEmpty() && m_bytes > budget) {
+            auto &entry = m_frames[m_first++];
+            m_bytes -= frameBytes(entry.frame);
+            // Releases the data, the entry is only overwritten after
+            QAVFrame released = std::move(entry.frame);
+        }
+    }
+
+    mutable QMutex m_mutex;
+    // Sorted by pts, the frames before m_first are evicted
+    std::vector<Entry> m_frames;
+    size_t m_first = 0;
+    qint64 m_bytes = 0;
+    qint64 m_maxBytes = 0;
+    double m_cursor = NAN;
+    // Bytes of the current GOP, and of the largest one between two keyframes
+    bool m_gopStarted = false;
+    qint64 m_gopBytes = 0;
+    qint64 m_maxGopBytes = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
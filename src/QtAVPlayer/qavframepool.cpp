@@ -0,0 +1,265 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavframepool_p.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+// Enough for AVX-512
+static const int DefaultAlignment = 64;
+// Decoders might read behind the planes
+static const int PlanePadding = 64;
+
+static int powerOfTwo(int v)
+{
+    int p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+static qint64 alignUp(qint64 v, int align)
+{
+    return (v + align - 1) & ~qint64(align - 1);
+}
+
+static bool isPoolFormat(const AVCodecContext *avctx, const AVFrame *frame)
+{
+    if (avctx->codec_type != AVMEDIA_TYPE_VIDEO || !avctx->codec || !(avctx->codec->capabilities & AV_CODEC_CAP_DR1))
+        return false;
+    if (frame->width <= 0 || frame->height <= 0)
+        return false;
+    auto desc = av_pix_fmt_desc_get(AVPixelFormat(frame->format));
+    if (!desc)
+        return false;
+    int unsupported = AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+    unsupported |= AV_PIX_FMT_FLAG_PSEUDOPAL;
+#endif
+    return !(desc->flags & unsupported);
+}
+
+QAVFramePool::QAVFramePool(const QAVFramePoolOptions &options)
+    : m_options(options)
+{
+}
+
+QAVFramePool::~QAVFramePool()
+{
+    clear();
+}
+
+void QAVFramePool::ref()
+{
+    m_ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QAVFramePool::deref()
+{
+    if (m_ref.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+void QAVFramePool::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto block : m_free) {
+        m_stats.bytes -= block->size;
+        av_free(block->mem);
+        delete block;
+    }
+    m_free.clear();
+}
+
+QAVFramePool::Block *QAVFramePool::takeBlock(qint64 size)
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_free.empty()) {
+        Block *block = m_free.back();
+        m_free.pop_back();
+        if (block->size == size) {
+            ++m_stats.buffersReused;
+            ++m_stats.buffersInUse;
+            return block;
+        }
+        // The frame size is changed, the old buffers will not be used anymore
+        m_stats.bytes -= block->size;
+        av_free(block->mem);
+        delete block;
+    }
+
+    if (m_options.maxBytes() > 0 && m_stats.bytes + size > m_options.maxBytes())
+        return nullptr;
+
+    // av_malloc() does not guarantee bigger alignments than the CPU requires
+    const int align = powerOfTwo(qMax(m_options.alignment(), DefaultAlignment));
+    auto mem = static_cast<uint8_t *>(av_malloc(size_t(size + align - 1)));
+    if (!mem)
+        return nullptr;
+
+    Block *block = new Block;
+    block->pool = this;
+    block->mem = mem;
+    block->data = reinterpret_cast<uint8_t *>(alignUp(qint64(reinterpret_cast<quintptr>(mem)), align));
+    block->size = size;
+    ++m_stats.buffersAllocated;
+    ++m_stats.buffersInUse;
+    m_stats.bytes += size;
+    return block;
+}
+
+void QAVFramePool::putBlock(Block *block)
+{
+    QMutexLocker locker(&m_mutex);
+    --m_stats.buffersInUse;
+    m_free.push_back(block);
+}
+
+void QAVFramePool::freeBlock(void *opaque, uint8_t *data)
+{
+    Q_UNUSED(data);
+    auto block = static_cast<Block *>(opaque);
+    auto pool = block->pool;
+    pool->putBlock(block);
+    pool->deref();
+}
+
+void QAVFramePool::freeExternal(void *opaque, uint8_t *data)
+{
+    Q_UNUSED(data);
+    auto external = static_cast<External *>(opaque);
+    auto pool = external->pool;
+    pool->m_options.allocator()->release(external->buffer);
+    delete external;
+    pool->deref();
+}
+
+int QAVFramePool::getBuffer(AVCodecContext *avctx, AVFrame *frame, int flags)
+{
+    auto fallback = [&] {
+        QMutexLocker locker(&m_mutex);
+        ++m_stats.fallbacks;
+        locker.unlock();
+        return avcodec_default_get_buffer2(avctx, frame, flags);
+    };
+
+    if (!isPoolFormat(avctx, frame))
+        return fallback();
+
+    const AVPixelFormat format = AVPixelFormat(frame->format);
+    int w = frame->width;
+    int h = frame->height;
+    int linesizeAlign[AV_NUM_DATA_POINTERS] = {};
+    avcodec_align_dimensions2(avctx, &w, &h, linesizeAlign);
+
+    int align = qMax(m_options.alignment(), DefaultAlignment);
+    for (int i = 0; i < 4; ++i)
+        align = qMax(align, linesizeAlign[i]);
+    align = powerOfTwo(align);
+
+    // Same as FFmpeg does: increases the width until all the lines are aligned
+    int linesize[4] = {};
+    int width = w;
+    int unaligned = 0;
+    do {
+        width = w;
+        int ret = av_image_fill_linesizes(linesize, format, width);
+        if (ret < 0)
+            return ret;
+        w += w & ~(w - 1);
+        unaligned = 0;
+        for (int i = 0; i < 4; ++i)
+            unaligned |= linesize[i] % align;
+    } while (unaligned);
+
+    qint64 planeSizes[4] = {};
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 59, 100)
+    size_t sizes[4] = {};
+    ptrdiff_t linesizes[4] = {};
+    for (int i = 0; i < 4; ++i)
+        linesizes[i] = linesize[i];
+    int ret = av_image_fill_plane_sizes(sizes, format, h, linesizes);
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < 4; ++i)
+        planeSizes[i] = qint64(sizes[i]);
+#else
+    uint8_t *pointers[4] = {};
+    int ret = av_image_fill_pointers(pointers, format, h, nullptr, linesize);
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < 4; ++i) {
+        if (!pointers[i])
+            break;
+        const qint64 end = i < 3 && pointers[i + 1] ? qint64(reinterpret_cast<quintptr>(pointers[i + 1])) : ret;
+        planeSizes[i] = end - qint64(reinterpret_cast<quintptr>(pointers[i]));
+    }
+#endif
+
+    // Each plane starts aligned
+    qint64 offsets[4] = {};
+    qint64 size = 0;
+    for (int i = 0; i < 4 && planeSizes[i] > 0; ++i) {
+        offsets[i] = size;
+        size = alignUp(size + planeSizes[i] + PlanePadding, align);
+    }
+
+    if (auto allocator = m_options.allocator()) {
+        QAVFrameAllocator::Buffer buffer;
+        if (allocator->allocate(format, QSize(width, h), align, buffer) && buffer.data[0]) {
+            auto external = new External;
+            external->pool = this;
+            external->buffer = buffer;
+            frame->buf[0] = av_buffer_create(buffer.data[0], int(size), freeExternal, external, 0);
+            if (!frame->buf[0]) {
+                allocator->release(buffer);
+                delete external;
+                return AVERROR(ENOMEM);
+            }
+            ref();
+            for (int i = 0; i < 4; ++i) {
+                frame->data[i] = buffer.data[i];
+                frame->linesize[i] = buffer.bytesPerLine[i];
+            }
+            frame->extended_data = frame->data;
+            QMutexLocker locker(&m_mutex);
+            ++m_stats.external;
+            return 0;
+        }
+    }
+
+    Block *block = takeBlock(size);
+    if (!block)
+        return fallback();
+
+    frame->buf[0] = av_buffer_create(block->data, int(size), freeBlock, block, 0);
+    if (!frame->buf[0]) {
+        putBlock(block);
+        return AVERROR(ENOMEM);
+    }
+    ref();
+    for (int i = 0; i < 4; ++i) {
+        frame->data[i] = planeSizes[i] > 0 ? block->data + offsets[i] : nullptr;
+        frame->linesize[i] = planeSizes[i] > 0 ? linesize[i] : 0;
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+QAVFramePoolStats QAVFramePool::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,163 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFRAMEPOOL_H
+#define QAVFRAMEPOOL_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QSize>
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Provides the memory the decoders write the frames to,
+ * f.e. a mapped buffer of QVideoFrame or a texture upload buffer,
+ * so the decoded frames do not need to be copied there.
+ * Called from the decoding threads, so should be thread safe.
+ */
+class Q_AVPLAYER_EXPORT QAVFrameAllocator
+{
+public:
+    struct Buffer
+    {
+        uchar *data[4] = {};
+        int bytesPerLine[4] = {};
+        // Passed back to release()
+        void *opaque = nullptr;
+    };
+
+    virtual ~QAVFrameAllocator() = default;
+
+    /**
+     * The size is already padded as the decoder requires,
+     * the planes should be aligned and bytes per line should be multiple of align.
+     * Returns false to allocate the frame from the pool.
+     */
+    virtual bool allocate(AVPixelFormat format, const QSize &size, int align, Buffer &buffer) = 0;
+    // Called when the last frame referencing the buffer is destroyed, from any thread
+    virtual void release(const Buffer &buffer) = 0;
+};
+
+/**
+ * Options of the pool of the decoded video frames, applied when the codecs are opened.
+ * Null value keeps the default allocator of FFmpeg.
+ */
+class Q_AVPLAYER_EXPORT QAVFramePoolOptions
+{
+public:
+    QAVFramePoolOptions() = default;
+    // Zero max bytes means no limit, zero alignment uses the alignment required by the CPU
+    QAVFramePoolOptions(qint64 maxBytes, int alignment = 0, QAVFrameAllocator *allocator = nullptr)
+        : m_enabled(true)
+        , m_maxBytes(maxBytes)
+        , m_alignment(alignment)
+        , m_allocator(allocator)
+    {
+    }
+
+    bool isNull() const { return !m_enabled; }
+
+    // Buffers above the limit are allocated by FFmpeg
+    qint64 maxBytes() const { return m_maxBytes; }
+    void setMaxBytes(qint64 bytes) { m_maxBytes = bytes; m_enabled = true; }
+
+    // Power of two, alignment of the planes and bytes per line
+    int alignment() const { return m_alignment; }
+    void setAlignment(int alignment) { m_alignment = alignment; m_enabled = true; }
+
+    // Not owned, should outlive all the frames allocated by it
+    QAVFrameAllocator *allocator() const { return m_allocator; }
+    void setAllocator(QAVFrameAllocator *allocator) { m_allocator = allocator; m_enabled = true; }
+
+    friend bool operator==(const QAVFramePoolOptions &a, const QAVFramePoolOptions &b)
+    {
+        return a.m_enabled == b.m_enabled &&
+               a.m_maxBytes == b.m_maxBytes &&
+               a.m_alignment == b.m_alignment &&
+               a.m_allocator == b.m_allocator;
+    }
+
+    friend bool operator!=(const QAVFramePoolOptions &a, const QAVFramePoolOptions &b)
+    {
+        return !(a == b);
+    }
+
+private:
+    bool m_enabled = false;
+    qint64 m_maxBytes = 0;
+    int m_alignment = 0;
+    QAVFrameAllocator *m_allocator = nullptr;
+};
+
+/**
+ * Counters of the frame pools of the current video streams.
+ */
+struct QAVFramePoolStats
+{
+    // Buffers allocated from the heap
+    qint64 buffersAllocated = 0;
+    // Buffers taken from the pool instead of the heap
+    qint64 buffersReused = 0;
+    // Buffers referenced by the frames
+    qint64 buffersInUse = 0;
+    // Memory held by the pool, including the buffers in use
+    qint64 bytes = 0;
+    // Buffers allocated by FFmpeg, f.e. when the limit is reached or the format is not supported
+    qint64 fallbacks = 0;
+    // Buffers provided by QAVFrameAllocator
+    qint64 external = 0;
+
+    QAVFramePoolStats &operator+=(const QAVFramePoolStats &other)
+    {
+        buffersAllocated += other.buffersAllocated;
+        buffersReused += other.buffersReused;
+        buffersInUse += other.buffersInUse;
+        bytes += other.bytes;
+        fallbacks += other.fallbacks;
+        external += other.external;
+        return *this;
+    }
+};
+
+#ifndef QT_NO_DEBUG_STREAM
+inline QDebug operator<<(QDebug dbg, const QAVFramePoolOptions &options)
+{
+    QDebugStateSaver saver(dbg);
+    if (options.isNull())
+        return dbg << "QAVFramePoolOptions()";
+    dbg.nospace() << "QAVFramePoolOptions(maxBytes=" << options.maxBytes()
+                  << ", alignment=" << options.alignment()
+                  << ", allocator=" << static_cast<void *>(options.allocator())
+                  << ')';
+    return dbg;
+}
+
+inline QDebug operator<<(QDebug dbg, const QAVFramePoolStats &stats)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace() << "QAVFramePoolStats(allocated=" << stats.buffersAllocated
+                  << ", reused=" << stats.buffersReused
+                  << ", inUse=" << stats.buffersInUse
+                  << ", bytes=" << stats.bytes
+                  << ", fallbacks=" << stats.fallbacks
+                  << ", external=" << stats.external
+                  << ')';
+    return dbg;
+}
+#endif
+
+Q_DECLARE_METATYPE(QAVFramePoolOptions)
+Q_DECLARE_METATYPE(QAVFramePoolStats)
+
+QT_END_NAMESPACE
+
+#endif
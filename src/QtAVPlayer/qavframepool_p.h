@@ -0,0 +1,82 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFRAMEPOOL_P_H
+#define QAVFRAMEPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qavframepool.h"
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+struct AVCodecContext;
+struct AVFrame;
+
+/**
+ * Buffers of the decoded video frames of one codec, used as get_buffer2.
+ * The released buffers are kept for the next frames of the same size.
+ * Referenced by the codec and by each buffer in use, so it is deleted
+ * when the codec is closed and the last frame is destroyed.
+ */
+class QAVFramePool
+{
+public:
+    explicit QAVFramePool(const QAVFramePoolOptions &options);
+
+    void ref();
+    void deref();
+
+    int getBuffer(AVCodecContext *avctx, AVFrame *frame, int flags);
+    QAVFramePoolStats stats() const;
+
+private:
+    ~QAVFramePool();
+    Q_DISABLE_COPY(QAVFramePool)
+
+    struct Block
+    {
+        QAVFramePool *pool = nullptr;
+        uint8_t *mem = nullptr;
+        uint8_t *data = nullptr;
+        qint64 size = 0;
+    };
+
+    struct External
+    {
+        QAVFramePool *pool = nullptr;
+        QAVFrameAllocator::Buffer buffer;
+    };
+
+    Block *takeBlock(qint64 size);
+    void putBlock(Block *block);
+    void clear();
+    static void freeBlock(void *opaque, uint8_t *data);
+    static void freeExternal(void *opaque, uint8_t *data);
+
+    const QAVFramePoolOptions m_options;
+    std::atomic<int> m_ref{1};
+    mutable QMutex m_mutex;
+    std::vector<Block *> m_free;
+    QAVFramePoolStats m_stats;
+};
+
+QT_END_NAMESPACE
+
+#endif
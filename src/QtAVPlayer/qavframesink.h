@@ -0,0 +1,41 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFRAMESINK_H
+#define QAVFRAMESINK_H
+
+#include <QtAVPlayer/qavvideoframe.h>
+#include <QtAVPlayer/qavaudioframe.h>
+#include <QtAVPlayer/qavsubtitleframe.h>
+#include <QtAVPlayer/qtavplayerglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Receives the frames directly from the player threads without going through Qt signals,
+ * so no connection lookup, no argument packing and no queued copies are involved.
+ * The frames are delivered in the same order as videoFrame(), audioFrame() and subtitleFrame() signals,
+ * and should not block for long, since it blocks the playback of the stream.
+ */
+class Q_AVPLAYER_EXPORT QAVFrameSink
+{
+public:
+    virtual ~QAVFrameSink() = default;
+
+    // Frames are valid only during the call, should be copied to keep them
+    virtual void videoFrame(const QAVVideoFrame &frame) { Q_UNUSED(frame); }
+    virtual void audioFrame(const QAVAudioFrame &frame) { Q_UNUSED(frame); }
+    virtual void subtitleFrame(const QAVSubtitleFrame &frame) { Q_UNUSED(frame); }
+
+    // The player does not use the frames after the call, so they could be moved out to keep them
+    virtual void takeVideoFrame(QAVVideoFrame &&frame) { videoFrame(frame); }
+    virtual void takeAudioFrame(QAVAudioFrame &&frame) { audioFrame(frame); }
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,79 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFREELIST_P_H
+#define QAVFREELIST_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Keeps a bounded number of released items to reuse them instead of going to the heap,
+ * f.e. the privates of the frames which are created for every decoded frame.
+ * Every thread has own list, so no locking is needed, and the items are freed when the thread exits.
+ */
+template<class T, void (*Free)(T *), int Capacity = 64>
+class QAVFreeList
+{
+public:
+    // Returns the list of the current thread, or nullptr if the thread is exiting
+    static QAVFreeList *local()
+    {
+        // Trivially destructible, so it is still valid after the list is destroyed
+        static thread_local bool destroyed = false;
+        if (destroyed)
+            return nullptr;
+        static thread_local QAVFreeList list(&destroyed);
+        return &list;
+    }
+
+    ~QAVFreeList()
+    {
+        *m_destroyed = true;
+        while (m_count > 0)
+            Free(m_items[--m_count]);
+    }
+
+    // Returns nullptr if the list is empty
+    T *take()
+    {
+        return m_count > 0 ? m_items[--m_count] : nullptr;
+    }
+
+    // Returns false if the list is full and the item should be freed by the caller
+    bool put(T *item)
+    {
+        if (m_count >= Capacity)
+            return false;
+        m_items[m_count++] = item;
+        return true;
+    }
+
+private:
+    explicit QAVFreeList(bool *destroyed) : m_destroyed(destroyed) { }
+    Q_DISABLE_COPY(QAVFreeList)
+
+    bool *m_destroyed = nullptr;
+    T *m_items[Capacity] = {};
+    int m_count = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
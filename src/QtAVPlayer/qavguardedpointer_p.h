@@ -0,0 +1,104 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVGUARDEDPOINTER_P_H
+#define QAVGUARDEDPOINTER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Not owned pointer which is used by the player threads and changed by the application.
+ * The readers take a reference without locking, and set() returns
+ * only when no reader uses the previous pointer anymore, so it could be deleted right after.
+ * The readers are counted per generation, so the new readers don't delay set().
+ */
+template<class T>
+class QAVGuardedPointer
+{
+public:
+    // Keeps the pointer valid until destroyed
+    class Ref
+    {
+    public:
+        Ref(const QAVGuardedPointer &p)
+            : m_p(p)
+        {
+            // The generation could be switched before the reader is counted
+            while (true) {
+                m_gen = m_p.m_gen.load();
+                ++m_p.m_users[m_gen];
+                if (m_p.m_gen.load() == m_gen)
+                    break;
+                m_p.release(m_gen);
+            }
+            m_ptr = m_p.m_ptr.load();
+        }
+
+        ~Ref() { m_p.release(m_gen); }
+
+        T *get() const { return m_ptr; }
+        T *operator->() const { return m_ptr; }
+        explicit operator bool() const { return m_ptr != nullptr; }
+
+    private:
+        Q_DISABLE_COPY(Ref)
+        const QAVGuardedPointer &m_p;
+        T *m_ptr = nullptr;
+        int m_gen = 0;
+    };
+
+    T *load() const { return m_ptr.load(); }
+
+    // Waits until the previous pointer is released, must not be called by the reader
+    void set(T *ptr)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_ptr = ptr;
+        const int gen = m_gen.load();
+        m_gen = 1 - gen;
+        ++m_waiting;
+        while (m_users[gen] > 0)
+            m_cond.wait(&m_mutex);
+        --m_waiting;
+    }
+
+private:
+    void release(int gen) const
+    {
+        if (--m_users[gen] == 0 && m_waiting > 0) {
+            QMutexLocker locker(&m_mutex);
+            m_cond.wakeAll();
+        }
+    }
+
+    std::atomic<T *> m_ptr{nullptr};
+    std::atomic_int m_gen{0};
+    mutable std::atomic_int m_users[2] = {{0}, {0}};
+    std::atomic_int m_waiting{0};
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_cond;
+};
+
+QT_END_NAMESPACE
+
+#endif
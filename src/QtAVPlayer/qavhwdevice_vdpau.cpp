@@ -153,7 +153,7 @@ public:
         if (gl_texture)
             return gl_texture;
 
-        auto av_frame = frame().frame();
+        auto av_frame = std::as_const(frame()).frame();
         int w = av_frame->width;
         int h = av_frame->height;
 
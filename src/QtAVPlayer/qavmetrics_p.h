@@ -0,0 +1,175 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVMETRICS_P_H
+#define QAVMETRICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qavplayermetrics.h"
+#include <atomic>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Lock-free counters of the pipeline, updated by the player threads with relaxed atomics.
+ */
+class QAVMetrics
+{
+public:
+    class Histogram
+    {
+    public:
+        void add(qint64 usec)
+        {
+            usec = qMax<qint64>(usec, 0);
+            m_buckets[QAVPlayerMetrics::Histogram::bucketIndex(usec)].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_total.fetch_add(usec, std::memory_order_relaxed);
+            qint64 max = m_max.load(std::memory_order_relaxed);
+            while (usec > max && !m_max.compare_exchange_weak(max, usec, std::memory_order_relaxed)) { }
+        }
+
+        void reset()
+        {
+            for (auto &b : m_buckets)
+                b = 0;
+            m_count = 0;
+            m_total = 0;
+            m_max = 0;
+        }
+
+    private:
+        friend class QAVMetrics;
+        std::atomic<qint64> m_buckets[QAVPlayerMetrics::Histogram::BucketsCount] = {};
+        std::atomic<qint64> m_count{0};
+        std::atomic<qint64> m_total{0};
+        std::atomic<qint64> m_max{0};
+    };
+
+    struct Stream
+    {
+        std::atomic<qint64> packetsRead{0};
+        std::atomic<qint64> bytesRead{0};
+        std::atomic<qint64> framesDecoded{0};
+        std::atomic<qint64> framesSent{0};
+        std::atomic<qint64> framesLate{0};
+        std::atomic<qint64> framesDropped{0};
+        Histogram decodeTime;
+        Histogram filterTime;
+        Histogram clockWaitTime;
+        Histogram presentationJitter;
+
+        static void inc(std::atomic<qint64> &counter, qint64 v = 1)
+        {
+            counter.fetch_add(v, std::memory_order_relaxed);
+        }
+    };
+
+    Stream *stream(AVMediaType type)
+    {
+        switch (type) {
+            case AVMEDIA_TYPE_VIDEO:
+                return &m_streams[QAVPlayerMetrics::Video];
+            case AVMEDIA_TYPE_AUDIO:
+                return &m_streams[QAVPlayerMetrics::Audio];
+            case AVMEDIA_TYPE_SUBTITLE:
+                return &m_streams[QAVPlayerMetrics::Subtitle];
+            default:
+                return nullptr;
+        }
+    }
+
+    void setAvDrift(double sec)
+    {
+        const qint64 usec = qint64(sec * 1000000);
+        m_avDrift.store(usec, std::memory_order_relaxed);
+        qint64 max = m_maxAvDrift.load(std::memory_order_relaxed);
+        while (qAbs(usec) > qAbs(max) && !m_maxAvDrift.compare_exchange_weak(max, usec, std::memory_order_relaxed)) { }
+    }
+
+    void addDemuxerWakeup()
+    {
+        m_demuxerWakeups.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The buffered values are filled by the caller
+    QAVPlayerMetrics snapshot() const
+    {
+        QAVPlayerMetrics metrics;
+        for (int i = QAVPlayerMetrics::Video; i <= QAVPlayerMetrics::Subtitle; ++i) {
+            const auto &s = m_streams[i];
+            auto &m = metrics.stream(QAVPlayerMetrics::StreamType(i));
+            m.packetsRead = s.packetsRead.load(std::memory_order_relaxed);
+            m.bytesRead = s.bytesRead.load(std::memory_order_relaxed);
+            m.framesDecoded = s.framesDecoded.load(std::memory_order_relaxed);
+            m.framesSent = s.framesSent.load(std::memory_order_relaxed);
+            m.framesLate = s.framesLate.load(std::memory_order_relaxed);
+            m.framesDropped = s.framesDropped.load(std::memory_order_relaxed);
+            read(s.decodeTime, m.decodeTime);
+            read(s.filterTime, m.filterTime);
+            read(s.clockWaitTime, m.clockWaitTime);
+            read(s.presentationJitter, m.presentationJitter);
+        }
+        metrics.setAvDrift(m_avDrift.load(std::memory_order_relaxed) / 1000000.0);
+        metrics.setMaxAvDrift(m_maxAvDrift.load(std::memory_order_relaxed) / 1000000.0);
+        metrics.setDemuxerWakeups(m_demuxerWakeups.load(std::memory_order_relaxed));
+        return metrics;
+    }
+
+    // Should be called when no threads are using the metrics
+    void reset()
+    {
+        for (auto &s : m_streams) {
+            s.packetsRead = 0;
+            s.bytesRead = 0;
+            s.framesDecoded = 0;
+            s.framesSent = 0;
+            s.framesLate = 0;
+            s.framesDropped = 0;
+            s.decodeTime.reset();
+            s.filterTime.reset();
+            s.clockWaitTime.reset();
+            s.presentationJitter.reset();
+        }
+        m_avDrift = 0;
+        m_maxAvDrift = 0;
+        m_demuxerWakeups = 0;
+    }
+
+private:
+    static void read(const Histogram &src, QAVPlayerMetrics::Histogram &dst)
+    {
+        for (int i = 0; i < QAVPlayerMetrics::Histogram::BucketsCount; ++i)
+            dst.m_buckets[i] = src.m_buckets[i].load(std::memory_order_relaxed);
+        dst.m_count = src.m_count.load(std::memory_order_relaxed);
+        dst.m_total = src.m_total.load(std::memory_order_relaxed);
+        dst.m_max = src.m_max.load(std::memory_order_relaxed);
+    }
+
+    Stream m_streams[QAVPlayerMetrics::Subtitle + 1];
+    std::atomic<qint64> m_avDrift{0};
+    std::atomic<qint64> m_maxAvDrift{0};
+    std::atomic<qint64> m_demuxerWakeups{0};
+};
+
+QT_END_NAMESPACE
+
+#endif
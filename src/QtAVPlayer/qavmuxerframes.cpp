@@ -421,8 +421,8 @@ int QAVMuxerFrames::write(QAVFrame frame, int streamIndex, Locker &)
     auto enc_ctx = encStream.codec()->avctx();
     auto stream = encStream.stream();
 
-    if (enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && frame && frame.frame()->format != enc_ctx->pix_fmt) {
-        qWarning() << av_pix_fmt_desc_get(AVPixelFormat(frame.frame()->format))->name
+    if (enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && frame && std::as_const(frame).frame()->format != enc_ctx->pix_fmt) {
+        qWarning() << av_pix_fmt_desc_get(AVPixelFormat(std::as_const(frame).frame()->format))->name
                    << "differs to encoder:" << av_pix_fmt_desc_get(enc_ctx->pix_fmt)->name;
         return AVERROR_INVALIDDATA;
     }
@@ -84,6 +84,7 @@ int QAVMuxerPackets::write(QAVPacket packet, int streamIndex, Locker &)
         auto in_stream = stream.stream();
         Q_ASSERT(streamIndex < static_cast<int>(d->ctx->ctx()->nb_streams));
         auto out_stream = d->ctx->ctx()->streams[streamIndex];
+        // The muxer takes the data, packet() detaches so the shared packet is not changed
         enc_pkt = packet.packet();
         enc_pkt->stream_index = streamIndex;
         av_packet_rescale_ts(enc_pkt, in_stream->time_base, out_stream->time_base);
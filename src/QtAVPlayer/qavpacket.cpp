@@ -19,38 +19,79 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
-class QAVPacketPrivate
+class QAVPacketPrivate : public QSharedData
 {
 public:
+    QAVPacketPrivate()
+    {
+        pkt = av_packet_alloc();
+        pkt->size = 0;
+        pkt->stream_index = -1;
+        pkt->pts = AV_NOPTS_VALUE;
+    }
+
+    QAVPacketPrivate(const QAVPacketPrivate &other)
+        : QSharedData(other)
+        , stream(other.stream)
+    {
+        pkt = av_packet_alloc();
+        av_packet_ref(pkt, other.pkt);
+    }
+
+    ~QAVPacketPrivate()
+    {
+        av_packet_free(&pkt);
+    }
+
     AVPacket *pkt = nullptr;
     QAVStream stream;
 };
 
+// Left in the moved packets, so they stay valid and empty
+static QAVPacketPrivate *sharedNull()
+{
+    static QAVPacketPrivate *d = [] {
+        auto p = new QAVPacketPrivate;
+        // Never deleted
+        p->ref.ref();
+        return p;
+    }();
+    return d;
+}
+
 QAVPacket::QAVPacket()
     : d_ptr(new QAVPacketPrivate)
 {
-    d_ptr->pkt = av_packet_alloc();
-    d_ptr->pkt->size = 0;
-    d_ptr->pkt->stream_index = -1;
-    d_ptr->pkt->pts = AV_NOPTS_VALUE;
 }
 
 QAVPacket::QAVPacket(const QAVPacket &other)
-    : QAVPacket()
+    : d_ptr(other.d_ptr)
 {
-    *this = other;
 }
 
-QAVPacket &QAVPacket::operator=(const QAVPacket &other)
+QAVPacket::QAVPacket(QAVPacket &&other) noexcept
+    : d_ptr(sharedNull())
 {
-    av_packet_unref(d_ptr->pkt);
-    av_packet_ref(d_ptr->pkt, other.d_ptr->pkt);
+    d_ptr.swap(other.d_ptr);
+}
 
-    d_ptr->stream = other.d_ptr->stream;
+QAVPacket &QAVPacket::operator=(const QAVPacket &other)
+{
+    d_ptr = other.d_ptr;
+    return *this;
+}
 
+QAVPacket &QAVPacket::operator=(QAVPacket &&other) noexcept
+{
+    d_ptr.swap(other.d_ptr);
     return *this;
 }
 
+void QAVPacket::detach()
+{
+    d_ptr.detach();
+}
+
 QAVPacket::operator bool() const
 {
     Q_D(const QAVPacket);
@@ -59,13 +100,19 @@ QAVPacket::operator bool() const
 
 QAVPacket::~QAVPacket()
 {
+}
+
+AVPacket *QAVPacket::packet()
+{
+    detach();
     Q_D(QAVPacket);
-    av_packet_free(&d->pkt);
+    return d->pkt;
 }
 
-AVPacket *QAVPacket::packet() const
+const AVPacket *QAVPacket::packet() const
 {
-    return d_func()->pkt;
+    Q_D(const QAVPacket);
+    return d->pkt;
 }
 
 double QAVPacket::duration() const
@@ -94,12 +141,15 @@ QAVStream QAVPacket::stream() const
 
 void QAVPacket::setStream(const QAVStream &stream)
 {
+    detach();
     Q_D(QAVPacket);
     d->stream = stream;
 }
 
 int QAVPacket::receive()
 {
+    // The codec writes to the packet, which could be shared
+    detach();
     Q_D(QAVPacket);
     return d->stream ? d->stream.codec()->read(*this) : 0;
 }
@@ -10,22 +10,35 @@
 
 #include "qavframe.h"
 #include "qavstream.h"
-#include <memory>
+#include <QSharedData>
 
 QT_BEGIN_NAMESPACE
 
 struct AVPacket;
 class QAVPacketPrivate;
+/**
+ * Implicitly shared: the copies refer to the same packet until any of them is modified
+ * by setStream() or by the non-const packet(), which detach.
+ */
 class Q_AVPLAYER_EXPORT QAVPacket
 {
 public:
     QAVPacket();
     ~QAVPacket();
     QAVPacket(const QAVPacket &other);
+    // The moved packet is left empty
+    QAVPacket(QAVPacket &&other) noexcept;
     QAVPacket &operator=(const QAVPacket &other);
+    QAVPacket &operator=(QAVPacket &&other) noexcept;
+    void swap(QAVPacket &other) noexcept { d_ptr.swap(other.d_ptr); }
     operator bool() const;
 
-    AVPacket *packet() const;
+    // Makes a deep copy of the packet if it is shared with other packets
+    void detach();
+
+    // Detaches from the copies of the packet, so it can be changed
+    AVPacket *packet();
+    const AVPacket *packet() const;
     double duration() const;
     double pts() const;
 
@@ -39,7 +52,7 @@ public:
     int send() const;
 
 protected:
-    std::unique_ptr<QAVPacketPrivate> d_ptr;
+    QExplicitlySharedDataPointer<QAVPacketPrivate> d_ptr;
 
 private:
     Q_DECLARE_PRIVATE(QAVPacket)
@@ -25,11 +25,20 @@
 #include "qavframe.h"
 #include "qavsubtitleframe.h"
 #include "qavstreamframe.h"
+#include "qavringbuffer_p.h"
+#include "qavcodec_p.h"
+#include "qavmetrics_p.h"
 #include <QMutex>
+#include <QElapsedTimer>
 #include <QWaitCondition>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QDeadlineTimer>
+#endif
 #include <QList>
 #include <math.h>
 #include <memory>
+#include <atomic>
+#include <functional>
 
 extern "C" {
 #include <libavutil/time.h>
@@ -38,6 +47,47 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
+/**
+ * Waits on the condition until the deadline in seconds of av_gettime_relative() or wake(),
+ * instead of sleeping in short steps. Called with the mutex locked.
+ * Returns false if woken up or the wait is limited by maxWait.
+ */
+class QAVClockWaiter
+{
+public:
+    bool waitUntil(QMutex &mutex, double deadline, double maxWait)
+    {
+        const quint64 wakeups = m_wakeups;
+        const double remaining = deadline - av_gettime_relative() / 1000000.0;
+        const double timeout = qMin(remaining, maxWait);
+        if (timeout <= 0)
+            return remaining <= 0;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        QDeadlineTimer timer(Qt::PreciseTimer);
+        timer.setPreciseRemainingTime(0, qint64(timeout * 1000000000.0), Qt::PreciseTimer);
+        while (m_wakeups == wakeups && !timer.hasExpired())
+            m_cond.wait(&mutex, timer);
+#else
+        const double end = av_gettime_relative() / 1000000.0 + timeout;
+        double now = 0;
+        while (m_wakeups == wakeups && (now = av_gettime_relative() / 1000000.0) < end)
+            m_cond.wait(&mutex, qMax<unsigned long>(1, (unsigned long)((end - now) * 1000)));
+#endif
+        return m_wakeups == wakeups && remaining <= maxWait;
+    }
+
+    // Called with the lock
+    void wake()
+    {
+        ++m_wakeups;
+        m_cond.wakeAll();
+    }
+
+private:
+    QWaitCondition m_cond;
+    quint64 m_wakeups = 0;
+};
+
 class QAVQueueClock
 {
 public:
@@ -67,26 +117,60 @@ public:
         }
 
         delay /= speed;
-        const double time = av_gettime_relative() / 1000000.0;
+        double time = av_gettime_relative() / 1000000.0;
+        m_jitter = -1;
         if (shouldSync) {
             if (pts < prevPts)
                 return true;
-            if (time < frameTimer + delay) {
-                double remaining_time = qMin(frameTimer + delay - time, refreshRate);
-                locker.unlock();
-                av_usleep((int64_t)(remaining_time * 1000000.0));
-                return false;
+            const double deadline = frameTimer + delay;
+            if (time < deadline) {
+                if (!m_waiter.waitUntil(m_mutex, deadline, maxWaitTime))
+                    return false;
+                time = av_gettime_relative() / 1000000.0;
+                m_jitter = qMax(0.0, time - deadline);
             }
         }
 
         prevPts = pts;
         frameTimer += delay;
-        if ((delay > 0 && time - frameTimer > maxThreshold) || !shouldSync)
+        m_late = shouldSync && delay > 0 && time - frameTimer > maxThreshold;
+        if (m_late || !shouldSync)
             frameTimer = time;
 
         return true;
     }
 
+    // If the last frame accepted by wait() was behind the clock
+    bool isLate() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_late;
+    }
+
+    // How late in seconds the last frame accepted by wait() was woken up after its deadline,
+    // -1 if it has not waited
+    double jitter() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_jitter;
+    }
+
+    // Interrupts wait() to check the state again
+    void wake()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_waiter.wake();
+    }
+
+    // Waits without presenting a frame while the condition is set, until wake() or the timeout in seconds
+    void idle(const std::atomic_bool &condition, double timeout)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!condition)
+            return;
+        m_waiter.waitUntil(m_mutex, av_gettime_relative() / 1000000.0 + timeout, timeout);
+    }
+
     double pts() const
     {
         QMutexLocker locker(&m_mutex);
@@ -98,6 +182,9 @@ public:
         QMutexLocker locker(&m_mutex);
         prevPts = 0;
         frameTimer = 0;
+        m_late = false;
+        m_jitter = -1;
+        m_waiter.wake();
     }
 
     void setFrameRate(double v)
@@ -110,12 +197,16 @@ private:
     double frameRate = 0;
     double frameTimer = 0;
     double prevPts = 0;
+    bool m_late = false;
+    double m_jitter = -1;
     mutable QMutex m_mutex;
+    QAVClockWaiter m_waiter;
     const double maxFrameDuration = 10.0;
     const double minThreshold = 0.04;
     const double maxThreshold = 0.1;
     const double frameDuplicationThreshold = 0.1;
-    const double refreshRate = 0.01;
+    // The state is checked at least this often if wake() is not called
+    const double maxWaitTime = 0.5;
 };
 
 /**
@@ -130,21 +221,48 @@ public:
         if (isnan(pts) || isnan(master) || master < 0
             || master >= pts || !shouldSync)
             return true;
-        double delaySec = pts - master;
-        double remaining_time = qMin(delaySec, 0.04);
-        av_usleep((int64_t)(remaining_time * 1000000.0));
+        // The master clock is checked again after the delay
+        QMutexLocker locker(&m_mutex);
+        const double time = av_gettime_relative() / 1000000.0;
+        m_waiter.waitUntil(m_mutex, time + pts - master, maxWaitTime);
         return false;
     }
+
+    void wake()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_waiter.wake();
+    }
+
+private:
+    QMutex m_mutex;
+    QAVClockWaiter m_waiter;
+    const double maxWaitTime = 0.04;
 };
 
+/**
+ * Packets are passed from the demuxer to the decoder using the lock-free ring,
+ * the mutexes are used only to serialize the consumer sides (decoding, presenting and clearing),
+ * the producer takes them only to grow the ring and the threads are parked only when the rings are empty or full.
+ * The packets ring grows up to the max capacity before the producer is parked.
+ *
+ * If the decoding depth is set, decode() should be called from a dedicated thread
+ * to decode the packets ahead of the presentation and keep up to depth frames in the ring,
+ * otherwise the packets are decoded by frontFrame().
+ */
 template<class T>
 class QAVPacketQueue
 {
 public:
-    QAVPacketQueue(AVMediaType mediaType, QAVDemuxer &demuxer)
+    QAVPacketQueue(AVMediaType mediaType, QAVDemuxer &demuxer, int capacity = 4096)
         : m_mediaType(mediaType)
         , m_demuxer(demuxer)
+        , m_packets(new QAVRingBuffer<Entry>(capacity))
+        , m_maxCapacity(capacity)
     {
+        m_capacity = int(m_packets->capacity());
+        for (auto &d : m_durations)
+            d = 0;
     }
 
     ~QAVPacketQueue()
@@ -157,36 +275,186 @@ public:
         return m_mediaType;
     }
 
-    bool isEmpty() const
+    // Should be called when no threads are using the queue
+    void setDecodeDepth(int depth)
     {
         QMutexLocker locker(&m_mutex);
-        return m_packets.isEmpty() && m_decodedFrames.isEmpty();
+        m_depth = qMax(0, depth);
+        m_frames.reset(m_depth > 0 ? new QAVRingBuffer<T>(m_depth) : nullptr);
+    }
+
+    int decodeDepth() const
+    {
+        return m_depth;
+    }
+
+    // Packets the ring can grow to, called from any thread
+    void setMaxCapacity(int capacity)
+    {
+        m_maxCapacity = capacity;
+        // Let the parked producer grow the ring
+        wakeProducer();
+    }
+
+    int capacity() const
+    {
+        return m_capacity;
+    }
+
+    // Called on the consumer side when the packets or frames are consumed
+    void setDrainedCallback(const std::function<void()> &cb)
+    {
+        m_drained = cb;
+    }
+
+    // Called when tryDecode() has something to do, set when no threads are using the queue
+    void setScheduleCallback(const std::function<void()> &cb)
+    {
+        m_schedule = cb;
+    }
+
+    // Counters of the decoding, set when no threads are using the queue
+    void setMetrics(QAVMetrics::Stream *metrics)
+    {
+        m_metrics = metrics;
+    }
+
+    bool isEmpty() const
+    {
+        return m_pending == 0;
+    }
+
+    // Frames to be dropped by the decoder, applied before the next packet is decoded
+    void setSkipFrame(AVDiscard discard)
+    {
+        m_skipFrame = discard;
+    }
+
+    AVDiscard skipFrame() const
+    {
+        return AVDiscard(m_skipFrame.load());
+    }
+
+    // Frames to skip the deblocking for, applied before the next packet is decoded
+    void setSkipLoopFilter(AVDiscard discard)
+    {
+        m_skipLoopFilter = discard;
+    }
+
+    AVDiscard skipLoopFilter() const
+    {
+        return AVDiscard(m_skipLoopFilter.load());
     }
 
     void enqueue(const QAVPacket &packet)
     {
-        QMutexLocker locker(&m_mutex);
         if (m_abort)
             return;
-        m_packets.append(packet);
-        m_bytes += packet.packet()->size + sizeof(packet);
-        m_durations[packet.packet()->stream_index] += packet.duration();
-        m_consumerWaiter.wakeAll();
-        m_waitingForPackets = false;
+
+        Entry entry;
+        entry.packet = packet;
+        entry.streamIndex = packet.packet()->stream_index;
+        entry.bytes = packet.packet()->size + sizeof(packet);
+        entry.duration = qint64(packet.duration() * AV_TIME_BASE);
+        // Account before publishing to never report negative values
+        account(entry, 1);
+        while (!m_packets->push(entry)) {
+            if (grow())
+                continue;
+            if (!parkProducer()) {
+                account(entry, -1);
+                return;
+            }
+        }
+
+        if (m_consumerParked) {
+            QMutexLocker locker(&m_parkMutex);
+            m_consumerWaiter.wakeAll();
+        }
+        schedule();
+    }
+
+    // Decodes next packet to the frames ring, returns false if no packets decoded
+    bool decode()
+    {
+        QMutexLocker locker(&m_decoderMutex);
+        Entry entry;
+        if (!dequeue(locker, entry, false))
+            return false;
+
+        QList<T> frames;
+        decode(entry.packet, frames);
+        const int serial = m_serial;
+        for (const auto &frame : frames) {
+            // The frame is pending when it is in the ring
+            m_pending += 1;
+            bool pushed = true;
+            while (!m_frames->push(frame)) {
+                locker.unlock();
+                const bool parked = parkDecoder();
+                locker.relock();
+                if (!parked || serial != m_serial) {
+                    // The queue is cleared or aborted, the frames are outdated
+                    m_pending -= 1;
+                    pushed = false;
+                    break;
+                }
+            }
+            if (!pushed)
+                break;
+        }
+        m_pending -= 1;
+
+        if (m_presenterParked) {
+            QMutexLocker parkLocker(&m_parkMutex);
+            m_framesWaiter.wakeAll();
+        }
+        return true;
+    }
+
+    // Non-blocking decode(), decodes next packet if the frames ring is not full.
+    // The frames which did not fit are pushed on next call.
+    // Returns true if next packet can be decoded right away.
+    bool tryDecode()
+    {
+        QMutexLocker locker(&m_decoderMutex);
+        if (m_abort || !m_frames || !pushPendingFrames() || m_frames->isFull())
+            return false;
+
+        Entry entry;
+        if (!m_packets->pop(entry))
+            return false;
+        m_pending += 1;
+        account(entry, -1);
+        wakeProducer();
+        drained();
+
+        decode(entry.packet, m_pendingFrames);
+        m_pending += int(m_pendingFrames.size());
+        m_pending -= 1;
+        const bool pushed = pushPendingFrames();
+        if (m_presenterParked) {
+            QMutexLocker parkLocker(&m_parkMutex);
+            m_framesWaiter.wakeAll();
+        }
+        return pushed && !m_frames->isFull() && !m_packets->isEmpty();
     }
 
     bool frontFrame(T &frame)
     {
         QMutexLocker locker(&m_mutex);
+        if (m_frames)
+            return frontDecodedFrame(locker, frame);
+
         if (m_decodedFrames.isEmpty()) {
-            auto pkt = dequeue();
-            if (pkt.packet()->stream_index != AVMEDIA_TYPE_UNKNOWN
-                && m_demuxer.currentCodecType(pkt.packet()->stream_index) == m_mediaType)
-            {
-                // Keep the lock during the decoding to prevent
+            Entry entry;
+            if (dequeue(locker, entry, true)) {
+                // Keep the consumer lock during the decoding to prevent
                 // a race between clearPackets() and when the decoding is finished.
-                // Empty packet flushes the codes here.
-                QAVDemuxer::decode(pkt, m_decodedFrames);
+                decode(entry.packet, m_decodedFrames);
+                m_pending += int(m_decodedFrames.size());
+                // The packet is counted until its frames are landed to prevent EOF
+                m_pending -= 1;
             }
         }
         if (m_decodedFrames.isEmpty())
@@ -198,116 +466,372 @@ public:
     void popFrame()
     {
         QMutexLocker locker(&m_mutex);
-        if (!m_decodedFrames.isEmpty())
+        if (m_frames) {
+            // The front frame could be already cleared and replaced by new one
+            if (m_frontSerial == m_serial && m_frames->pop()) {
+                m_pending -= 1;
+                wakeDecoder();
+                drained();
+                schedule();
+            }
+            return;
+        }
+
+        if (!m_decodedFrames.isEmpty()) {
             m_decodedFrames.pop_front();
+            m_pending -= 1;
+            drained();
+        }
     }
 
     void waitForEmpty()
     {
-        QMutexLocker locker(&m_mutex);
-        clearPackets();
+        clear();
+        QMutexLocker locker(&m_parkMutex);
         if (!m_abort && !m_waitingForPackets)
-            m_producerWaiter.wait(&m_mutex);
+            m_producerWaiter.wait(&m_parkMutex);
     }
 
     void abort(bool aborted = true)
     {
-        QMutexLocker locker(&m_mutex);
+        QMutexLocker locker(&m_parkMutex);
         m_abort = aborted;
         m_waitingForPackets = true;
         m_consumerWaiter.wakeAll();
         m_producerWaiter.wakeAll();
+        m_framesWaiter.wakeAll();
+        m_decoderWaiter.wakeAll();
     }
 
     int size() const
     {
-        QMutexLocker locker(&m_mutex);
-        return m_packets.size();
+        return m_size;
     }
 
     double duration(const QList<QAVStream> &streams) const
     {
-        QMutexLocker locker(&m_mutex);
-        double ret = 0.0;
-        for (const auto &s : streams)
-            ret += m_durations[s.index()];
-        return ret;
+        qint64 ret = 0;
+        for (const auto &s : streams) {
+            if (s.index() >= 0 && s.index() < MaxStreams)
+                ret += m_durations[s.index()];
+        }
+        return ret / double(AV_TIME_BASE);
     }
 
     int bytes() const
     {
-        QMutexLocker locker(&m_mutex);
-        return m_bytes;
+        return int(m_bytes);
     }
 
     void clear()
     {
+        // The decoder is not running when the lock is taken
+        QMutexLocker decoderLocker(&m_decoderMutex);
         QMutexLocker locker(&m_mutex);
+        ++m_serial;
+        m_pending -= int(m_pendingFrames.size());
+        m_pendingFrames.clear();
         clearPackets();
     }
 
     void clearFrames()
     {
         QMutexLocker locker(&m_mutex);
-        m_decodedFrames.clear();
+        clearDecodedFrames();
     }
 
     void wake(bool wake)
     {
-        QMutexLocker locker(&m_mutex);
-        if (wake)
+        QMutexLocker locker(&m_parkMutex);
+        if (wake) {
             m_consumerWaiter.wakeAll();
+            m_framesWaiter.wakeAll();
+        }
         m_wake = wake;
     }
 
 private:
-    QAVPacket dequeue()
+    struct Entry
+    {
+        QAVPacket packet;
+        int streamIndex = -1;
+        qint64 bytes = 0;
+        qint64 duration = 0;
+    };
+
+    // Packets with bigger stream index are accounted in bytes only
+    static constexpr int MaxStreams = 64;
+
+    void account(const Entry &entry, int sign)
+    {
+        m_pending += sign;
+        m_size += sign;
+        m_bytes += sign * entry.bytes;
+        if (entry.streamIndex >= 0 && entry.streamIndex < MaxStreams)
+            m_durations[entry.streamIndex] += sign * entry.duration;
+    }
+
+    void decode(const QAVPacket &pkt, QList<T> &frames)
+    {
+        // Empty packet flushes the codecs here.
+        if (pkt.packet()->stream_index != AVMEDIA_TYPE_UNKNOWN
+            && m_demuxer.currentCodecType(pkt.packet()->stream_index) == m_mediaType)
+        {
+            auto codec = pkt.stream().codec();
+            if (codec && codec->avctx()) {
+                codec->avctx()->skip_frame = skipFrame();
+                codec->avctx()->skip_loop_filter = skipLoopFilter();
+            }
+            if (!m_metrics) {
+                QAVDemuxer::decode(pkt, frames);
+                return;
+            }
+            const auto count = frames.size();
+            QElapsedTimer timer;
+            timer.start();
+            QAVDemuxer::decode(pkt, frames);
+            m_metrics->decodeTime.add(timer.nsecsElapsed() / 1000);
+            QAVMetrics::Stream::inc(m_metrics->framesDecoded, frames.size() - count);
+        }
+    }
+
+    // Called with the consumer lock, which is released while the thread is parked.
+    // The dequeued packet is still pending until it is decoded.
+    template<class Locker>
+    bool dequeue(Locker &locker, Entry &entry, bool presenter)
+    {
+        if (!m_packets->pop(entry)) {
+            // Let clear() happen while the thread is parked
+            locker.unlock();
+            parkConsumer(presenter);
+            locker.relock();
+            if (!m_packets->pop(entry))
+                return false;
+        }
+
+        m_pending += 1;
+        account(entry, -1);
+        wakeProducer();
+        drained();
+        return true;
+    }
+
+    template<class Locker>
+    bool frontDecodedFrame(Locker &locker, T &frame)
+    {
+        auto f = m_frames->front();
+        if (!f) {
+            locker.unlock();
+            parkPresenter();
+            locker.relock();
+            f = m_frames->front();
+        }
+        if (!f)
+            return false;
+        frame = *f;
+        m_frontSerial = m_serial;
+        return true;
+    }
+
+    // The presenter respects wake() to handle the pending statuses
+    void parkConsumer(bool presenter)
     {
-        if (m_packets.isEmpty()) {
+        QMutexLocker locker(&m_parkMutex);
+        if (presenter)
             m_producerWaiter.wakeAll();
-            if (!m_abort && !m_wake) {
+        m_consumerParked = true;
+        auto waiting = [&] { return m_packets->isEmpty() && !m_abort && !(presenter && m_wake); };
+        if (waiting()) {
+            if (presenter)
                 m_waitingForPackets = true;
-                m_consumerWaiter.wait(&m_mutex);
+            while (waiting())
+                m_consumerWaiter.wait(&m_parkMutex);
+            if (presenter)
                 m_waitingForPackets = false;
-            }
         }
-        if (m_packets.isEmpty())
-            return {};
+        m_consumerParked = false;
+    }
 
-        auto packet = m_packets.takeFirst();
-        m_bytes -= packet.packet()->size + sizeof(packet);
-        m_durations[packet.packet()->stream_index] -= packet.duration();
-        return packet;
+    void parkPresenter()
+    {
+        QMutexLocker locker(&m_parkMutex);
+        // Decoder is idle, no more frames will be sent.
+        m_producerWaiter.wakeAll();
+        m_presenterParked = true;
+        if (m_frames->isEmpty() && !m_abort && !m_wake) {
+            m_waitingForPackets = true;
+            while (m_frames->isEmpty() && !m_abort && !m_wake)
+                m_framesWaiter.wait(&m_parkMutex);
+            m_waitingForPackets = false;
+        }
+        m_presenterParked = false;
     }
 
-    void clearPackets()
+    // Returns false if the queue is aborted
+    bool parkProducer()
     {
-        m_packets.clear();
+        QMutexLocker locker(&m_parkMutex);
+        m_producerParked = true;
+        while (m_packets->isFull() && !canGrow() && !m_abort)
+            m_producerWaiter.wait(&m_parkMutex);
+        m_producerParked = false;
+        return !m_abort;
+    }
+
+    // Returns false if the queue is aborted
+    bool parkDecoder()
+    {
+        QMutexLocker locker(&m_parkMutex);
+        m_decoderParked = true;
+        if (m_presenterParked)
+            m_framesWaiter.wakeAll();
+        while (m_frames->isFull() && !m_abort)
+            m_decoderWaiter.wait(&m_parkMutex);
+        m_decoderParked = false;
+        return !m_abort;
+    }
+
+    bool canGrow() const
+    {
+        return m_packets->capacity() < size_t(qMax(0, m_maxCapacity.load()));
+    }
+
+    // Called by the producer when the ring is full, returns false if it is at the max capacity
+    bool grow()
+    {
+        if (!canGrow())
+            return false;
+
+        std::unique_ptr<QAVRingBuffer<Entry>> packets(new QAVRingBuffer<Entry>(m_packets->capacity() * 2));
+        // The consumers access the ring only with one of the locks taken
+        QMutexLocker decoderLocker(&m_decoderMutex);
+        QMutexLocker locker(&m_mutex);
+        QMutexLocker parkLocker(&m_parkMutex);
+        Entry entry;
+        while (m_packets->pop(entry))
+            packets->push(std::move(entry));
+        m_packets = std::move(packets);
+        m_capacity = int(m_packets->capacity());
+        return true;
+    }
+
+    void wakeProducer()
+    {
+        if (m_producerParked) {
+            QMutexLocker locker(&m_parkMutex);
+            m_producerWaiter.wakeAll();
+        }
+    }
+
+    void wakeDecoder()
+    {
+        if (m_decoderParked) {
+            QMutexLocker locker(&m_parkMutex);
+            m_decoderWaiter.wakeAll();
+        }
+    }
+
+    void clearDecodedFrames()
+    {
+        if (m_frames) {
+            T frame;
+            while (m_frames->pop(frame))
+                m_pending -= 1;
+            wakeDecoder();
+        }
+        m_pending -= int(m_decodedFrames.size());
         m_decodedFrames.clear();
-        m_bytes = 0;
-        m_durations.clear();
+    }
+
+    void clearPackets()
+    {
+        Entry entry;
+        while (m_packets->pop(entry))
+            account(entry, -1);
+        clearDecodedFrames();
+        wakeProducer();
+        drained();
+    }
+
+    void drained()
+    {
+        if (m_drained)
+            m_drained();
+    }
+
+    void schedule()
+    {
+        if (m_schedule)
+            m_schedule();
+    }
+
+    // Called with the decoder lock, returns true if all the frames are in the ring
+    bool pushPendingFrames()
+    {
+        bool pushed = false;
+        while (!m_pendingFrames.isEmpty() && m_frames->push(m_pendingFrames.front())) {
+            m_pendingFrames.pop_front();
+            pushed = true;
+        }
+        if (pushed && m_presenterParked) {
+            QMutexLocker locker(&m_parkMutex);
+            m_framesWaiter.wakeAll();
+        }
+        return m_pendingFrames.isEmpty();
     }
 
     const AVMediaType m_mediaType = AVMEDIA_TYPE_UNKNOWN;
     QAVDemuxer &m_demuxer;
-    QList<QAVPacket> m_packets;
+    // Replaced only by the producer when it grows
+    std::unique_ptr<QAVRingBuffer<Entry>> m_packets;
+    std::atomic_int m_maxCapacity;
+    std::atomic_int m_capacity = 0;
+    // Frames decoded ahead by decode()
+    std::unique_ptr<QAVRingBuffer<T>> m_frames;
+    int m_depth = 0;
     // Tracks decoded frames to prevent EOF if not all frames are landed
     QList<T> m_decodedFrames;
+    // Frames decoded by tryDecode() which did not fit to the ring
+    QList<T> m_pendingFrames;
+    // Serializes the presenter side
     mutable QMutex m_mutex;
+    // Serializes the decoder side
+    QMutex m_decoderMutex;
+    // Incremented on clear() to drop the frames which are being decoded,
+    // modified when both locks are taken
+    int m_serial = 0;
+    int m_frontSerial = 0;
+    // Used only to park the threads
+    QMutex m_parkMutex;
     QWaitCondition m_consumerWaiter;
     QWaitCondition m_producerWaiter;
-    bool m_abort = false;
+    QWaitCondition m_framesWaiter;
+    QWaitCondition m_decoderWaiter;
+    std::atomic_bool m_consumerParked = false;
+    std::atomic_bool m_producerParked = false;
+    std::atomic_bool m_presenterParked = false;
+    std::atomic_bool m_decoderParked = false;
+    std::atomic_bool m_abort = false;
     bool m_waitingForPackets = true;
-    bool m_wake = false;
+    std::atomic_bool m_wake = false;
+
+    std::function<void()> m_drained;
+    std::function<void()> m_schedule;
+    QAVMetrics::Stream *m_metrics = nullptr;
+    std::atomic_int m_skipFrame{AVDISCARD_DEFAULT};
+    std::atomic_int m_skipLoopFilter{AVDISCARD_DEFAULT};
 
-    int m_bytes = 0;
-    QMap<int, double> m_durations;
+    // Packets in the ring, packets being decoded and decoded frames
+    std::atomic_int m_pending = 0;
+    // Packets in the ring
+    std::atomic_int m_size = 0;
+    std::atomic<qint64> m_bytes = 0;
+    std::atomic<qint64> m_durations[MaxStreams];
 
 private:
     Q_DISABLE_COPY(QAVPacketQueue)
 };
 
-
 QT_END_NAMESPACE
 
 #endif
@@ -0,0 +1,153 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVPCMRING_P_H
+#define QAVPCMRING_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Preallocated single-producer/single-consumer ring of audio bytes.
+ * The producer writes from one thread and the consumer reads from another one
+ * without locks and without waiting, size() can be called from any thread.
+ * clear() can be called from any thread, the dropped bytes are skipped by the next read().
+ */
+class QAVPcmRing
+{
+public:
+    QAVPcmRing() = default;
+
+    // Neither side should use the ring during the reset
+    void reset(size_t capacity)
+    {
+        if (m_buffer.size() != capacity)
+            m_buffer.assign(capacity, 0);
+        m_read.store(0, std::memory_order_relaxed);
+        m_write.store(0, std::memory_order_relaxed);
+        m_clear.store(0, std::memory_order_release);
+    }
+
+    size_t capacity() const
+    {
+        return m_buffer.size();
+    }
+
+    // Exact count of the queued bytes
+    size_t size() const
+    {
+        // Read position first, since it never goes beyond the write one
+        const quint64 read = readPosition();
+        return size_t(m_write.load(std::memory_order_acquire) - read);
+    }
+
+    size_t freeSpace() const
+    {
+        return capacity() - size();
+    }
+
+    // Producer side: contiguous free region, the written bytes are published by commit()
+    char *writeRegion(size_t &size)
+    {
+        if (m_buffer.empty()) {
+            size = 0;
+            return nullptr;
+        }
+        const quint64 write = m_write.load(std::memory_order_relaxed);
+        const size_t index = size_t(write % capacity());
+        size = qMin(freeSpace(), capacity() - index);
+        return m_buffer.data() + index;
+    }
+
+    void commit(size_t bytes)
+    {
+        m_write.store(m_write.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+    }
+
+    // Producer side: returns how many bytes are written
+    size_t write(const char *data, size_t size)
+    {
+        size_t written = 0;
+        while (written < size) {
+            size_t region = 0;
+            char *dst = writeRegion(region);
+            region = qMin(region, size - written);
+            if (region == 0)
+                break;
+            memcpy(dst, data + written, region);
+            commit(region);
+            written += region;
+        }
+        return written;
+    }
+
+    // Consumer side: returns how many bytes are read
+    size_t read(char *data, size_t size)
+    {
+        const quint64 read = readPosition();
+        const quint64 write = m_write.load(std::memory_order_acquire);
+        size = qMin(size, size_t(write - read));
+        size_t done = 0;
+        while (done < size) {
+            const size_t index = size_t((read + done) % capacity());
+            const size_t chunk = qMin(size - done, capacity() - index);
+            memcpy(data + done, m_buffer.data() + index, chunk);
+            done += chunk;
+        }
+        m_read.store(read + done, std::memory_order_release);
+        return done;
+    }
+
+    // Drops the queued bytes
+    void clear()
+    {
+        m_clear.store(m_write.load(std::memory_order_acquire) + 1, std::memory_order_release);
+    }
+
+    // Total bytes written since the reset
+    quint64 writePosition() const
+    {
+        return m_write.load(std::memory_order_acquire);
+    }
+
+    // Total bytes read or dropped since the reset
+    quint64 readPosition() const
+    {
+        const quint64 read = m_read.load(std::memory_order_acquire);
+        const quint64 clear = m_clear.load(std::memory_order_acquire);
+        return clear > 0 && clear - 1 > read ? clear - 1 : read;
+    }
+
+private:
+    std::vector<char> m_buffer;
+    // Positions grow monotonically, kept on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<quint64> m_read{0};
+    alignas(64) std::atomic<quint64> m_write{0};
+    // Position to skip to plus one, only grows until the reset
+    alignas(64) std::atomic<quint64> m_clear{0};
+
+    Q_DISABLE_COPY(QAVPcmRing)
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -15,13 +15,22 @@
 #include "qavaudioframe.h"
 #include "qavsubtitleframe.h"
 #include "qavpacketqueue_p.h"
+#include "qavframecache_p.h"
+#include "qavscheduler_p.h"
 #include "qavfiltergraph_p.h"
 #include "qavvideofilter_p.h"
 #include "qavaudiofilter_p.h"
+#include "qavaudiotempo_p.h"
 #include "qavfilters_p.h"
+#include "qavmetrics_p.h"
+#include "qavguardedpointer_p.h"
 #include <QtConcurrent/qtconcurrentrun.h>
 #include <QLoggingCategory>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QMetaMethod>
 #include <functional>
+#include <climits>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -31,6 +40,29 @@ QT_BEGIN_NAMESPACE
 
 Q_LOGGING_CATEGORY(lcAVPlayer, "qt.QtAVPlayer")
 
+// Frames are played backward with mirrored pts
+static const double ReversePtsBase = 1e9;
+// Trick play drops non-reference frames and then all but keyframes
+static const qreal NonRefFramesSpeed = 2.0;
+static const qreal NonKeyFramesSpeed = 4.0;
+// Video frames behind the audio clock are dropped before filtering,
+// and the decoder skips non-reference frames if it does not catch up
+static const double LateFrameThreshold = 0.1;
+static const int LateFramesToSkipDecoding = 5;
+// Live mode keeps the latency close to the jitter buffer, which grows on underruns
+// and shrinks back to the target when the source is stable
+static const qint64 LiveLatencyTarget = 200;
+static const double LiveMaxJitterBuffer = 2.0;
+static const double LiveStablePeriod = 10.0;
+static const qreal LiveCatchUpSpeed = 1.25;
+static const double LiveMaxLatencyFactor = 4.0;
+// Packets rings grow from the capacity until the buffering policy is reached,
+// without the limits or in live mode the capacity keeps bounding the queues
+static const int QueueCapacity = 4096;
+static const int MaxQueueCapacity = 1 << 20;
+// Upper bound of waiting for the jitter buffer to be filled before checking the state again
+static const double LiveBufferingWait = 0.1;
+
 enum PendingMediaStatus
 {
     LoadingMedia,
@@ -48,13 +80,39 @@ class QAVPlayerPrivate
 public:
     QAVPlayerPrivate(QAVPlayer *q)
         : q_ptr(q)
-        , videoQueue(AVMEDIA_TYPE_VIDEO, demuxer)
-        , audioQueue(AVMEDIA_TYPE_AUDIO, demuxer)
-        , subtitleQueue(AVMEDIA_TYPE_SUBTITLE, demuxer)
+        , videoQueue(AVMEDIA_TYPE_VIDEO, demuxer, QueueCapacity)
+        , audioQueue(AVMEDIA_TYPE_AUDIO, demuxer, QueueCapacity)
+        , subtitleQueue(AVMEDIA_TYPE_SUBTITLE, demuxer, QueueCapacity)
     {
+        // The loader continues as the demuxer, resized when the source is loaded
         threadPool.setMaxThreadCount(4);
+        sharedDecoding = qEnvironmentVariableIntValue("QT_AVPLAYER_SHARED_DECODER") > 0;
+        videoQueue.setDrainedCallback([this] { onQueueDrained(); });
+        audioQueue.setDrainedCallback([this] { onQueueDrained(); });
+        subtitleQueue.setDrainedCallback([this] { onQueueDrained(); });
+        filters.setDrainedCallback([this] { onQueueDrained(); });
+        videoQueue.setMetrics(metrics.stream(AVMEDIA_TYPE_VIDEO));
+        audioQueue.setMetrics(metrics.stream(AVMEDIA_TYPE_AUDIO));
+        subtitleQueue.setMetrics(metrics.stream(AVMEDIA_TYPE_SUBTITLE));
+        frameCache.setMaxBytes(256 * 1024 * 1024);
+
+        const auto bytesEnv = qgetenv("QT_AVPLAYER_MAX_QUEUED_BYTES");
+        const auto secEnv = qgetenv("QT_AVPLAYER_MAX_QUEUED_SEC");
+        for (auto source : {QAVBufferingPolicy::FileSource, QAVBufferingPolicy::LiveSource}) {
+            if (!bytesEnv.isEmpty())
+                bufferingPolicy.setMaxBytes(bytesEnv.toLongLong(), QAVBufferingPolicy::AllStreams, source);
+            if (!secEnv.isEmpty())
+                bufferingPolicy.setMaxDuration(secEnv.toDouble(), QAVBufferingPolicy::AllStreams, source);
+        }
     }
 
+    enum DemuxerState
+    {
+        DemuxerRunning,
+        DemuxerBufferFull,
+        DemuxerEndOfFile
+    };
+
     QAVPlayer::Error currentError() const;
     void setMediaStatus(QAVPlayer::MediaStatus status);
     void resetPendingStatuses();
@@ -66,6 +124,18 @@ public:
     void setError(QAVPlayer::Error err, const QString &str);
     void setDuration(double d);
     bool isSeeking() const;
+    bool isSkipping() const;
+    void applySkipFrame();
+    bool dropLateFrame(const QAVFrame &frame, double refPts);
+    qreal playbackSpeed() const;
+    void flushQueues();
+    void wakeClocks();
+    double audioTime() const;
+    double masterTime(AVMediaType type) const;
+    void sendVideoFrame(const QAVFrame &frame);
+    void sendAudioFrame(const QAVFrame &frame);
+    void sendSubtitleFrame(const QAVSubtitleFrame &frame);
+    bool liveReadPacket(const QAVPacket &packet);
     bool isEndOfFile() const;
     void endOfFile(bool v);
     void setVideoFrameRate(double v);
@@ -81,6 +151,13 @@ public:
     void wait(bool v);
     void doLoad();
     void doDemux();
+    QAVBufferingPolicy currentBufferingPolicy() const;
+    double bufferLevel(const QAVBufferingPolicy &policy) const;
+    bool hasBufferingLimits(const QAVBufferingPolicy &policy) const;
+    double updateBufferingProgress(const QAVBufferingPolicy &policy);
+    void parkDemuxer(unsigned long time = ULONG_MAX);
+    void wakeDemuxer();
+    void onQueueDrained();
     bool skipFrame(
         bool master,
         const QAVStreamFrame &frame,
@@ -104,6 +181,12 @@ public:
         bool &sync,
         const std::function<void(const QAVSubtitleFrame &frame)> &cb);
 
+    bool doPlayCachedFrame(
+        bool &master,
+        const std::function<void(const QAVFrame &frame)> &cb);
+
+    void doDecodeVideo();
+    void doDecodeAudio();
     void doPlayVideo();
     void doPlayAudio();
     void doPlaySubtitle();
@@ -131,6 +214,32 @@ public:
     double currPts = 0.0;
     mutable QMutex positionMutex;
     bool synced = true;
+    std::atomic_bool trickPlay{false};
+    std::atomic_bool sharedDecoding{false};
+    std::atomic_int frameDropPolicy{QAVPlayer::NoFrameDrop};
+    // Video frames dropped in a row, used by the video thread only
+    int lateFrames = 0;
+    std::atomic_bool decodingBehind{false};
+
+    std::atomic_int masterClock{QAVPlayer::AutoClock};
+    QAVGuardedPointer<QAVClock> externalClock;
+    QAVGuardedPointer<QAVClock> audioDeviceClock;
+    QAVGuardedPointer<QAVFrameSink> frameSink;
+
+    std::atomic_bool liveMode{false};
+    // Live mode of the loaded source, set when no threads are running
+    bool liveActive = false;
+    std::atomic<qint64> liveLatencyTarget{LiveLatencyTarget};
+    std::atomic<qint64> liveLatency{0};
+    // Presentation waits until the jitter buffer is filled
+    std::atomic_bool liveBuffering{false};
+    std::atomic_bool liveCatchUp{false};
+    std::atomic<double> livePresentedPts{NAN};
+    // Used by the demuxer thread only, in seconds
+    double liveJitterBuffer = 0;
+    double liveStableSince = 0;
+    double liveFirstPts = NAN;
+    bool liveWaitKeyFrame = false;
 
     QAVPlayer::Error error = QAVPlayer::NoError;
 
@@ -139,15 +248,33 @@ public:
 
     QThreadPool threadPool;
     QFuture<void> loaderFuture;
-    QFuture<void> demuxerFuture;
 
+    QFuture<void> videoDecodeFuture;
+    QAVScheduler::TaskPtr videoDecodeTask;
     QFuture<void> videoPlayFuture;
     QAVPacketQueue<QAVFrame> videoQueue;
     QAVQueueClock videoClock;
-
+    // Recently played frames to step and play backward
+    QAVFrameCache frameCache;
+    // Reused by the video and audio threads to not allocate per frame
+    std::vector<QAVFrame> videoFilteredFrames;
+    std::vector<QAVFrame> audioFilteredFrames;
+    // The copies share the same data, so the empty frames are not allocated
+    const QAVFrame emptyFrame;
+    QAVQueueClock reverseClock;
+    std::atomic_bool reverseStep{false};
+    bool playingBackward = false;
+    double reverseSeekFrom = NAN;
+
+    QFuture<void> audioDecodeFuture;
+    QAVScheduler::TaskPtr audioDecodeTask;
     QFuture<void> audioPlayFuture;
     QAVPacketQueue<QAVFrame> audioQueue;
     QAVQueueClock audioClock;
+    // Stretches the audio if the speed is not 1.0, used only by the audio thread
+    QAVAudioTempo audioTempo;
+    // Set after the queues are flushed, the samples kept by atempo are dropped by the audio thread
+    std::atomic_bool audioTempoReset{false};
 
     QFuture<void> subtitlePlayFuture;
     QAVPacketQueue<QAVSubtitleFrame> subtitleQueue;
@@ -160,11 +287,25 @@ public:
     bool eof = false;
     std::atomic_bool startDemuxing{false};
 
+    QAVBufferingPolicy bufferingPolicy;
+    mutable QMutex bufferingMutex;
+    std::atomic_bool liveSource{false};
+    std::atomic_int bufferingPercent{0};
+    // The demuxer is parked if the buffers are full, demuxing is not started or EOF is reached,
+    // and woken up when the queues are drained or the state is changed.
+    std::atomic_int demuxerState{DemuxerRunning};
+    bool demuxerWakeup = false;
+    QMutex demuxerMutex;
+    QWaitCondition demuxerCond;
+
     QList<QString> filterDescs;
     QAVFilters filters;
     // If set, means it requires to recreate filters using current filterDescs.
     // It is done on doPlay threads.
     std::atomic_bool resetFilters{false};
+
+    QAVMetrics metrics;
+    QTimer metricsTimer;
 };
 
 static QString err_str(int err)
@@ -258,6 +399,61 @@ bool QAVPlayerPrivate::isSeeking() const
     return pendingSeek;
 }
 
+bool QAVPlayerPrivate::isSkipping() const
+{
+    QMutexLocker locker(&positionMutex);
+    return pendingSeek || pendingPosition > 0;
+}
+
+void QAVPlayerPrivate::applySkipFrame()
+{
+    const qreal rate = q_ptr->speed();
+    AVDiscard discard = AVDISCARD_DEFAULT;
+    if (trickPlay && rate >= NonKeyFramesSpeed)
+        discard = AVDISCARD_NONKEY;
+    else if (trickPlay && rate >= NonRefFramesSpeed)
+        discard = AVDISCARD_NONREF;
+    if (decodingBehind && discard < AVDISCARD_NONREF)
+        discard = AVDISCARD_NONREF;
+    if (videoQueue.skipFrame() != discard) {
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << videoQueue.skipFrame() << "->" << discard;
+        videoQueue.setSkipFrame(discard);
+    }
+    videoQueue.setSkipLoopFilter(decodingBehind ? AVDISCARD_ALL : AVDISCARD_DEFAULT);
+}
+
+// Called by the video thread before the frame is filtered
+bool QAVPlayerPrivate::dropLateFrame(const QAVFrame &frame, double refPts)
+{
+    const auto policy = QAVPlayer::FrameDropPolicy(frameDropPolicy.load());
+    const double lateness = refPts - frame.pts();
+    const bool late = policy != QAVPlayer::NoFrameDrop
+        && synced
+        && refPts > 0
+        && !isnan(lateness)
+        && lateness >= LateFrameThreshold
+        && q_ptr->speed() > 0
+        && q_ptr->state() == QAVPlayer::PlayingState
+        && !isSkipping();
+
+    if (!late) {
+        lateFrames = 0;
+        if (decodingBehind) {
+            qCDebug(lcAVPlayer) << "Video caught up the audio, decoding all frames";
+            decodingBehind = false;
+            applySkipFrame();
+        }
+        return false;
+    }
+
+    if (++lateFrames == LateFramesToSkipDecoding && policy == QAVPlayer::DropLateFramesAndSkipDecoding) {
+        qCDebug(lcAVPlayer) << "Video is behind the audio by" << lateness << "sec, skipping non-reference frames";
+        decodingBehind = true;
+        applySkipFrame();
+    }
+    return true;
+}
+
 bool QAVPlayerPrivate::isEndOfFile() const
 {
     QMutexLocker locker(&stateMutex);
@@ -333,11 +529,20 @@ void QAVPlayerPrivate::terminate()
     if (dev)
         dev->abort(true);
     demuxer.abort();
-    demuxerFuture.waitForFinished();
     loaderFuture.waitForFinished();
+    videoDecodeFuture.waitForFinished();
     videoPlayFuture.waitForFinished();
+    audioDecodeFuture.waitForFinished();
     audioPlayFuture.waitForFinished();
     subtitlePlayFuture.waitForFinished();
+    for (auto task : {videoDecodeTask, audioDecodeTask}) {
+        if (task)
+            QAVScheduler::instance().cancel(task);
+    }
+    videoDecodeTask.reset();
+    audioDecodeTask.reset();
+    videoQueue.setScheduleCallback(nullptr);
+    audioQueue.setScheduleCallback(nullptr);
     videoQueue.abort(false);
     audioQueue.abort(false);
     subtitleQueue.abort(false);
@@ -347,6 +552,19 @@ void QAVPlayerPrivate::terminate()
     pendingPosition = 0;
     pendingSeek = false;
     currPts = 0.0;
+    frameCache.reset();
+    metrics.reset();
+    lateFrames = 0;
+    decodingBehind = false;
+    applySkipFrame();
+    liveActive = false;
+    liveLatency = 0;
+    liveBuffering = false;
+    liveCatchUp = false;
+    reverseClock.clear();
+    reverseStep = false;
+    playingBackward = false;
+    reverseSeekFrom = NAN;
     pendingMediaStatuses.clear();
     filters.clear();
     setDuration(0);
@@ -494,6 +712,58 @@ void QAVPlayerPrivate::wait(bool v)
     videoQueue.wake(true);
     audioQueue.wake(true);
     subtitleQueue.wake(true);
+    wakeClocks();
+    wakeDemuxer();
+}
+
+// Interrupts waiting for the frame deadlines to apply the state
+void QAVPlayerPrivate::wakeClocks()
+{
+    videoClock.wake();
+    reverseClock.wake();
+    audioClock.wake();
+    subtitleClock.wake();
+}
+
+// The frames are converted only if anyone receives them
+void QAVPlayerPrivate::sendVideoFrame(const QAVFrame &frame)
+{
+    static const QMetaMethod signal = QMetaMethod::fromSignal(&QAVPlayer::videoFrame);
+    const bool connected = q_ptr->isSignalConnected(signal);
+    if (!frameSink.load() && !connected)
+        return;
+
+    QAVVideoFrame videoFrame(frame);
+    if (connected)
+        Q_EMIT q_ptr->videoFrame(videoFrame);
+    // Not held while the signal is emitted, which could be blocked by the thread changing the sink
+    QAVGuardedPointer<QAVFrameSink>::Ref sink(frameSink);
+    if (sink)
+        sink->takeVideoFrame(std::move(videoFrame));
+}
+
+void QAVPlayerPrivate::sendAudioFrame(const QAVFrame &frame)
+{
+    static const QMetaMethod signal = QMetaMethod::fromSignal(&QAVPlayer::audioFrame);
+    const bool connected = q_ptr->isSignalConnected(signal);
+    if (!frameSink.load() && !connected)
+        return;
+
+    QAVAudioFrame audioFrame(frame);
+    if (connected)
+        Q_EMIT q_ptr->audioFrame(audioFrame);
+    // Not held while the signal is emitted, which could be blocked by the thread changing the sink
+    QAVGuardedPointer<QAVFrameSink>::Ref sink(frameSink);
+    if (sink)
+        sink->takeAudioFrame(std::move(audioFrame));
+}
+
+void QAVPlayerPrivate::sendSubtitleFrame(const QAVSubtitleFrame &frame)
+{
+    Q_EMIT q_ptr->subtitleFrame(frame);
+    QAVGuardedPointer<QAVFrameSink>::Ref sink(frameSink);
+    if (sink)
+        sink->subtitleFrame(frame);
 }
 
 void QAVPlayerPrivate::applyFilters()
@@ -569,8 +839,50 @@ void QAVPlayerPrivate::doLoad()
     // This schedules the parsing after the packets are already decoded.
     resetFilters = true;
     resetMuxer();
+
+    liveSource = !demuxer.seekable() || demuxer.duration() <= 0;
+    liveActive = liveMode;
+    if (liveActive) {
+        liveJitterBuffer = liveLatencyTarget / 1000.0;
+        liveStableSince = av_gettime_relative() / 1000000.0;
+        liveFirstPts = NAN;
+        livePresentedPts = NAN;
+        liveWaitKeyFrame = false;
+        liveBuffering = true;
+    }
+
+    // Decode the frames ahead of the presentation on separate threads
+    const auto depthEnv = qgetenv("QT_AVPLAYER_MAX_DECODED_FRAMES");
+    const int depth = !depthEnv.isEmpty() ? depthEnv.toInt() : 3;
+    videoQueue.setDecodeDepth(depth);
+    audioQueue.setDecodeDepth(depth);
+
+    // The decoders of all the players share the scheduler instead of own threads
+    const bool sharedDecoder = depth > 0 && sharedDecoding;
+    const bool hasVideo = !q_ptr->availableVideoStreams().isEmpty();
+    const bool hasAudio = !q_ptr->availableAudioStreams().isEmpty();
+    const bool hasSubtitles = !q_ptr->availableSubtitleStreams().isEmpty();
+    const bool ownDecoder = depth > 0 && !sharedDecoder;
+    // Only the threads which are used, so none of them waits for another one to finish.
+    // The loader thread is one of them, it continues as the demuxer.
+    threadPool.setMaxThreadCount(1
+        + (hasVideo ? 1 + ownDecoder : 0)
+        + (hasAudio ? 1 + ownDecoder : 0)
+        + (hasSubtitles ? 1 : 0));
+    if (sharedDecoder) {
+        auto &scheduler = QAVScheduler::instance();
+        if (hasVideo) {
+            videoDecodeTask = scheduler.create([this] { return videoQueue.tryDecode(); });
+            videoQueue.setScheduleCallback([this] { QAVScheduler::instance().schedule(videoDecodeTask); });
+        }
+        if (hasAudio) {
+            audioDecodeTask = scheduler.create([this] { return audioQueue.tryDecode(); });
+            audioQueue.setScheduleCallback([this] { QAVScheduler::instance().schedule(audioDecodeTask); });
+        }
+    }
+
     dispatch([this]() -> void {
-        qCDebug(lcAVPlayer) << "[" << url << "]: Loaded, seekable:" << demuxer.seekable() << ", duration:" << demuxer.duration();
+        qCDebug(lcAVPlayer) << "[" << url << "]: Loaded, seekable:" << demuxer.seekable() << ", duration:" << demuxer.duration() << ", live:" << liveSource;
         setSeekable(demuxer.seekable());
         setDuration(demuxer.duration());
         setVideoFrameRate(demuxer.videoFrameRate());
@@ -578,46 +890,151 @@ void QAVPlayerPrivate::doLoad()
     });
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    demuxerFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doDemux);
-    if (!q_ptr->availableVideoStreams().isEmpty())
+    if (hasVideo) {
+        if (ownDecoder)
+            videoDecodeFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doDecodeVideo);
         videoPlayFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doPlayVideo);
-    if (!q_ptr->availableAudioStreams().isEmpty())
+    }
+    if (hasAudio) {
+        if (ownDecoder)
+            audioDecodeFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doDecodeAudio);
         audioPlayFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doPlayAudio);
-    if (!q_ptr->availableSubtitleStreams().isEmpty())
+    }
+    if (hasSubtitles)
         subtitlePlayFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doPlaySubtitle);
 #else
-    demuxerFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doDemux, this);
-    if (!q_ptr->availableVideoStreams().isEmpty())
+    if (hasVideo) {
+        if (ownDecoder)
+            videoDecodeFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doDecodeVideo, this);
         videoPlayFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doPlayVideo, this);
-    if (!q_ptr->availableAudioStreams().isEmpty())
+    }
+    if (hasAudio) {
+        if (ownDecoder)
+            audioDecodeFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doDecodeAudio, this);
         audioPlayFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doPlayAudio, this);
-    if (!q_ptr->availableSubtitleStreams().isEmpty())
+    }
+    if (hasSubtitles)
         subtitlePlayFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doPlaySubtitle, this);
 #endif
     qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
+    // Demuxes on the loader thread, waited for by loaderFuture
+    doDemux();
 }
 
-void QAVPlayerPrivate::doDemux()
+QAVBufferingPolicy QAVPlayerPrivate::currentBufferingPolicy() const
 {
-    const auto bytesEnv = qgetenv("QT_AVPLAYER_MAX_QUEUED_BYTES");
-    const auto maxBytes = !bytesEnv.isEmpty() ? bytesEnv.toInt() : 15728640;
-    const auto secEnv = qgetenv("QT_AVPLAYER_MAX_QUEUED_SEC");
-    const auto maxSec = !secEnv.isEmpty() ? secEnv.toDouble() : 1.0;
+    QMutexLocker locker(&bufferingMutex);
+    return bufferingPolicy;
+}
 
-    QMutex waiterMutex;
-    QWaitCondition waiter;
+double QAVPlayerPrivate::bufferLevel(const QAVBufferingPolicy &policy) const
+{
+    const auto source = liveSource ? QAVBufferingPolicy::LiveSource : QAVBufferingPolicy::FileSource;
+    double level = 0.0;
+    auto check = [&](double value, QAVBufferingPolicy::Streams streams, bool bytes) {
+        const double limit = bytes ? policy.maxBytes(streams, source) : policy.maxDuration(streams, source);
+        if (limit > 0)
+            level = qMax(level, value / limit);
+    };
 
+    const auto videoStreams = demuxer.currentVideoStreams();
+    const auto audioStreams = demuxer.currentAudioStreams();
+    const double videoDuration = videoQueue.duration(videoStreams);
+    const double audioDuration = audioQueue.duration(audioStreams);
+    check(videoQueue.bytes() + audioQueue.bytes() + subtitleQueue.bytes(), QAVBufferingPolicy::AllStreams, true);
+    // Only the media types being demuxed must reach the duration
+    if (!videoStreams.isEmpty() && !audioStreams.isEmpty())
+        check(qMin(videoDuration, audioDuration), QAVBufferingPolicy::AllStreams, false);
+    else if (!videoStreams.isEmpty() || !audioStreams.isEmpty())
+        check(!videoStreams.isEmpty() ? videoDuration : audioDuration, QAVBufferingPolicy::AllStreams, false);
+
+    check(videoQueue.bytes(), QAVBufferingPolicy::VideoStreams, true);
+    check(videoDuration, QAVBufferingPolicy::VideoStreams, false);
+    check(audioQueue.bytes(), QAVBufferingPolicy::AudioStreams, true);
+    check(audioDuration, QAVBufferingPolicy::AudioStreams, false);
+    check(subtitleQueue.bytes(), QAVBufferingPolicy::SubtitleStreams, true);
+    check(subtitleQueue.duration(demuxer.currentSubtitleStreams()), QAVBufferingPolicy::SubtitleStreams, false);
+    return level;
+}
+
+bool QAVPlayerPrivate::hasBufferingLimits(const QAVBufferingPolicy &policy) const
+{
+    const auto source = liveSource ? QAVBufferingPolicy::LiveSource : QAVBufferingPolicy::FileSource;
+    for (auto streams : {QAVBufferingPolicy::AllStreams, QAVBufferingPolicy::VideoStreams,
+                         QAVBufferingPolicy::AudioStreams, QAVBufferingPolicy::SubtitleStreams})
+    {
+        if (policy.maxBytes(streams, source) > 0 || policy.maxDuration(streams, source) > 0)
+            return true;
+    }
+    return false;
+}
+
+double QAVPlayerPrivate::updateBufferingProgress(const QAVBufferingPolicy &policy)
+{
+    const double level = bufferLevel(policy);
+    const double high = policy.highWatermark();
+    const int percent = qRound((high > 0 ? qMin(level / high, 1.0) : 1.0) * 100);
+    if (bufferingPercent.exchange(percent) != percent)
+        Q_EMIT q_ptr->bufferingProgressChanged(percent / 100.0);
+    return level;
+}
+
+void QAVPlayerPrivate::parkDemuxer(unsigned long time)
+{
+    QMutexLocker locker(&demuxerMutex);
+    if (!demuxerWakeup && !quit)
+        demuxerCond.wait(&demuxerMutex, time);
+    demuxerWakeup = false;
+    demuxerState = DemuxerRunning;
+    metrics.addDemuxerWakeup();
+    qCDebug(lcAVPlayer) << "Demuxer woke up";
+}
+
+void QAVPlayerPrivate::wakeDemuxer()
+{
+    QMutexLocker locker(&demuxerMutex);
+    demuxerWakeup = true;
+    demuxerCond.wakeAll();
+}
+
+void QAVPlayerPrivate::onQueueDrained()
+{
+    // The demuxer reports the progress itself while running
+    switch (demuxerState) {
+    case DemuxerBufferFull: {
+        const auto policy = currentBufferingPolicy();
+        if (updateBufferingProgress(policy) <= policy.lowWatermark())
+            wakeDemuxer();
+        break;
+    }
+    case DemuxerEndOfFile:
+        updateBufferingProgress(currentBufferingPolicy());
+        if (videoQueue.isEmpty() && audioQueue.isEmpty() && subtitleQueue.isEmpty() && filters.isEmpty())
+            wakeDemuxer();
+        break;
+    default:
+        break;
+    }
+}
+
+void QAVPlayerPrivate::doDemux()
+{
     while (!quit) {
-        if (videoQueue.bytes() + audioQueue.bytes() + subtitleQueue.bytes() > maxBytes
-            || (maxSec > 0.0
-                && videoQueue.duration(demuxer.currentVideoStreams()) > maxSec
-                && audioQueue.duration(demuxer.currentAudioStreams()) > maxSec)
-            || !startDemuxing)
-        {
-            QMutexLocker locker(&waiterMutex);
-            waiter.wait(&waiterMutex, 10);
+        // Set the state before checking the buffers to not miss the wake up
+        demuxerState = DemuxerBufferFull;
+        const auto policy = currentBufferingPolicy();
+        // Live mode drops the packets instead of pausing the source
+        const bool full = updateBufferingProgress(policy) > policy.highWatermark() && !liveActive;
+        if (full || !startDemuxing) {
+            parkDemuxer();
             continue;
         }
+        demuxerState = DemuxerRunning;
+        // Small packets should not block the demuxer on one full ring before the policy is reached
+        const int capacity = !liveActive && hasBufferingLimits(policy) ? MaxQueueCapacity : QueueCapacity;
+        videoQueue.setMaxCapacity(capacity);
+        audioQueue.setMaxCapacity(capacity);
+        subtitleQueue.setMaxCapacity(capacity);
 
         {
             QMutexLocker locker(&positionMutex);
@@ -631,15 +1048,7 @@ void QAVPlayerPrivate::doDemux()
                 qCDebug(lcAVPlayer) << "Seeking to pos:" << pos * 1000;
                 int ret = demuxer.seek(pos);
                 if (ret >= 0) {
-                    qCDebug(lcAVPlayer) << "Waiting video thread finished processing packets";
-                    videoQueue.waitForEmpty();
-                    videoClock.clear();
-                    qCDebug(lcAVPlayer) << "Waiting audio thread finished processing packets";
-                    audioQueue.waitForEmpty();
-                    audioClock.clear();
-                    subtitleQueue.clear();
-                    qCDebug(lcAVPlayer) << "Flush codec buffers";
-                    demuxer.flushCodecBuffers();
+                    flushQueues();
                     qCDebug(lcAVPlayer) << "Reset filters";
                     resetFilters = true;
                     applyFilters({});
@@ -658,6 +1067,12 @@ void QAVPlayerPrivate::doDemux()
         if (packet.stream()) {
             muxer.write(packet);
             endOfFile(false);
+            if (liveActive && !liveReadPacket(packet))
+                continue;
+            if (auto m = metrics.stream(packet.stream().stream()->codecpar->codec_type)) {
+                QAVMetrics::Stream::inc(m->packetsRead);
+                QAVMetrics::Stream::inc(m->bytesRead, std::as_const(packet).packet()->size);
+            }
             // Empty packet points to EOF and it needs to flush codecs
             switch (packet.stream().stream()->codecpar->codec_type) {
             case AVMEDIA_TYPE_VIDEO:
@@ -677,10 +1092,13 @@ void QAVPlayerPrivate::doDemux()
                 setError(QAVPlayer::ResourceError, err_str(ret));
                 break;
             }
+            auto queuesEmpty = [this] {
+                return videoQueue.isEmpty()
+                    && audioQueue.isEmpty()
+                    && subtitleQueue.isEmpty();
+            };
             if (demuxer.eof()
-                && videoQueue.isEmpty()
-                && audioQueue.isEmpty()
-                && subtitleQueue.isEmpty()
+                && queuesEmpty()
                 && filters.isEmpty()
                 && !isEndOfFile())
             {
@@ -693,10 +1111,21 @@ void QAVPlayerPrivate::doDemux()
                 muxer.flush();
             }
 
-            QMutexLocker locker(&waiterMutex);
-            waiter.wait(&waiterMutex, 10);
+            // No packets but not EOF: the bitstream filters need more input
+            if (!demuxer.eof())
+                continue;
+            liveBuffering = false;
+            wakeClocks();
+
+            // Wait until the queues and the filters are drained, or seek or stop is requested
+            demuxerState = DemuxerEndOfFile;
+            if (isEndOfFile() || !queuesEmpty() || !filters.isEmpty())
+                parkDemuxer();
+            else
+                demuxerState = DemuxerRunning;
         }
     }
+    demuxerState = DemuxerRunning;
     qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
 }
 
@@ -726,6 +1155,8 @@ bool QAVPlayerPrivate::skipFrame(
     const QAVStreamFrame &frame,
     bool isEmpty)
 {
+    // Only keyframes are decoded, so seeking stops at them
+    const bool keyFramesOnly = videoQueue.skipFrame() >= AVDISCARD_NONKEY;
     QMutexLocker locker(&positionMutex);
     bool result = pendingSeek;
     if (!pendingSeek && pendingPosition > 0) {
@@ -743,7 +1174,7 @@ bool QAVPlayerPrivate::skipFrame(
             // but frame number points to the latest frame.
             lastFrame = isLastFrame(frame, demuxer);
         }
-        result = pos < requestedPos && !isQueueEOF && !lastFrame;
+        result = !keyFramesOnly && pos < requestedPos && !isQueueEOF && !lastFrame;
         if (master) {
             if (result)
                 qCDebug(lcAVPlayer) << __FUNCTION__ << pos << "<" << requestedPos;
@@ -755,6 +1186,120 @@ bool QAVPlayerPrivate::skipFrame(
     return result;
 }
 
+qreal QAVPlayerPrivate::playbackSpeed() const
+{
+    return q_ptr->speed() * (liveCatchUp ? LiveCatchUpSpeed : 1.0);
+}
+
+// Position played by the audio device if known, otherwise pts of the last sent audio frame
+double QAVPlayerPrivate::audioTime() const
+{
+    QAVGuardedPointer<QAVClock>::Ref device(audioDeviceClock);
+    const double time = device ? device->time() : -1;
+    return time >= 0 ? time : audioClock.pts();
+}
+
+// Time of the master clock the frames of the media type are synchronized with, -1 if not synchronized
+double QAVPlayerPrivate::masterTime(AVMediaType type) const
+{
+    const bool hasVideo = !demuxer.currentVideoStreams().isEmpty();
+    const bool hasAudio = !demuxer.currentAudioStreams().isEmpty();
+    // Subtitles follow the presentation
+    if (type == AVMEDIA_TYPE_SUBTITLE)
+        return hasVideo ? videoClock.pts() : hasAudio ? audioTime() : -1;
+
+    switch (QAVPlayer::MasterClock(masterClock.load())) {
+        case QAVPlayer::AutoClock:
+        case QAVPlayer::AudioClock:
+            return type == AVMEDIA_TYPE_VIDEO && hasAudio ? audioTime() : -1;
+        case QAVPlayer::VideoClock:
+            return type == AVMEDIA_TYPE_AUDIO && hasVideo ? videoClock.pts() : -1;
+        case QAVPlayer::ExternalClock:
+        {
+            QAVGuardedPointer<QAVClock>::Ref clock(externalClock);
+            return clock ? clock->time() : -1;
+        }
+        default:
+            return -1;
+    }
+}
+
+// Drops all the queued packets and frames, called by the demuxer thread
+void QAVPlayerPrivate::flushQueues()
+{
+    qCDebug(lcAVPlayer) << "Waiting video thread finished processing packets";
+    videoQueue.waitForEmpty();
+    videoClock.clear();
+    frameCache.clear();
+    qCDebug(lcAVPlayer) << "Waiting audio thread finished processing packets";
+    audioQueue.waitForEmpty();
+    audioClock.clear();
+    audioTempoReset = true;
+    subtitleQueue.clear();
+    qCDebug(lcAVPlayer) << "Flush codec buffers";
+    demuxer.flushCodecBuffers();
+}
+
+// Called by the demuxer thread in live mode, returns false if the packet should be dropped
+bool QAVPlayerPrivate::liveReadPacket(const QAVPacket &packet)
+{
+    const auto type = packet.stream().stream()->codecpar->codec_type;
+    const bool master = (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO)
+        && demuxer.isMasterStream(packet.stream());
+    if (!master || packet.packet()->pts == AV_NOPTS_VALUE)
+        return !liveWaitKeyFrame;
+
+    const double pts = packet.pts();
+    const double presented = livePresentedPts;
+    if (isnan(liveFirstPts))
+        liveFirstPts = pts;
+    const double latency = qMax(0.0, pts - (!isnan(presented) ? presented : liveFirstPts));
+    liveLatency = qint64(latency * 1000);
+
+    const double now = av_gettime_relative() / 1000000.0;
+    const double target = liveLatencyTarget / 1000.0;
+    const bool playing = q_ptr->state() == QAVPlayer::PlayingState;
+    auto &queue = type == AVMEDIA_TYPE_VIDEO ? videoQueue : audioQueue;
+    if (playing && !liveBuffering && !liveWaitKeyFrame && queue.isEmpty()) {
+        liveJitterBuffer = qMin(qMax(liveJitterBuffer, target) * 1.5, LiveMaxJitterBuffer);
+        liveStableSince = now;
+        liveBuffering = true;
+        qCDebug(lcAVPlayer) << "Live buffer underrun, jitter buffer:" << liveJitterBuffer;
+    } else if (now - liveStableSince > LiveStablePeriod) {
+        liveJitterBuffer = qMax(target, liveJitterBuffer * 0.9);
+        liveStableSince = now;
+    }
+
+    if (playing && latency > qMax(liveJitterBuffer * LiveMaxLatencyFactor, liveJitterBuffer + 1.0)) {
+        qCDebug(lcAVPlayer) << "Live latency" << latency << "sec, dropping to next keyframe";
+        flushQueues();
+        livePresentedPts = NAN;
+        liveFirstPts = NAN;
+        liveCatchUp = false;
+        liveBuffering = true;
+        liveWaitKeyFrame = true;
+    }
+
+    if (liveWaitKeyFrame) {
+        if (!(packet.packet()->flags & AV_PKT_FLAG_KEY))
+            return false;
+        liveWaitKeyFrame = false;
+        liveFirstPts = pts;
+    }
+
+    if (liveBuffering && latency >= liveJitterBuffer) {
+        qCDebug(lcAVPlayer) << "Live buffer filled:" << latency;
+        liveBuffering = false;
+        wakeClocks();
+    }
+    const bool catchUp = liveCatchUp ? latency > liveJitterBuffer : latency > liveJitterBuffer * 1.5;
+    if (catchUp != liveCatchUp) {
+        qCDebug(lcAVPlayer) << "Live catching up:" << catchUp << ", latency:" << latency;
+        liveCatchUp = catchUp;
+    }
+    return true;
+}
+
 void QAVPlayerPrivate::doPlayStep(
     bool &master,
     double refPts,
@@ -764,9 +1309,19 @@ void QAVPlayerPrivate::doPlayStep(
     const std::function<void(const QAVFrame &frame)> &cb)
 {
     doWait();
+    // Live mode fills the jitter buffer before presenting,
+    // the demuxer wakes the clocks when it is filled and the state changes wake them too
+    if (liveBuffering) {
+        // The statuses which don't need a frame, f.e. stopping, are not delayed by buffering
+        if (master)
+            step(false);
+        clock.idle(liveBuffering, LiveBufferingWait);
+        return;
+    }
+    auto m = metrics.stream(queue.mediaType());
 
     // 1. Decode a frame
-    QAVFrame decodedFrame;
+    QAVFrame decodedFrame = emptyFrame;
     queue.frontFrame(decodedFrame);
     // If no decoded frames, it still needs to drain filters by filters.read
     bool flushEvents = false;
@@ -776,9 +1331,23 @@ void QAVPlayerPrivate::doPlayStep(
     if (decodedFrame)
         master = demuxer.isMasterStream(decodedFrame.stream());
 
+    // Late video frames are not filtered and sent to catch up the audio
+    if (decodedFrame && queue.mediaType() == AVMEDIA_TYPE_VIDEO && dropLateFrame(decodedFrame, refPts)) {
+        frameCache.clear();
+        QAVMetrics::Stream::inc(m->framesDropped);
+        Q_EMIT q_ptr->videoFrameDropped(decodedFrame.pts());
+        if (master)
+            step(false);
+        queue.popFrame();
+        return;
+    }
+
     // 2. Filter decoded frame
-    QList<QAVFrame> filteredFrames;
+    auto &filteredFrames = queue.mediaType() == AVMEDIA_TYPE_VIDEO ? videoFilteredFrames : audioFilteredFrames;
+    filteredFrames.clear();
     bool nextFrame = false;
+    QElapsedTimer filterTimer;
+    filterTimer.start();
     if (decodedFrame) {
         // Create filters if not yet created.
         // Filters should be applied after all codecs are negotiated
@@ -796,6 +1365,8 @@ void QAVPlayerPrivate::doPlayStep(
     }
     if (ret >= 0 || ret == AVERROR(EAGAIN))
         ret = filters.read(queue.mediaType(), decodedFrame, filteredFrames);
+    if (decodedFrame)
+        m->filterTime.add(filterTimer.nsecsElapsed() / 1000);
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
         // Try filters again
         filteredFrames.clear();
@@ -811,29 +1382,58 @@ void QAVPlayerPrivate::doPlayStep(
     }
 
     // 3. Sync filtered frames
-    while (!quit && !filteredFrames.isEmpty()) {
-        auto &frame = filteredFrames.front();
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+    size_t filteredIndex = 0;
+    while (!quit && filteredIndex < filteredFrames.size()) {
+        auto &frame = filteredFrames[filteredIndex];
         Q_ASSERT(frame);
+        // The frames are not waited for if they are skipped by seeking
         if (clock.wait(
-                synced ? sync : synced,
+                synced ? sync && !isSeeking() : synced,
                 frame.pts(),
-                q_ptr->speed(),
+                qAbs(playbackSpeed()),
                 refPts))
         {
+            m->clockWaitTime.add(waitTimer.nsecsElapsed() / 1000);
+            waitTimer.restart();
+            const double jitter = clock.jitter();
+            if (jitter >= 0)
+                m->presentationJitter.add(qint64(jitter * 1000000));
             sync = !skipFrame(master, frame, queue.isEmpty());
+            // Skipped frames are cached too, so stepping backward after seek does not decode them again.
+            // The frames dropped by trick play would make gaps.
+            if (queue.mediaType() == AVMEDIA_TYPE_VIDEO) {
+                if (queue.skipFrame() == AVDISCARD_DEFAULT)
+                    frameCache.insert(frame);
+                else
+                    frameCache.clear();
+            }
             if (sync) {
-                if (master)
+                if (master) {
                     setPts(frame.pts());
+                    if (liveActive)
+                        livePresentedPts = frame.pts();
+                }
                 if (!flushEvents)
                     flushEvents = true;
                 cb(frame);
                 demuxer.onFrameSent(frame);
+                QAVMetrics::Stream::inc(m->framesSent);
+                if (clock.isLate())
+                    QAVMetrics::Stream::inc(m->framesLate);
+                if (queue.mediaType() == AVMEDIA_TYPE_VIDEO && refPts > 0)
+                    metrics.setAvDrift(frame.pts() - refPts);
+            } else {
+                QAVMetrics::Stream::inc(m->framesDropped);
             }
-            filteredFrames.pop_front();
+            ++filteredIndex;
         } else {
             flushEvents = isLastFrame(frame, demuxer);
         }
     }
+    // Don't keep the references to the data
+    filteredFrames.clear();
 
     if (master)
         step(flushEvents);
@@ -846,20 +1446,108 @@ void QAVPlayerPrivate::doPlayStep(
         queue.popFrame();
 }
 
+bool QAVPlayerPrivate::doPlayCachedFrame(
+    bool &master,
+    const std::function<void(const QAVFrame &frame)> &cb)
+{
+    doWait();
+    if (quit || isSkipping())
+        return false;
+
+    const qreal rate = q_ptr->speed();
+    const bool stepping = reverseStep;
+    const bool reverse = stepping || (rate < 0 && q_ptr->state() == QAVPlayer::PlayingState);
+    if (reverse && !playingBackward)
+        reverseClock.clear();
+    else if (!reverse && playingBackward)
+        videoClock.clear();
+    playingBackward = reverse;
+
+    QAVFrame frame = emptyFrame;
+    if (reverse) {
+        if (!frameCache.previous(frame)) {
+            const double cached = frameCache.position();
+            const double from = !isnan(cached) ? cached : pts();
+            // Nothing has been decoded before the frame
+            if (from <= 0 || from == reverseSeekFrom) {
+                qCDebug(lcAVPlayer) << "Reached the beginning while playing backward";
+                reverseSeekFrom = NAN;
+                reverseStep = false;
+                if (!stepping)
+                    q_ptr->pause();
+                step(true);
+                return true;
+            }
+
+            // Decode the previous frames from the keyframe, they are cached while skipping,
+            // and the frame at the position is the result of the step.
+            reverseSeekFrom = from;
+            reverseStep = false;
+            const double pos = qMax(0.0, from - 1.5 * demuxer.videoFrameRate());
+            qCDebug(lcAVPlayer) << "Decoding backward from" << from << "to" << pos;
+            {
+                QMutexLocker locker(&positionMutex);
+                pendingSeek = true;
+                pendingPosition = pos;
+            }
+            wakeDemuxer();
+            return false;
+        }
+        // Mirror pts to keep them increasing
+        if (!stepping && !reverseClock.wait(synced, ReversePtsBase - frame.pts(), -rate))
+            return true;
+        reverseStep = false;
+    } else {
+        if (!frameCache.next(frame))
+            return false;
+        if (!videoClock.wait(synced, frame.pts(), qAbs(rate)))
+            return true;
+    }
+
+    reverseSeekFrom = NAN;
+    frameCache.setCursor(frame.pts());
+    master = true;
+    setPts(frame.pts());
+    cb(frame);
+    demuxer.onFrameSent(frame);
+    QAVMetrics::Stream::inc(metrics.stream(AVMEDIA_TYPE_VIDEO)->framesSent);
+    step(true);
+    return true;
+}
+
+void QAVPlayerPrivate::doDecodeVideo()
+{
+    while (!quit)
+        videoQueue.decode();
+    qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
+}
+
+void QAVPlayerPrivate::doDecodeAudio()
+{
+    while (!quit)
+        audioQueue.decode();
+    qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
+}
+
 void QAVPlayerPrivate::doPlayVideo()
 {
     videoClock.setFrameRate(demuxer.videoFrameRate());
+    reverseClock.setFrameRate(demuxer.videoFrameRate());
     bool master = true;
     bool sync = true;
+    auto cb = [&](const QAVFrame &frame) { sendVideoFrame(frame); };
 
     while (!quit) {
+        // Stepping and playing backward, or forward again after that
+        if (doPlayCachedFrame(master, cb))
+            continue;
         doPlayStep(
             master,
-            !demuxer.currentAudioStreams().isEmpty() ? audioClock.pts() : -1,
+            masterTime(AVMEDIA_TYPE_VIDEO),
             videoClock,
             videoQueue,
             sync,
-            [&](const QAVFrame &frame) { Q_EMIT q_ptr->videoFrame(frame); }
+            cb
         );
     }
 
@@ -872,25 +1560,50 @@ void QAVPlayerPrivate::doPlayVideo()
 void QAVPlayerPrivate::doPlayAudio()
 {
     bool master = false;
-    const double ref = -1;
     bool sync = true;
 
     while (!quit) {
         doPlayStep(
             master,
-            ref,
+            masterTime(AVMEDIA_TYPE_AUDIO),
             audioClock,
             audioQueue,
             sync,
             [this](const QAVFrame &frame) {
-                frame.frame()->sample_rate *= q_ptr->speed();
-                Q_EMIT q_ptr->audioFrame(frame);
+                // Muted while playing backward
+                const qreal speed = playbackSpeed();
+                if (speed < 0)
+                    return;
+                // The samples before the seek are not played
+                if (audioTempoReset.exchange(false))
+                    audioTempo.reset();
+                if (speed == 1.0) {
+                    // The stretched samples go before the normal ones
+                    audioTempo.flush([this](const QAVFrame &f) { sendAudioFrame(f); });
+                    sendAudioFrame(frame);
+                    return;
+                }
+                // Keeps the pitch and the sample rate, so the audio output is not recreated
+                const int ret = audioTempo.process(frame, speed, [this](const QAVFrame &f) { sendAudioFrame(f); });
+                if (ret >= 0)
+                    return;
+                // Falls back to changing the sample rate
+                // The frame is shared with the filters and the cache, frame() detaches the copy
+                QAVFrame f = frame;
+                f.frame()->sample_rate *= speed;
+                sendAudioFrame(f);
             }
         );
+        if (audioTempoReset.exchange(false))
+            audioTempo.reset();
+        // No more frames will be stretched, the samples kept by atempo are sent
+        if (audioTempo.isActive() && demuxer.eof() && audioQueue.isEmpty() && filters.isEmpty())
+            audioTempo.flush([this](const QAVFrame &f) { sendAudioFrame(f); });
     }
 
     audioQueue.clear();
     audioClock.clear();
+    audioTempo.reset();
     if (master)
         setMediaStatus(QAVPlayer::NoMedia);
     qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
@@ -918,9 +1631,13 @@ void QAVPlayerPrivate::doPlayStep(
             refPts))
     {
         sync = !skipFrame(false, decodedFrame, queue.isEmpty());
+        auto m = metrics.stream(AVMEDIA_TYPE_SUBTITLE);
         if (sync && decodedFrame) {
             cb(decodedFrame);
             demuxer.onFrameSent(decodedFrame);
+            QAVMetrics::Stream::inc(m->framesSent);
+        } else {
+            QAVMetrics::Stream::inc(m->framesDropped);
         }
         queue.popFrame();
     }
@@ -931,15 +1648,11 @@ void QAVPlayerPrivate::doPlaySubtitle()
     bool sync = true;
     while (!quit) {
         doPlayStep(
-            !demuxer.currentVideoStreams().isEmpty()
-            ? videoClock.pts()
-            : !demuxer.currentAudioStreams().isEmpty()
-              ? audioClock.pts()
-              : -1,
+            masterTime(AVMEDIA_TYPE_SUBTITLE),
             subtitleClock,
             subtitleQueue,
             sync,
-            [this](const QAVSubtitleFrame &frame) { Q_EMIT q_ptr->subtitleFrame(frame); }
+            [this](const QAVSubtitleFrame &frame) { sendSubtitleFrame(frame); }
         );
     }
 
@@ -957,7 +1670,16 @@ QAVPlayer::QAVPlayer(QObject *parent)
     qRegisterMetaType<State>();
     qRegisterMetaType<MediaStatus>();
     qRegisterMetaType<Error>();
+    qRegisterMetaType<FrameDropPolicy>();
+    qRegisterMetaType<MasterClock>();
     qRegisterMetaType<QAVStream>();
+    qRegisterMetaType<QAVPlayerMetrics>();
+    qRegisterMetaType<QAVFramePoolOptions>();
+
+    Q_D(QAVPlayer);
+    QObject::connect(&d->metricsTimer, &QTimer::timeout, this, [this] {
+        Q_EMIT metricsChanged(metrics());
+    });
 }
 
 QAVPlayer::~QAVPlayer()
@@ -1149,8 +1871,13 @@ void QAVPlayer::play()
     qCDebug(lcAVPlayer) << __FUNCTION__;
     if (d->setState(QAVPlayer::PlayingState)) {
         if (d->isEndOfFile()) {
-            qCDebug(lcAVPlayer) << "Playing from beginning";
-            seek(0);
+            if (speed() < 0) {
+                qCDebug(lcAVPlayer) << "Playing backward from the end";
+                d->setMediaStatus(QAVPlayer::LoadedMedia);
+            } else {
+                qCDebug(lcAVPlayer) << "Playing from beginning";
+                seek(0);
+            }
         }
         d->setPendingMediaStatus(PlayingMedia);
     }
@@ -1223,8 +1950,13 @@ void QAVPlayer::stepBackward()
 
     qCDebug(lcAVPlayer) << __FUNCTION__;
     d->setState(QAVPlayer::PausedState);
-    const qint64 pos = d->pts() > 0 ? (d->pts() - videoFrameRate()) * 1000 : duration();
-    seek(pos);
+    // The previous frame is already decoded
+    if (!d->isSkipping() && d->frameCache.hasPrevious()) {
+        d->reverseStep = true;
+    } else {
+        const qint64 pos = d->pts() > 0 ? (d->pts() - videoFrameRate()) * 1000 : duration();
+        seek(pos);
+    }
     d->setPendingMediaStatus(SteppingMedia);
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
@@ -1288,6 +2020,8 @@ void QAVPlayer::setSpeed(qreal r)
         qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->speed << "->" << r;
         d->speed = r;
     }
+    d->applySkipFrame();
+    d->wakeClocks();
     Q_EMIT speedChanged(r);
 }
 
@@ -1382,9 +2116,47 @@ void QAVPlayer::setSynced(bool sync)
         return;
 
     d->synced = sync;
+    d->wakeClocks();
     Q_EMIT syncedChanged(sync);
 }
 
+bool QAVPlayer::isTrickPlay() const
+{
+    return d_func()->trickPlay;
+}
+
+void QAVPlayer::setTrickPlay(bool enabled)
+{
+    Q_D(QAVPlayer);
+    if (d->trickPlay == enabled)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->trickPlay << "->" << enabled;
+    d->trickPlay = enabled;
+    d->applySkipFrame();
+    Q_EMIT trickPlayChanged(enabled);
+}
+
+QAVPlayer::FrameDropPolicy QAVPlayer::frameDropPolicy() const
+{
+    return FrameDropPolicy(d_func()->frameDropPolicy.load());
+}
+
+void QAVPlayer::setFrameDropPolicy(FrameDropPolicy policy)
+{
+    Q_D(QAVPlayer);
+    if (d->frameDropPolicy == policy)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << FrameDropPolicy(d->frameDropPolicy.load()) << "->" << policy;
+    d->frameDropPolicy = policy;
+    if (policy != DropLateFramesAndSkipDecoding) {
+        d->decodingBehind = false;
+        d->applySkipFrame();
+    }
+    Q_EMIT frameDropPolicyChanged(policy);
+}
+
 QString QAVPlayer::inputFormat() const
 {
     Q_D(const QAVPlayer);
@@ -1463,6 +2235,202 @@ void QAVPlayer::setVideoCodecOptions(const QMap<QString, QString> &opts)
     Q_EMIT videoCodecOptionsChanged(opts);
 }
 
+QAVCodecThreading QAVPlayer::codecThreading(int streamIndex) const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.codecThreading(streamIndex);
+}
+
+void QAVPlayer::setCodecThreading(const QAVCodecThreading &threading, int streamIndex)
+{
+    Q_D(QAVPlayer);
+
+    auto current = codecThreading(streamIndex);
+    if (threading == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << streamIndex << ":" << current << "->" << threading;
+    d->demuxer.setCodecThreading(threading, streamIndex);
+    Q_EMIT codecThreadingChanged(threading, streamIndex);
+}
+
+QAVFramePoolOptions QAVPlayer::framePoolOptions() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.framePoolOptions();
+}
+
+void QAVPlayer::setFramePoolOptions(const QAVFramePoolOptions &options)
+{
+    Q_D(QAVPlayer);
+
+    auto current = framePoolOptions();
+    if (options == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << options;
+    d->demuxer.setFramePoolOptions(options);
+    Q_EMIT framePoolOptionsChanged(options);
+}
+
+qint64 QAVPlayer::probeSize() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.probeSize();
+}
+
+void QAVPlayer::setProbeSize(qint64 bytes)
+{
+    Q_D(QAVPlayer);
+    if (bytes == probeSize())
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << probeSize() << "->" << bytes;
+    d->demuxer.setProbeSize(bytes);
+    Q_EMIT probeSizeChanged(bytes);
+}
+
+qint64 QAVPlayer::analyzeDuration() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.analyzeDuration();
+}
+
+void QAVPlayer::setAnalyzeDuration(qint64 ms)
+{
+    Q_D(QAVPlayer);
+    if (ms == analyzeDuration())
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << analyzeDuration() << "->" << ms;
+    d->demuxer.setAnalyzeDuration(ms);
+    Q_EMIT analyzeDurationChanged(ms);
+}
+
+bool QAVPlayer::isFastOpen() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.isFastOpen();
+}
+
+void QAVPlayer::setFastOpen(bool enabled)
+{
+    Q_D(QAVPlayer);
+    if (enabled == isFastOpen())
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << isFastOpen() << "->" << enabled;
+    d->demuxer.setFastOpen(enabled);
+    Q_EMIT fastOpenChanged(enabled);
+}
+
+bool QAVPlayer::isSharedDecoding() const
+{
+    return d_func()->sharedDecoding;
+}
+
+void QAVPlayer::setSharedDecoding(bool enabled)
+{
+    Q_D(QAVPlayer);
+    if (d->sharedDecoding == enabled)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->sharedDecoding << "->" << enabled;
+    d->sharedDecoding = enabled;
+    Q_EMIT sharedDecodingChanged(enabled);
+}
+
+bool QAVPlayer::isLiveMode() const
+{
+    return d_func()->liveMode;
+}
+
+void QAVPlayer::setLiveMode(bool enabled)
+{
+    Q_D(QAVPlayer);
+    if (d->liveMode == enabled)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->liveMode.load() << "->" << enabled;
+    d->liveMode = enabled;
+    d->demuxer.setLowLatency(enabled);
+    Q_EMIT liveModeChanged(enabled);
+}
+
+qint64 QAVPlayer::liveLatencyTarget() const
+{
+    return d_func()->liveLatencyTarget;
+}
+
+void QAVPlayer::setLiveLatencyTarget(qint64 ms)
+{
+    Q_D(QAVPlayer);
+    ms = qMax<qint64>(ms, 0);
+    if (d->liveLatencyTarget == ms)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->liveLatencyTarget.load() << "->" << ms;
+    d->liveLatencyTarget = ms;
+    Q_EMIT liveLatencyTargetChanged(ms);
+}
+
+qint64 QAVPlayer::liveLatency() const
+{
+    return d_func()->liveLatency;
+}
+
+QAVPlayer::MasterClock QAVPlayer::masterClock() const
+{
+    return MasterClock(d_func()->masterClock.load());
+}
+
+void QAVPlayer::setMasterClock(MasterClock clock)
+{
+    Q_D(QAVPlayer);
+    if (d->masterClock == clock)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << MasterClock(d->masterClock.load()) << "->" << clock;
+    d->masterClock = clock;
+    d->wakeClocks();
+    Q_EMIT masterClockChanged(clock);
+}
+
+QAVClock *QAVPlayer::externalClock() const
+{
+    return d_func()->externalClock.load();
+}
+
+void QAVPlayer::setExternalClock(QAVClock *clock)
+{
+    Q_D(QAVPlayer);
+    d->externalClock.set(clock);
+    d->wakeClocks();
+}
+
+QAVClock *QAVPlayer::audioDeviceClock() const
+{
+    return d_func()->audioDeviceClock.load();
+}
+
+void QAVPlayer::setAudioDeviceClock(QAVClock *clock)
+{
+    Q_D(QAVPlayer);
+    d->audioDeviceClock.set(clock);
+    d->wakeClocks();
+}
+
+QAVFrameSink *QAVPlayer::frameSink() const
+{
+    return d_func()->frameSink.load();
+}
+
+void QAVPlayer::setFrameSink(QAVFrameSink *sink)
+{
+    Q_D(QAVPlayer);
+    d->frameSink.set(sink);
+}
+
 /*!
  * \brief Use to set log level of FFmpeg backend
  * \param[in] level
@@ -1485,6 +2453,76 @@ QList<QAVChapter> QAVPlayer::chapters() const
     return d_func()->demuxer.chapters();
 }
 
+qint64 QAVPlayer::frameCacheSize() const
+{
+    return d_func()->frameCache.maxBytes();
+}
+
+void QAVPlayer::setFrameCacheSize(qint64 bytes)
+{
+    Q_D(QAVPlayer);
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->frameCache.maxBytes() << "->" << bytes;
+    d->frameCache.setMaxBytes(bytes);
+}
+
+QAVBufferingPolicy QAVPlayer::bufferingPolicy() const
+{
+    return d_func()->currentBufferingPolicy();
+}
+
+void QAVPlayer::setBufferingPolicy(const QAVBufferingPolicy &policy)
+{
+    Q_D(QAVPlayer);
+    {
+        QMutexLocker locker(&d->bufferingMutex);
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->bufferingPolicy << "->" << policy;
+        d->bufferingPolicy = policy;
+    }
+    // Let the demuxer check the new limits
+    d->wakeDemuxer();
+}
+
+qreal QAVPlayer::bufferingProgress() const
+{
+    return d_func()->bufferingPercent / 100.0;
+}
+
+QAVPlayerMetrics QAVPlayer::metrics() const
+{
+    Q_D(const QAVPlayer);
+    auto m = d->metrics.snapshot();
+    auto &video = m.stream(QAVPlayerMetrics::Video);
+    video.packetsBuffered = d->videoQueue.size();
+    video.bytesBuffered = d->videoQueue.bytes();
+    auto &audio = m.stream(QAVPlayerMetrics::Audio);
+    audio.packetsBuffered = d->audioQueue.size();
+    audio.bytesBuffered = d->audioQueue.bytes();
+    auto &subtitle = m.stream(QAVPlayerMetrics::Subtitle);
+    subtitle.packetsBuffered = d->subtitleQueue.size();
+    subtitle.bytesBuffered = d->subtitleQueue.bytes();
+    m.setFramePool(d->demuxer.framePoolStats());
+    return m;
+}
+
+int QAVPlayer::metricsInterval() const
+{
+    Q_D(const QAVPlayer);
+    return d->metricsTimer.isActive() ? d->metricsTimer.interval() : 0;
+}
+
+void QAVPlayer::setMetricsInterval(int ms)
+{
+    Q_D(QAVPlayer);
+    if (metricsInterval() == ms)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << ms;
+    if (ms > 0)
+        d->metricsTimer.start(ms);
+    else
+        d->metricsTimer.stop();
+}
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug dbg, QAVPlayer::State state)
 {
@@ -1563,6 +2601,40 @@ QDebug operator<<(QDebug dbg, QAVPlayer::Error err)
             return dbg << QString(QLatin1String("UserType(%1)" )).arg(int(err)).toLatin1().constData();
     }
 }
+
+QDebug operator<<(QDebug dbg, QAVPlayer::MasterClock clock)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace();
+    switch (clock) {
+        case QAVPlayer::AutoClock:
+            return dbg << "AutoClock";
+        case QAVPlayer::AudioClock:
+            return dbg << "AudioClock";
+        case QAVPlayer::VideoClock:
+            return dbg << "VideoClock";
+        case QAVPlayer::ExternalClock:
+            return dbg << "ExternalClock";
+        default:
+            return dbg << QString(QLatin1String("UserType(%1)" )).arg(int(clock)).toLatin1().constData();
+    }
+}
+
+QDebug operator<<(QDebug dbg, QAVPlayer::FrameDropPolicy policy)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace();
+    switch (policy) {
+        case QAVPlayer::NoFrameDrop:
+            return dbg << "NoFrameDrop";
+        case QAVPlayer::DropLateFrames:
+            return dbg << "DropLateFrames";
+        case QAVPlayer::DropLateFramesAndSkipDecoding:
+            return dbg << "DropLateFramesAndSkipDecoding";
+        default:
+            return dbg << QString(QLatin1String("UserType(%1)" )).arg(int(policy)).toLatin1().constData();
+    }
+}
 #endif
 
 Q_DECLARE_METATYPE(PendingMediaStatus)
@@ -13,6 +13,12 @@
 #include <QtAVPlayer/qavsubtitleframe.h>
 #include <QtAVPlayer/qavstream.h>
 #include <QtAVPlayer/qavchapter.h>
+#include <QtAVPlayer/qavbufferingpolicy.h>
+#include <QtAVPlayer/qavcodecthreading.h>
+#include <QtAVPlayer/qavframepool.h>
+#include <QtAVPlayer/qavplayermetrics.h>
+#include <QtAVPlayer/qavclock.h>
+#include <QtAVPlayer/qavframesink.h>
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QString>
 #include <memory>
@@ -28,6 +34,8 @@ class Q_AVPLAYER_EXPORT QAVPlayer : public QObject
     Q_ENUMS(State)
     Q_ENUMS(MediaStatus)
     Q_ENUMS(Error)
+    Q_ENUMS(FrameDropPolicy)
+    Q_ENUMS(MasterClock)
 
 public:
     enum State
@@ -54,6 +62,25 @@ public:
         MuxerError
     };
 
+    enum FrameDropPolicy
+    {
+        NoFrameDrop,
+        DropLateFrames,
+        DropLateFramesAndSkipDecoding
+    };
+
+    enum MasterClock
+    {
+        // Audio if available, otherwise video
+        AutoClock,
+        // Video follows the audio
+        AudioClock,
+        // Audio follows the video
+        VideoClock,
+        // Video and audio follow externalClock()
+        ExternalClock
+    };
+
     QAVPlayer(QObject *parent = nullptr);
     ~QAVPlayer();
 
@@ -107,6 +134,22 @@ public:
     bool isSynced() const;
     void setSynced(bool sync);
 
+    /**
+     * Decodes less frames when playing fast: drops non-reference frames from 2x,
+     * and decodes only keyframes from 4x, seeking stops at the keyframes then.
+     * Disabled by default, all frames are decoded.
+     */
+    bool isTrickPlay() const;
+    void setTrickPlay(bool enabled);
+
+    /**
+     * Drops the decoded video frames which are behind the audio clock before they are filtered and sent,
+     * and makes the decoder skip non-reference frames and deblocking if the video is still late.
+     * Disabled by default, the late frames are sent without delay.
+     */
+    FrameDropPolicy frameDropPolicy() const;
+    void setFrameDropPolicy(FrameDropPolicy policy);
+
     QString inputFormat() const;
     void setInputFormat(const QString &format);
 
@@ -126,6 +169,92 @@ public:
     QMap<QString, QString> videoCodecOptions() const;
     void setVideoCodecOptions(const QMap<QString, QString> &opts);
 
+    /**
+     * Threading of the decoders, applied when the source is loaded.
+     * Stream index -1 sets the default for all the streams.
+     * `threads` and `thread_type` from videoCodecOptions() take precedence.
+     */
+    QAVCodecThreading codecThreading(int streamIndex = -1) const;
+    void setCodecThreading(const QAVCodecThreading &threading, int streamIndex = -1);
+
+    /**
+     * Pool of the decoded video frames, applied when the source is loaded.
+     * Allows to decode to the memory provided by QAVFrameAllocator,
+     * the stats are returned in metrics().
+     */
+    QAVFramePoolOptions framePoolOptions() const;
+    void setFramePoolOptions(const QAVFramePoolOptions &options);
+
+    /**
+     * Limits of probing the streams when the source is loaded:
+     * max bytes and duration in milliseconds, 0 keeps the defaults of FFmpeg.
+     */
+    qint64 probeSize() const;
+    void setProbeSize(qint64 bytes);
+    qint64 analyzeDuration() const;
+    void setAnalyzeDuration(qint64 ms);
+
+    /**
+     * Probes less data on load and skips probing of the sources
+     * which have been already loaded, the stream info is restored from the cache.
+     */
+    bool isFastOpen() const;
+    void setFastOpen(bool enabled);
+
+    /**
+     * The decoders of all the players run as tasks on one pool of threads sized to the number of cores,
+     * instead of two own threads of each player. Disabled by default unless QT_AVPLAYER_SHARED_DECODER=1,
+     * applied when the source is loaded.
+     */
+    bool isSharedDecoding() const;
+    void setSharedDecoding(bool enabled);
+
+    /**
+     * Low latency playback of live sources, applied when the source is loaded.
+     * The packets are not buffered by FFmpeg, and the playback starts when the jitter buffer is filled,
+     * which grows on underruns and shrinks back to the target latency when the source is stable.
+     * If the latency exceeds the jitter buffer the playback is sped up,
+     * and if it is too far behind, the queued packets are dropped up to the next keyframe.
+     * The demuxer is not paused by bufferingPolicy() in live mode.
+     */
+    bool isLiveMode() const;
+    void setLiveMode(bool enabled);
+    // Target latency in milliseconds, 200 by default
+    qint64 liveLatencyTarget() const;
+    void setLiveLatencyTarget(qint64 ms);
+    // Duration of the received packets which are not presented yet in milliseconds
+    qint64 liveLatency() const;
+
+    /**
+     * Clock which the frames are synchronized with, the subtitles always follow the presented frames.
+     */
+    MasterClock masterClock() const;
+    void setMasterClock(MasterClock clock);
+
+    /**
+     * Source of ExternalClock, not owned, nullptr disables the synchronization.
+     * The setters of the clocks and the sink wait until the player threads finish the calls
+     * to the previous one, so it could be deleted after. Must not be called from these calls.
+     */
+    QAVClock *externalClock() const;
+    void setExternalClock(QAVClock *clock);
+
+    /**
+     * Position played by the audio device used by AudioClock instead of pts of the sent audio frames,
+     * which run ahead of the device by its buffer. Not owned.
+     */
+    QAVClock *audioDeviceClock() const;
+    void setAudioDeviceClock(QAVClock *clock);
+
+    /**
+     * Sink called directly from the player threads with every sent frame, not owned.
+     * The frames are converted and the signals are emitted only if they are connected,
+     * so using only the sink avoids the signal overhead per frame.
+     * Could be changed while playing, setFrameSink(nullptr) returns when no frame is being passed to the sink.
+     */
+    QAVFrameSink *frameSink() const;
+    void setFrameSink(QAVFrameSink *sink);
+
     QAVStream::Progress progress(const QAVStream &stream) const;
 
     /**
@@ -134,6 +263,40 @@ public:
      */
     QList<QAVChapter> chapters() const;
 
+    /**
+     * Max bytes of the recently played video frames kept in memory,
+     * stepping and playing backward (negative speed) are served from them
+     * without decoding the GOP again. The cache keeps about one GOP and this only caps it,
+     * 256 MiB by default. Only software frames are cached, 0 disables the cache.
+     */
+    qint64 frameCacheSize() const;
+    void setFrameCacheSize(qint64 bytes);
+
+    /**
+     * Limits the packets queued by the demuxer.
+     * Defaults to `QT_AVPLAYER_MAX_QUEUED_BYTES` and `QT_AVPLAYER_MAX_QUEUED_SEC` env variables.
+     */
+    QAVBufferingPolicy bufferingPolicy() const;
+    void setBufferingPolicy(const QAVBufferingPolicy &policy);
+
+    /**
+     * Returns the buffer level relative to the high watermark in range [0, 1]
+     */
+    qreal bufferingProgress() const;
+
+    /**
+     * Counters of the pipeline since the source has been loaded:
+     * packets read and buffered, decoded, sent, late and dropped frames,
+     * latency of decoding, filtering and waiting for the clock.
+     */
+    QAVPlayerMetrics metrics() const;
+
+    /**
+     * Emits metricsChanged() every interval in milliseconds, 0 disables it.
+     */
+    int metricsInterval() const;
+    void setMetricsInterval(int ms);
+
 public Q_SLOTS:
     void play();
     void pause();
@@ -164,10 +327,25 @@ Q_SIGNALS:
     void filtersChanged(const QList<QString> &filters);
     void bitstreamFilterChanged(const QString &desc);
     void syncedChanged(bool sync);
+    void trickPlayChanged(bool enabled);
+    void frameDropPolicyChanged(QAVPlayer::FrameDropPolicy policy);
+    // Sent from the video thread, the dropped frames are counted in metrics()
+    void videoFrameDropped(double pts);
     void inputFormatChanged(const QString &format);
     void inputVideoCodecChanged(const QString &codec);
     void inputOptionsChanged(const QMap<QString, QString> &opts);
     void videoCodecOptionsChanged(const QMap<QString, QString> &opts);
+    void codecThreadingChanged(const QAVCodecThreading &threading, int streamIndex);
+    void framePoolOptionsChanged(const QAVFramePoolOptions &options);
+    void probeSizeChanged(qint64 bytes);
+    void analyzeDurationChanged(qint64 ms);
+    void fastOpenChanged(bool enabled);
+    void sharedDecodingChanged(bool enabled);
+    void liveModeChanged(bool enabled);
+    void liveLatencyTargetChanged(qint64 ms);
+    void masterClockChanged(QAVPlayer::MasterClock clock);
+    void bufferingProgressChanged(qreal progress);
+    void metricsChanged(const QAVPlayerMetrics &metrics);
 
     void videoFrame(const QAVVideoFrame &frame);
     void audioFrame(const QAVAudioFrame &frame);
@@ -188,11 +366,15 @@ private:
 Q_AVPLAYER_EXPORT QDebug operator<<(QDebug, QAVPlayer::State);
 Q_AVPLAYER_EXPORT QDebug operator<<(QDebug, QAVPlayer::MediaStatus);
 Q_AVPLAYER_EXPORT QDebug operator<<(QDebug, QAVPlayer::Error);
+Q_AVPLAYER_EXPORT QDebug operator<<(QDebug, QAVPlayer::FrameDropPolicy);
+Q_AVPLAYER_EXPORT QDebug operator<<(QDebug, QAVPlayer::MasterClock);
 #endif
 
 Q_DECLARE_METATYPE(QAVPlayer::State)
 Q_DECLARE_METATYPE(QAVPlayer::MediaStatus)
 Q_DECLARE_METATYPE(QAVPlayer::Error)
+Q_DECLARE_METATYPE(QAVPlayer::FrameDropPolicy)
+Q_DECLARE_METATYPE(QAVPlayer::MasterClock)
 
 QT_END_NAMESPACE
 
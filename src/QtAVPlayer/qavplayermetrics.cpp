@@ -0,0 +1,66 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavplayermetrics.h"
+
+QT_BEGIN_NAMESPACE
+
+int QAVPlayerMetrics::Histogram::bucketIndex(qint64 usec)
+{
+    int i = 0;
+    while (usec > 1 && i < BucketsCount - 1) {
+        usec >>= 1;
+        ++i;
+    }
+    return i;
+}
+
+void QAVPlayerMetrics::Histogram::add(qint64 usec)
+{
+    usec = qMax<qint64>(usec, 0);
+    ++m_buckets[bucketIndex(usec)];
+    ++m_count;
+    m_total += usec;
+    m_max = qMax(m_max, usec);
+}
+
+qint64 QAVPlayerMetrics::Histogram::percentile(double p) const
+{
+    if (m_count == 0)
+        return 0;
+    const qint64 rank = qMax<qint64>(1, qint64(qBound(0.0, p, 1.0) * m_count + 0.5));
+    qint64 count = 0;
+    for (int i = 0; i < BucketsCount; ++i) {
+        count += m_buckets[i];
+        if (count >= rank)
+            return qMin(m_max, (qint64(1) << (i + 1)) - 1);
+    }
+    return m_max;
+}
+
+#ifndef QT_NO_DEBUG_STREAM
+QDebug operator<<(QDebug dbg, const QAVPlayerMetrics &metrics)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace() << "QAVPlayerMetrics(";
+    const char *names[] = { "video", "audio", "subtitle" };
+    for (int i = QAVPlayerMetrics::Video; i <= QAVPlayerMetrics::Subtitle; ++i) {
+        const auto &s = metrics.stream(QAVPlayerMetrics::StreamType(i));
+        dbg << names[i] << "=[packets=" << s.packetsRead << ", buffered=" << s.bytesBuffered << "b"
+            << ", decoded=" << s.framesDecoded << ", sent=" << s.framesSent
+            << ", late=" << s.framesLate << ", dropped=" << s.framesDropped
+            << ", decode=" << s.decodeTime.mean() << "us"
+            << ", filter=" << s.filterTime.mean() << "us"
+            << ", wait=" << s.clockWaitTime.mean() << "us"
+            << ", jitter=" << s.presentationJitter.mean() << "us], ";
+    }
+    dbg << "drift=" << metrics.avDrift() << ", wakeups=" << metrics.demuxerWakeups() << ", pool=" << metrics.framePool() << ')';
+    return dbg;
+}
+#endif
+
+QT_END_NAMESPACE
@@ -0,0 +1,114 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVPLAYERMETRICS_H
+#define QAVPLAYERMETRICS_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QtAVPlayer/qavframepool.h>
+#include <QDebug>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Snapshot of the counters of the pipeline since the source has been loaded.
+ */
+class Q_AVPLAYER_EXPORT QAVPlayerMetrics
+{
+public:
+    /**
+     * Durations in microseconds grouped by power of two:
+     * bucket i counts the values in [2^i, 2^(i+1)), the last bucket counts also the bigger ones.
+     */
+    class Q_AVPLAYER_EXPORT Histogram
+    {
+    public:
+        static const int BucketsCount = 25;
+
+        qint64 count() const { return m_count; }
+        qint64 total() const { return m_total; }
+        qint64 max() const { return m_max; }
+        double mean() const { return m_count > 0 ? double(m_total) / m_count : 0.0; }
+        qint64 bucket(int i) const { return i >= 0 && i < BucketsCount ? m_buckets[i] : 0; }
+        // Upper bound of the bucket which contains the percentile in range [0, 1]
+        qint64 percentile(double p) const;
+
+        static int bucketIndex(qint64 usec);
+        void add(qint64 usec);
+
+    private:
+        friend class QAVMetrics;
+        qint64 m_buckets[BucketsCount] = {};
+        qint64 m_count = 0;
+        qint64 m_total = 0;
+        qint64 m_max = 0;
+    };
+
+    struct Stream
+    {
+        qint64 packetsRead = 0;
+        qint64 bytesRead = 0;
+        // Queued packets which are not decoded yet
+        qint64 packetsBuffered = 0;
+        qint64 bytesBuffered = 0;
+        qint64 framesDecoded = 0;
+        qint64 framesSent = 0;
+        // Sent behind the clock
+        qint64 framesLate = 0;
+        // Decoded but not sent, f.e. skipped after seek
+        qint64 framesDropped = 0;
+        Histogram decodeTime;
+        Histogram filterTime;
+        Histogram clockWaitTime;
+        // How late the frames are sent after their deadlines
+        Histogram presentationJitter;
+
+        // Frames which could be decoded per second
+        double decodeFps() const { return decodeTime.total() > 0 ? framesDecoded * 1000000.0 / decodeTime.total() : 0.0; }
+    };
+
+    enum StreamType
+    {
+        Video,
+        Audio,
+        Subtitle
+    };
+
+    const Stream &stream(StreamType type) const { return m_streams[type]; }
+    Stream &stream(StreamType type) { return m_streams[type]; }
+
+    // Pts of last sent video frame minus the master clock in seconds
+    double avDrift() const { return m_avDrift; }
+    void setAvDrift(double sec) { m_avDrift = sec; }
+    double maxAvDrift() const { return m_maxAvDrift; }
+    void setMaxAvDrift(double sec) { m_maxAvDrift = sec; }
+
+    // How many times the demuxer thread has been woken up after it was parked
+    qint64 demuxerWakeups() const { return m_demuxerWakeups; }
+    void setDemuxerWakeups(qint64 count) { m_demuxerWakeups = count; }
+
+    // Pool of the decoded video frames of the current source
+    const QAVFramePoolStats &framePool() const { return m_framePool; }
+    void setFramePool(const QAVFramePoolStats &stats) { m_framePool = stats; }
+
+private:
+    Stream m_streams[Subtitle + 1];
+    double m_avDrift = 0.0;
+    double m_maxAvDrift = 0.0;
+    qint64 m_demuxerWakeups = 0;
+    QAVFramePoolStats m_framePool;
+};
+
+#ifndef QT_NO_DEBUG_STREAM
+Q_AVPLAYER_EXPORT QDebug operator<<(QDebug dbg, const QAVPlayerMetrics &metrics);
+#endif
+
+Q_DECLARE_METATYPE(QAVPlayerMetrics)
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,533 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavplaylist.h"
+#include <QMutex>
+#include <QLoggingCategory>
+#include <atomic>
+#include <math.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(lcAVPlayer)
+
+class QAVPlaylistPrivate
+{
+    Q_DECLARE_PUBLIC(QAVPlaylist)
+public:
+    QAVPlaylistPrivate(QAVPlaylist *q)
+        : q_ptr(q)
+    {
+    }
+
+    // Audio device clock seen by the player of the deck
+    class DeckClock : public QAVClock
+    {
+    public:
+        double time() const override;
+
+        QAVPlaylistPrivate *d = nullptr;
+        int deck = 0;
+    };
+
+    // Player with the entry loaded to it
+    struct Deck
+    {
+        std::unique_ptr<QAVPlayer> player;
+        int entry = -1;
+        bool videoDone = false;
+        bool audioDone = false;
+        bool switching = false;
+        double videoPts = -1;
+        double audioPts = -1;
+        // End of the last sent audio frame
+        double audioEnd = -1;
+        // Frames sent before the deck is active
+        QList<QAVVideoFrame> videoFrames;
+        QList<QAVAudioFrame> audioFrames;
+
+        DeckClock clock;
+        // The device plays the tail of the previous entry while its time is within [tailStart, tailEnd]
+        bool handover = false;
+        double tailStart = 0;
+        double tailEnd = 0;
+        double offset = 0;
+    };
+
+    bool setState(QAVPlayer::State state);
+    void load(int deck, int entry);
+    void unload(int deck);
+    bool accept(Deck &deck, double pts, double &lastPts, bool &done) const;
+    bool checkDone(int deck);
+    void switchDecks(int deck);
+    void loadNext(int deck, int entry);
+    void finish();
+
+    QAVPlaylist *q_ptr = nullptr;
+    QList<QAVPlaylist::Entry> entries;
+    Deck decks[2];
+    int active = 0;
+    int currentIndex = -1;
+    std::atomic<QAVPlayer::State> state{QAVPlayer::StoppedState};
+    bool synced = true;
+    // Duration of the played entries in ms
+    qint64 elapsed = 0;
+    std::atomic<QAVClock *> audioDeviceClock{nullptr};
+    mutable QMutex mutex;
+    // Orders the state changes with starting the next deck
+    QMutex stateMutex;
+    QMutex clockMutex;
+};
+
+double QAVPlaylistPrivate::DeckClock::time() const
+{
+    auto device = d->audioDeviceClock.load();
+    const double t = device ? device->time() : -1;
+    if (t < 0)
+        return t;
+
+    QMutexLocker locker(&d->clockMutex);
+    auto &deck = d->decks[this->deck];
+    if (deck.handover) {
+        // Continues the previous entry until its buffered audio is played
+        if (t >= deck.tailStart && t <= deck.tailEnd)
+            return t + deck.offset;
+        deck.handover = false;
+    }
+    return t;
+}
+
+// Called with the state lock, the signal is emitted by the caller after releasing it
+bool QAVPlaylistPrivate::setState(QAVPlayer::State s)
+{
+    return state.exchange(s) != s;
+}
+
+void QAVPlaylistPrivate::unload(int i)
+{
+    {
+        QMutexLocker locker(&mutex);
+        decks[i].entry = -1;
+    }
+    // Waits until the frames are not sent anymore
+    decks[i].player->setSource({});
+    {
+        QMutexLocker locker(&mutex);
+        auto &deck = decks[i];
+        deck.videoDone = false;
+        deck.audioDone = false;
+        deck.switching = false;
+        deck.videoPts = -1;
+        deck.audioPts = -1;
+        deck.audioEnd = -1;
+        deck.videoFrames.clear();
+        deck.audioFrames.clear();
+    }
+    QMutexLocker locker(&clockMutex);
+    decks[i].handover = false;
+}
+
+void QAVPlaylistPrivate::load(int i, int entry)
+{
+    unload(i);
+    QAVPlaylist::Entry e;
+    {
+        QMutexLocker locker(&mutex);
+        if (entry < 0 || entry >= entries.size())
+            return;
+        e = entries[entry];
+        decks[i].entry = entry;
+    }
+
+    qCDebug(lcAVPlayer) << "Loading entry" << entry << ":" << e.source << e.in << "-" << e.out;
+    // First frame at the in point is kept until the deck is active
+    auto player = decks[i].player.get();
+    player->setSynced(synced);
+    player->setSource(e.source);
+    player->pause();
+    if (e.in > 0)
+        player->seek(e.in);
+}
+
+bool QAVPlaylistPrivate::accept(Deck &deck, double pts, double &lastPts, bool &done) const
+{
+    if (deck.entry < 0 || done || isnan(pts))
+        return false;
+
+    const auto &e = entries[deck.entry];
+    const double ms = pts * 1000;
+    if (ms < e.in - 1)
+        return false;
+    if (e.out >= 0 && ms >= e.out) {
+        done = true;
+        return false;
+    }
+    // The frame shown on pause could be sent again on play
+    if (pts <= lastPts)
+        return false;
+    lastPts = pts;
+    return true;
+}
+
+// Called with the lock, returns true if the caller switches the decks
+bool QAVPlaylistPrivate::checkDone(int i)
+{
+    auto &deck = decks[i];
+    if (i != active || deck.entry < 0 || deck.switching)
+        return false;
+
+    const bool video = deck.videoDone || deck.player->currentVideoStreams().isEmpty();
+    const bool audio = deck.audioDone || deck.player->currentAudioStreams().isEmpty();
+    if (!video || !audio)
+        return false;
+
+    deck.switching = true;
+    return true;
+}
+
+// Called on the thread which sent the last frame of the deck,
+// so the frames of the next deck follow without a round trip to the thread of the playlist
+void QAVPlaylistPrivate::switchDecks(int prev)
+{
+    Q_Q(QAVPlaylist);
+    const int i = 1 - prev;
+    auto &next = decks[i];
+    int index = -1;
+    double audioEnd = -1;
+    double nextStart = 0;
+    {
+        QMutexLocker locker(&mutex);
+        auto &deck = decks[prev];
+        if (prev != active || deck.entry < 0 || !deck.switching)
+            return;
+
+        const auto &e = entries[deck.entry];
+        const qint64 out = e.out >= 0 ? e.out : deck.player->duration();
+        elapsed += qMax<qint64>(out - e.in, 0);
+        audioEnd = deck.audioEnd;
+        // The frames of the previous entry are ignored from now
+        deck.entry = -1;
+        index = next.entry;
+        currentIndex = index;
+        if (index >= 0) {
+            nextStart = !next.audioFrames.isEmpty()
+                ? next.audioFrames.first().pts() : entries[index].in / 1000.0;
+        }
+    }
+
+    qCDebug(lcAVPlayer) << "Switching to entry" << index;
+    if (index < 0) {
+        // Unloading waits for the threads of the deck
+        qtavplayer_invokeMethod(q_ptr, [this] { finish(); });
+        return;
+    }
+
+    // The next deck continues the audio clock while the device plays the rest of the previous entry
+    auto device = audioDeviceClock.load();
+    const double t = device ? device->time() : -1;
+    {
+        QMutexLocker locker(&clockMutex);
+        next.handover = t >= 0 && audioEnd >= t;
+        next.tailStart = t;
+        next.tailEnd = audioEnd;
+        next.offset = nextStart - audioEnd;
+    }
+
+    // The pre-rolled frames go first, the deck becomes active when all of them are sent
+    while (true) {
+        QList<QAVVideoFrame> videoFrames;
+        QList<QAVAudioFrame> audioFrames;
+        {
+            QMutexLocker locker(&mutex);
+            videoFrames.swap(next.videoFrames);
+            audioFrames.swap(next.audioFrames);
+            if (videoFrames.isEmpty() && audioFrames.isEmpty()) {
+                active = i;
+                break;
+            }
+            if (!audioFrames.isEmpty())
+                next.audioEnd = audioFrames.last().pts() + audioFrames.last().duration();
+        }
+        for (const auto &frame : videoFrames)
+            Q_EMIT q->videoFrame(frame);
+        for (const auto &frame : audioFrames)
+            Q_EMIT q->audioFrame(frame);
+    }
+
+    {
+        QMutexLocker locker(&stateMutex);
+        if (state == QAVPlayer::StoppedState)
+            return;
+        if (state == QAVPlayer::PlayingState)
+            next.player->play();
+    }
+    Q_EMIT q->currentIndexChanged(index);
+    // The previous deck is reused for the entry after the next one
+    qtavplayer_invokeMethod(q_ptr, [this, prev, index] { loadNext(prev, index + 1); });
+}
+
+void QAVPlaylistPrivate::loadNext(int i, int entry)
+{
+    {
+        QMutexLocker locker(&mutex);
+        // Stopped or restarted meanwhile
+        if (currentIndex != entry - 1 || i == active)
+            return;
+    }
+    load(i, entry);
+
+    bool done = false;
+    {
+        QMutexLocker locker(&mutex);
+        auto &deck = decks[active];
+        auto status = deck.player->mediaStatus();
+        if (status == QAVPlayer::InvalidMedia || status == QAVPlayer::EndOfMedia) {
+            deck.videoDone = true;
+            deck.audioDone = true;
+        }
+        done = checkDone(active);
+    }
+    if (done)
+        switchDecks(1 - i);
+}
+
+void QAVPlaylistPrivate::finish()
+{
+    Q_Q(QAVPlaylist);
+    {
+        QMutexLocker locker(&stateMutex);
+        if (!setState(QAVPlayer::StoppedState))
+            return;
+    }
+    for (int i = 0; i < 2; ++i)
+        unload(i);
+    Q_EMIT q->stateChanged(QAVPlayer::StoppedState);
+    Q_EMIT q->currentIndexChanged(-1);
+    Q_EMIT q->finished();
+}
+
+QAVPlaylist::QAVPlaylist(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new QAVPlaylistPrivate(this))
+{
+    Q_D(QAVPlaylist);
+    for (int i = 0; i < 2; ++i) {
+        d->decks[i].player.reset(new QAVPlayer);
+        auto player = d->decks[i].player.get();
+        d->decks[i].clock.d = d;
+        d->decks[i].clock.deck = i;
+        QObject::connect(player, &QAVPlayer::videoFrame, this, [d, i](const QAVVideoFrame &frame) {
+            {
+                QMutexLocker locker(&d->mutex);
+                auto &deck = d->decks[i];
+                if (!d->accept(deck, frame.pts(), deck.videoPts, deck.videoDone)) {
+                    if (!d->checkDone(i))
+                        return;
+                    locker.unlock();
+                    d->switchDecks(i);
+                    return;
+                }
+                if (i != d->active) {
+                    deck.videoFrames.append(frame);
+                    return;
+                }
+            }
+            Q_EMIT d->q_ptr->videoFrame(frame);
+        }, Qt::DirectConnection);
+        QObject::connect(player, &QAVPlayer::audioFrame, this, [d, i](const QAVAudioFrame &frame) {
+            {
+                QMutexLocker locker(&d->mutex);
+                auto &deck = d->decks[i];
+                if (!d->accept(deck, frame.pts(), deck.audioPts, deck.audioDone)) {
+                    if (!d->checkDone(i))
+                        return;
+                    locker.unlock();
+                    d->switchDecks(i);
+                    return;
+                }
+                if (i != d->active) {
+                    deck.audioFrames.append(frame);
+                    return;
+                }
+                deck.audioEnd = frame.pts() + frame.duration();
+            }
+            Q_EMIT d->q_ptr->audioFrame(frame);
+        }, Qt::DirectConnection);
+        QObject::connect(player, &QAVPlayer::mediaStatusChanged, this, [d, i](QAVPlayer::MediaStatus status) {
+            if (status != QAVPlayer::EndOfMedia && status != QAVPlayer::InvalidMedia)
+                return;
+            {
+                QMutexLocker locker(&d->mutex);
+                // The statuses of the previous sources could still be delivered to not active deck
+                if (i != d->active)
+                    return;
+                d->decks[i].videoDone = true;
+                d->decks[i].audioDone = true;
+                if (!d->checkDone(i))
+                    return;
+            }
+            // No frames are sent anymore
+            d->switchDecks(i);
+        });
+    }
+}
+
+QAVPlaylist::~QAVPlaylist()
+{
+    Q_D(QAVPlaylist);
+    for (int i = 0; i < 2; ++i)
+        d->unload(i);
+}
+
+QList<QAVPlaylist::Entry> QAVPlaylist::entries() const
+{
+    Q_D(const QAVPlaylist);
+    QMutexLocker locker(&d->mutex);
+    return d->entries;
+}
+
+void QAVPlaylist::setEntries(const QList<Entry> &entries)
+{
+    Q_D(QAVPlaylist);
+    QMutexLocker locker(&d->mutex);
+    if (d->currentIndex >= 0) {
+        qWarning() << "Could not change the entries while playing";
+        return;
+    }
+    d->entries = entries;
+}
+
+void QAVPlaylist::append(const QString &source, qint64 in, qint64 out)
+{
+    auto list = entries();
+    list.append({ source, in, out });
+    setEntries(list);
+}
+
+int QAVPlaylist::currentIndex() const
+{
+    Q_D(const QAVPlaylist);
+    QMutexLocker locker(&d->mutex);
+    return d->currentIndex;
+}
+
+qint64 QAVPlaylist::position() const
+{
+    Q_D(const QAVPlaylist);
+    QMutexLocker locker(&d->mutex);
+    const auto &deck = d->decks[d->active];
+    if (d->currentIndex < 0 || deck.entry < 0)
+        return d->elapsed;
+    const double pts = qMax(deck.videoPts, deck.audioPts);
+    return d->elapsed + qMax<qint64>(qint64(pts * 1000) - d->entries[deck.entry].in, 0);
+}
+
+QAVPlayer::State QAVPlaylist::state() const
+{
+    return d_func()->state;
+}
+
+bool QAVPlaylist::isSynced() const
+{
+    return d_func()->synced;
+}
+
+void QAVPlaylist::setSynced(bool sync)
+{
+    Q_D(QAVPlaylist);
+    d->synced = sync;
+    for (auto &deck : d->decks)
+        deck.player->setSynced(sync);
+}
+
+QAVPlayer *QAVPlaylist::currentPlayer() const
+{
+    Q_D(const QAVPlaylist);
+    QMutexLocker locker(&d->mutex);
+    return d->decks[d->active].player.get();
+}
+
+QAVPlayer *QAVPlaylist::nextPlayer() const
+{
+    Q_D(const QAVPlaylist);
+    QMutexLocker locker(&d->mutex);
+    return d->decks[1 - d->active].player.get();
+}
+
+QAVClock *QAVPlaylist::audioDeviceClock() const
+{
+    return d_func()->audioDeviceClock;
+}
+
+void QAVPlaylist::setAudioDeviceClock(QAVClock *clock)
+{
+    Q_D(QAVPlaylist);
+    d->audioDeviceClock = clock;
+    for (auto &deck : d->decks)
+        deck.player->setAudioDeviceClock(clock ? &deck.clock : nullptr);
+}
+
+void QAVPlaylist::play()
+{
+    Q_D(QAVPlaylist);
+    if (d->state == QAVPlayer::PlayingState || entries().isEmpty())
+        return;
+
+    if (currentIndex() < 0) {
+        {
+            QMutexLocker locker(&d->mutex);
+            d->active = 0;
+            d->elapsed = 0;
+            d->currentIndex = 0;
+        }
+        d->load(0, 0);
+        d->load(1, 1);
+        Q_EMIT currentIndexChanged(0);
+    }
+    bool changed = false;
+    {
+        QMutexLocker locker(&d->stateMutex);
+        changed = d->setState(QAVPlayer::PlayingState);
+        currentPlayer()->play();
+    }
+    if (changed)
+        Q_EMIT stateChanged(QAVPlayer::PlayingState);
+}
+
+void QAVPlaylist::pause()
+{
+    Q_D(QAVPlaylist);
+    {
+        QMutexLocker locker(&d->stateMutex);
+        if (d->state != QAVPlayer::PlayingState)
+            return;
+        d->setState(QAVPlayer::PausedState);
+        currentPlayer()->pause();
+    }
+    Q_EMIT stateChanged(QAVPlayer::PausedState);
+}
+
+void QAVPlaylist::stop()
+{
+    Q_D(QAVPlaylist);
+    {
+        QMutexLocker locker(&d->stateMutex);
+        if (!d->setState(QAVPlayer::StoppedState))
+            return;
+    }
+    for (int i = 0; i < 2; ++i)
+        d->unload(i);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->currentIndex = -1;
+        d->elapsed = 0;
+    }
+    Q_EMIT stateChanged(QAVPlayer::StoppedState);
+    Q_EMIT currentIndexChanged(-1);
+}
+
+QT_END_NAMESPACE
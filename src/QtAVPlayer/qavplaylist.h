@@ -0,0 +1,92 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVPLAYLIST_H
+#define QAVPLAYLIST_H
+
+#include <QtAVPlayer/qavplayer.h>
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QList>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Plays the entries one after another without gaps.
+ * Next entry is loaded, seeked to its in point and paused by another player
+ * while current one is playing, and the players are switched at the out point
+ * on the thread which sends the last frame of current entry.
+ * The frames outside of the in and out points are not sent.
+ */
+class QAVPlaylistPrivate;
+class Q_AVPLAYER_EXPORT QAVPlaylist : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry
+    {
+        QString source;
+        // In and out points in milliseconds, -1 plays to the end
+        qint64 in = 0;
+        qint64 out = -1;
+    };
+
+    QAVPlaylist(QObject *parent = nullptr);
+    ~QAVPlaylist();
+
+    // Applied when the playlist is stopped
+    QList<Entry> entries() const;
+    void setEntries(const QList<Entry> &entries);
+    void append(const QString &source, qint64 in = 0, qint64 out = -1);
+
+    // Index of the playing entry, -1 if stopped
+    int currentIndex() const;
+    // Position on the timeline of all the entries in milliseconds
+    qint64 position() const;
+    QAVPlayer::State state() const;
+
+    bool isSynced() const;
+    void setSynced(bool sync);
+
+    // Players of current and next entries, switched at the out points
+    QAVPlayer *currentPlayer() const;
+    QAVPlayer *nextPlayer() const;
+
+    /**
+     * Position played by the audio device which plays audioFrame(), not owned.
+     * Used as the audio clock of the players, the next entry continues the clock
+     * of the previous one while its buffered audio is still played.
+     */
+    QAVClock *audioDeviceClock() const;
+    void setAudioDeviceClock(QAVClock *clock);
+
+public Q_SLOTS:
+    void play();
+    void pause();
+    void stop();
+
+Q_SIGNALS:
+    void stateChanged(QAVPlayer::State newState);
+    void currentIndexChanged(int index);
+    // All the entries are played
+    void finished();
+
+    void videoFrame(const QAVVideoFrame &frame);
+    void audioFrame(const QAVAudioFrame &frame);
+
+protected:
+    std::unique_ptr<QAVPlaylistPrivate> d_ptr;
+
+private:
+    Q_DISABLE_COPY(QAVPlaylist)
+    Q_DECLARE_PRIVATE(QAVPlaylist)
+};
+
+QT_END_NAMESPACE
+
+#endif
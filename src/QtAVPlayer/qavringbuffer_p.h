@@ -0,0 +1,127 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVRINGBUFFER_P_H
+#define QAVRINGBUFFER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Bounded single-producer/single-consumer ring.
+ * push() must be called from one thread and pop()/front() from another one,
+ * size() and isEmpty() can be called from any thread.
+ * The consumer side can be shared by several threads if they are serialized by a mutex.
+ */
+template<class T>
+class QAVRingBuffer
+{
+public:
+    explicit QAVRingBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_buffer.resize(size);
+        m_mask = size - 1;
+    }
+
+    size_t capacity() const
+    {
+        return m_buffer.size();
+    }
+
+    size_t size() const
+    {
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    bool isFull() const
+    {
+        return size() >= capacity();
+    }
+
+    // Producer side
+    bool push(T value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= capacity())
+            return false;
+        m_buffer[tail & m_mask].emplace(std::move(value));
+        m_tail.store(tail + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Consumer side
+    T *front()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &*m_buffer[head & m_mask];
+    }
+
+    bool pop(T &value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        auto &slot = m_buffer[head & m_mask];
+        value = std::move(*slot);
+        // Release the references kept by the slot
+        slot.reset();
+        m_head.store(head + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Drops the front value without constructing a new one
+    bool pop()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        m_buffer[head & m_mask].reset();
+        m_head.store(head + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+private:
+    std::vector<std::optional<T>> m_buffer;
+    size_t m_mask = 0;
+    // Keep the indexes on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+
+private:
+    Q_DISABLE_COPY(QAVRingBuffer)
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,158 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavscheduler_p.h"
+#include <QThread>
+#include <QtConcurrent/qtconcurrentrun.h>
+
+QT_BEGIN_NAMESPACE
+
+// Index of the worker running on current thread
+static thread_local int currentWorker = -1;
+
+QAVScheduler::QAVScheduler(int threadCount)
+{
+    const int count = threadCount > 0 ? threadCount : qMax(1, QThread::idealThreadCount());
+    m_pool.setMaxThreadCount(count);
+    for (int i = 0; i < count; ++i)
+        m_workers.emplace_back(new Worker);
+    for (int i = 0; i < count; ++i)
+        m_futures.append(QtConcurrent::run(&m_pool, [this, i] { work(i); }));
+}
+
+QAVScheduler::~QAVScheduler()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_cond.wakeAll();
+    }
+    for (auto &future : m_futures)
+        future.waitForFinished();
+}
+
+QAVScheduler &QAVScheduler::instance()
+{
+    static QAVScheduler scheduler;
+    return scheduler;
+}
+
+int QAVScheduler::threadCount() const
+{
+    return int(m_workers.size());
+}
+
+QAVScheduler::TaskPtr QAVScheduler::create(const std::function<bool()> &fn) const
+{
+    return TaskPtr(new Task(fn));
+}
+
+void QAVScheduler::schedule(const TaskPtr &task)
+{
+    int state = task->m_state;
+    while (true) {
+        if (state == Task::Idle) {
+            if (task->m_state.compare_exchange_weak(state, Task::Queued)) {
+                push(task);
+                return;
+            }
+        } else if (state == Task::Running) {
+            if (task->m_state.compare_exchange_weak(state, Task::Rescheduled))
+                return;
+        } else {
+            // Already queued or cancelled
+            return;
+        }
+    }
+}
+
+void QAVScheduler::cancel(const TaskPtr &task)
+{
+    task->m_state = Task::Cancelled;
+    // Queued task is dropped when it is taken
+    QMutexLocker locker(&task->m_runMutex);
+}
+
+void QAVScheduler::push(const TaskPtr &task)
+{
+    // Keep the tasks scheduled by a task on the same thread
+    const int index = currentWorker >= 0 ? currentWorker : int(m_next++ % m_workers.size());
+    {
+        auto &worker = *m_workers[index];
+        QMutexLocker locker(&worker.mutex);
+        worker.tasks.push_back(task);
+    }
+    ++m_queued;
+    if (m_sleeping > 0) {
+        QMutexLocker locker(&m_mutex);
+        m_cond.wakeOne();
+    }
+}
+
+QAVScheduler::TaskPtr QAVScheduler::take(int index)
+{
+    const int count = int(m_workers.size());
+    for (int i = 0; i < count; ++i) {
+        auto &worker = *m_workers[(index + i) % count];
+        QMutexLocker locker(&worker.mutex);
+        if (worker.tasks.empty())
+            continue;
+        TaskPtr task;
+        // Own tasks are taken in order, the stolen ones from the end
+        if (i == 0) {
+            task = worker.tasks.front();
+            worker.tasks.pop_front();
+        } else {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+        }
+        --m_queued;
+        return task;
+    }
+    return {};
+}
+
+void QAVScheduler::run(const TaskPtr &task)
+{
+    QMutexLocker locker(&task->m_runMutex);
+    int state = Task::Queued;
+    if (!task->m_state.compare_exchange_strong(state, Task::Running))
+        return;
+
+    const bool again = task->m_fn();
+    state = Task::Running;
+    if (task->m_state.compare_exchange_strong(state, again ? Task::Queued : Task::Idle)) {
+        if (again)
+            push(task);
+        return;
+    }
+
+    state = Task::Rescheduled;
+    if (task->m_state.compare_exchange_strong(state, Task::Queued))
+        push(task);
+}
+
+void QAVScheduler::work(int index)
+{
+    currentWorker = index;
+    while (!m_quit) {
+        auto task = take(index);
+        if (task) {
+            run(task);
+            continue;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        ++m_sleeping;
+        while (m_queued == 0 && !m_quit)
+            m_cond.wait(&m_mutex);
+        --m_sleeping;
+    }
+    currentWorker = -1;
+}
+
+QT_END_NAMESPACE
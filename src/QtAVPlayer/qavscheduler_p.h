@@ -0,0 +1,112 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVSCHEDULER_P_H
+#define QAVSCHEDULER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QFuture>
+#include <QVector>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+/**
+ * Runs non-blocking tasks on a bounded pool of threads.
+ * Every thread owns a queue of tasks and steals from the others when its queue is empty.
+ * A task is run by one thread at a time, scheduling it while it is running
+ * runs it once again when it is finished.
+ */
+class Q_AVPLAYER_EXPORT QAVScheduler
+{
+public:
+    class Task
+    {
+    public:
+        // Returns true if the task should be run again
+        explicit Task(const std::function<bool()> &fn) : m_fn(fn) { }
+
+    private:
+        friend class QAVScheduler;
+        enum State
+        {
+            Idle,
+            Queued,
+            Running,
+            // Scheduled while running
+            Rescheduled,
+            Cancelled
+        };
+
+        std::function<bool()> m_fn;
+        std::atomic_int m_state{Idle};
+        // Held while the task is running
+        QMutex m_runMutex;
+    };
+    using TaskPtr = QSharedPointer<Task>;
+
+    // Zero thread count means the number of the cores
+    explicit QAVScheduler(int threadCount = 0);
+    ~QAVScheduler();
+
+    // Shared by all the players in the process
+    static QAVScheduler &instance();
+
+    int threadCount() const;
+
+    TaskPtr create(const std::function<bool()> &fn) const;
+    void schedule(const TaskPtr &task);
+    // The task is not run anymore, waits if it is running
+    void cancel(const TaskPtr &task);
+
+private:
+    struct Worker
+    {
+        QMutex mutex;
+        std::deque<TaskPtr> tasks;
+    };
+
+    void push(const TaskPtr &task);
+    TaskPtr take(int index);
+    void run(const TaskPtr &task);
+    void work(int index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic_uint m_next{0};
+    std::atomic_int m_queued{0};
+    std::atomic_int m_sleeping{0};
+    std::atomic_bool m_quit{false};
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QThreadPool m_pool;
+    QVector<QFuture<void>> m_futures;
+
+    Q_DISABLE_COPY(QAVScheduler)
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -20,26 +20,33 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
-class QAVStreamPrivate
+class QAVStreamPrivate : public QSharedData
 {
-    Q_DECLARE_PUBLIC(QAVStream)
 public:
-    QAVStreamPrivate(QAVStream *q) : q_ptr(q) { }
-
-    QAVStream *q_ptr = nullptr;
     int index = -1;
     QSharedPointer<QAVFormatContext> ctx;
     QSharedPointer<QAVCodec> codec;
-    QMap<QString, QString> metadata;
 };
 
+// Every frame and packet holds a stream, so the empty ones share the same data
+static QAVStreamPrivate *sharedNull()
+{
+    static QAVStreamPrivate *d = [] {
+        auto p = new QAVStreamPrivate;
+        // Never deleted
+        p->ref.ref();
+        return p;
+    }();
+    return d;
+}
+
 QAVStream::QAVStream()
-    : d_ptr(new QAVStreamPrivate(this))
+    : d_ptr(sharedNull())
 {
 }
 
 QAVStream::QAVStream(int index, const QSharedPointer<QAVFormatContext> &ctx, const QSharedPointer<QAVCodec> &codec)
-    : QAVStream()
+    : d_ptr(new QAVStreamPrivate)
 {
     d_ptr->index = index;
     d_ptr->ctx = ctx;
@@ -51,16 +58,25 @@ QAVStream::~QAVStream()
 }
 
 QAVStream::QAVStream(const QAVStream &other)
-    : QAVStream()
+    : d_ptr(other.d_ptr)
 {
-    *this = other;
+}
+
+QAVStream::QAVStream(QAVStream &&other) noexcept
+    : d_ptr(sharedNull())
+{
+    d_ptr.swap(other.d_ptr);
 }
 
 QAVStream &QAVStream::operator=(const QAVStream &other)
 {
-    d_ptr->index = other.d_ptr->index;
-    d_ptr->ctx = other.d_ptr->ctx;
-    d_ptr->codec = other.d_ptr->codec;
+    d_ptr = other.d_ptr;
+    return *this;
+}
+
+QAVStream &QAVStream::operator=(QAVStream &&other) noexcept
+{
+    d_ptr.swap(other.d_ptr);
     return *this;
 }
 
@@ -117,14 +133,10 @@ static QMap<QString, QString> streamMetadata(const AVStream *stream)
 
 QMap<QString, QString> QAVStream::metadata() const
 {
-    Q_D(const QAVStream);
-    if (!d->metadata.isEmpty())
-        return d->metadata;
     auto s = stream();
     if (!s)
         return {};
-    const_cast<QAVStreamPrivate *>(d)->metadata = streamMetadata(s);
-    return d->metadata;
+    return streamMetadata(s);
 }
 
 QSharedPointer<QAVCodec> QAVStream::codec() const
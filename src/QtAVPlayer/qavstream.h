@@ -11,6 +11,7 @@
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QMap>
 #include <QSharedPointer>
+#include <QSharedData>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -20,14 +21,20 @@ struct AVFormatContext;
 class QAVCodec;
 class QAVFormatContext;
 class QAVStreamPrivate;
+/**
+ * Implicitly shared and immutable, so the copies are cheap and could be used from any thread.
+ */
 class Q_AVPLAYER_EXPORT QAVStream
 {
 public:
     QAVStream();
     QAVStream(int index, const QSharedPointer<QAVFormatContext> &ctx = {}, const QSharedPointer<QAVCodec> &codec = {});
     QAVStream(const QAVStream &other);
+    QAVStream(QAVStream &&other) noexcept;
     ~QAVStream();
     QAVStream &operator=(const QAVStream &other);
+    QAVStream &operator=(QAVStream &&other) noexcept;
+    void swap(QAVStream &other) noexcept { d_ptr.swap(other.d_ptr); }
     operator bool() const;
 
     int index() const;
@@ -71,7 +78,7 @@ public:
     };
 
 private:
-    std::unique_ptr<QAVStreamPrivate> d_ptr;
+    QExplicitlySharedDataPointer<QAVStreamPrivate> d_ptr;
     Q_DECLARE_PRIVATE(QAVStream)
 };
 
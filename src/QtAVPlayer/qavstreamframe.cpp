@@ -22,10 +22,20 @@ QAVStreamFrame::QAVStreamFrame()
 {
 }
 
+template<> QAVStreamFramePrivate *QExplicitlySharedDataPointer<QAVStreamFramePrivate>::clone()
+{
+    return d->clone();
+}
+
 QAVStreamFrame::QAVStreamFrame(const QAVStreamFrame &other)
-    : QAVStreamFrame()
+    : d_ptr(other.d_ptr)
 {
-    *this = other;
+}
+
+QAVStreamFrame::QAVStreamFrame(QAVStreamFrame &&other) noexcept
+    : d_ptr(other.d_ptr->sharedNull())
+{
+    d_ptr.swap(other.d_ptr);
 }
 
 QAVStreamFrame::QAVStreamFrame(QAVStreamFramePrivate &d)
@@ -37,6 +47,28 @@ QAVStreamFrame::~QAVStreamFrame()
 {
 }
 
+QAVStreamFrame &QAVStreamFrame::operator=(const QAVStreamFrame &other)
+{
+    d_ptr = other.d_ptr;
+    return *this;
+}
+
+QAVStreamFrame &QAVStreamFrame::operator=(QAVStreamFrame &&other) noexcept
+{
+    d_ptr.swap(other.d_ptr);
+    return *this;
+}
+
+void QAVStreamFrame::detach()
+{
+    d_ptr.detach();
+}
+
+bool QAVStreamFrame::isDetached() const
+{
+    return d_ptr->ref.loadAcquire() == 1;
+}
+
 QAVStream QAVStreamFrame::stream() const
 {
     return d_ptr->stream;
@@ -44,16 +76,11 @@ QAVStream QAVStreamFrame::stream() const
 
 void QAVStreamFrame::setStream(const QAVStream &stream)
 {
+    detach();
     Q_D(QAVStreamFrame);
     d->stream = stream;
 }
 
-QAVStreamFrame &QAVStreamFrame::operator=(const QAVStreamFrame &other)
-{
-    d_ptr->stream = other.d_ptr->stream;
-    return *this;
-}
-
 QAVStreamFrame::operator bool() const
 {
     Q_D(const QAVStreamFrame);
@@ -74,6 +101,8 @@ double QAVStreamFrame::duration() const
 
 int QAVStreamFrame::receive()
 {
+    // The codec writes to the data, which could be shared
+    detach();
     Q_D(QAVStreamFrame);
     return d->stream ? d->stream.codec()->read(*this) : 0;
 }
@@ -10,18 +10,32 @@
 
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QtAVPlayer/qavstream.h>
-#include <memory>
+#include <QSharedData>
 
 QT_BEGIN_NAMESPACE
 
 class QAVStreamFramePrivate;
+template<> QAVStreamFramePrivate *QExplicitlySharedDataPointer<QAVStreamFramePrivate>::clone();
+
+/**
+ * Implicitly shared: the copies refer to the same data until any of them is modified by a setter
+ * or by the non-const accessors like QAVFrame::frame(), which detach.
+ */
 class Q_AVPLAYER_EXPORT QAVStreamFrame
 {
 public:
     QAVStreamFrame();
     QAVStreamFrame(const QAVStreamFrame &other);
+    // The moved frame is left empty
+    QAVStreamFrame(QAVStreamFrame &&other) noexcept;
     ~QAVStreamFrame();
     QAVStreamFrame &operator=(const QAVStreamFrame &other);
+    QAVStreamFrame &operator=(QAVStreamFrame &&other) noexcept;
+    void swap(QAVStreamFrame &other) noexcept { d_ptr.swap(other.d_ptr); }
+
+    // Makes a deep copy of the data if it is shared with other frames
+    void detach();
+    bool isDetached() const;
 
     QAVStream stream() const;
     void setStream(const QAVStream &stream);
@@ -39,7 +53,7 @@ public:
 protected:
     QAVStreamFrame(QAVStreamFramePrivate &d);
 
-    std::unique_ptr<QAVStreamFramePrivate> d_ptr;
+    QExplicitlySharedDataPointer<QAVStreamFramePrivate> d_ptr;
     Q_DECLARE_PRIVATE(QAVStreamFrame)
 };
 
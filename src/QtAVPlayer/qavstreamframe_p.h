@@ -20,16 +20,35 @@
 //
 
 #include "qavstream.h"
+#include <QSharedData>
 #include <cmath>
 
 QT_BEGIN_NAMESPACE
 
-class QAVStreamFramePrivate
+// Empty data of each type of the frames, never deleted
+template<class T>
+T *qavSharedNull()
+{
+    static T *d = [] {
+        auto p = new T;
+        p->ref.ref();
+        return p;
+    }();
+    return d;
+}
+
+class QAVStreamFramePrivate : public QSharedData
 {
 public:
     QAVStreamFramePrivate() = default;
+    QAVStreamFramePrivate(const QAVStreamFramePrivate &other) = default;
     virtual ~QAVStreamFramePrivate() = default;
 
+    // Deep copy used when a shared frame is modified
+    virtual QAVStreamFramePrivate *clone() const { return new QAVStreamFramePrivate(*this); }
+    // Left in the moved frames, so they stay valid and empty
+    virtual QAVStreamFramePrivate *sharedNull() const { return qavSharedNull<QAVStreamFramePrivate>(); }
+
     virtual double pts() const { return NAN; }
     virtual double duration() const { return 0.0; }
 
@@ -19,6 +19,11 @@ QT_BEGIN_NAMESPACE
 class QAVSubtitleFramePrivate : public QAVStreamFramePrivate
 {
 public:
+    QAVSubtitleFramePrivate();
+
+    QAVStreamFramePrivate *clone() const override { return new QAVSubtitleFramePrivate(*this); }
+    QAVStreamFramePrivate *sharedNull() const override { return qavSharedNull<QAVSubtitleFramePrivate>(); }
+
     QSharedPointer<AVSubtitle> subtitle;
 
     double pts() const override;
@@ -31,12 +36,15 @@ static void subtitle_free(AVSubtitle *subtitle)
     delete subtitle;
 }
 
+QAVSubtitleFramePrivate::QAVSubtitleFramePrivate()
+{
+    subtitle.reset(new AVSubtitle, subtitle_free);
+    memset(subtitle.data(), 0, sizeof(*subtitle.data()));
+}
+
 QAVSubtitleFrame::QAVSubtitleFrame()
     : QAVStreamFrame(*new QAVSubtitleFramePrivate)
 {
-    Q_D(QAVSubtitleFrame);
-    d->subtitle.reset(new AVSubtitle, subtitle_free);
-    memset(d->subtitle.data(), 0, sizeof(*d->subtitle.data()));
 }
 
 QAVSubtitleFrame::~QAVSubtitleFrame()
@@ -44,17 +52,24 @@ QAVSubtitleFrame::~QAVSubtitleFrame()
 }
 
 QAVSubtitleFrame::QAVSubtitleFrame(const QAVSubtitleFrame &other)
-    : QAVSubtitleFrame()
+    : QAVStreamFrame(other)
+{
+}
+
+QAVSubtitleFrame::QAVSubtitleFrame(QAVSubtitleFrame &&other) noexcept
+    : QAVStreamFrame(std::move(other))
 {
-    operator=(other);
 }
 
 QAVSubtitleFrame &QAVSubtitleFrame::operator=(const QAVSubtitleFrame &other)
 {
-    Q_D(QAVSubtitleFrame);
     QAVStreamFrame::operator=(other);
-    d->subtitle = static_cast<QAVSubtitleFramePrivate *>(other.d_ptr.get())->subtitle;
+    return *this;
+}
 
+QAVSubtitleFrame &QAVSubtitleFrame::operator=(QAVSubtitleFrame &&other) noexcept
+{
+    QAVStreamFrame::operator=(std::move(other));
     return *this;
 }
 
@@ -20,8 +20,11 @@ public:
     QAVSubtitleFrame();
     ~QAVSubtitleFrame();
     QAVSubtitleFrame(const QAVSubtitleFrame &other);
+    QAVSubtitleFrame(QAVSubtitleFrame &&other) noexcept;
     QAVSubtitleFrame &operator=(const QAVSubtitleFrame &other);
+    QAVSubtitleFrame &operator=(QAVSubtitleFrame &&other) noexcept;
 
+    // Shared by the copies of the frame even after detach()
     AVSubtitle *subtitle() const;
 
 private:
@@ -0,0 +1,113 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavswscache_p.h"
+
+extern "C" {
+#include <libswscale/swscale.h>
+#include <libavutil/pixdesc.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+static int swsColorspace(AVColorSpace colorspace, int height)
+{
+    switch (colorspace) {
+        case AVCOL_SPC_BT709:
+            return SWS_CS_ITU709;
+        case AVCOL_SPC_FCC:
+            return SWS_CS_FCC;
+        case AVCOL_SPC_SMPTE240M:
+            return SWS_CS_SMPTE240M;
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+            return SWS_CS_ITU601;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            return SWS_CS_BT2020;
+        default:
+            // Same guess as most players do for untagged streams
+            return height >= 720 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+    }
+}
+
+static bool isRgb(AVPixelFormat format)
+{
+    auto desc = av_pix_fmt_desc_get(format);
+    return desc && (desc->flags & AV_PIX_FMT_FLAG_RGB);
+}
+
+QAVSwsCache &QAVSwsCache::instance()
+{
+    static QAVSwsCache cache;
+    return cache;
+}
+
+QAVSwsCache::~QAVSwsCache()
+{
+    clear();
+}
+
+SwsContext *QAVSwsCache::take(const Key &key)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+            if (it->key == key) {
+                auto ctx = it->ctx;
+                m_entries.erase(std::next(it).base());
+                return ctx;
+            }
+        }
+    }
+
+    const int flags = key.srcWidth != key.dstWidth || key.srcHeight != key.dstHeight ? SWS_BICUBIC : SWS_POINT;
+    auto ctx = sws_getContext(key.srcWidth, key.srcHeight, key.srcFormat,
+                              key.dstWidth, key.dstHeight, key.dstFormat,
+                              flags, nullptr, nullptr, nullptr);
+    if (!ctx)
+        return nullptr;
+
+    // The color matrix is kept and only the range of RGB is expanded
+    auto coefficients = sws_getCoefficients(swsColorspace(key.colorspace, key.srcHeight));
+    const int srcRange = key.range == AVCOL_RANGE_JPEG ? 1 : 0;
+    const int dstRange = isRgb(key.dstFormat) ? 1 : srcRange;
+    sws_setColorspaceDetails(ctx, coefficients, srcRange, coefficients, dstRange, 0, 1 << 16, 1 << 16);
+    return ctx;
+}
+
+void QAVSwsCache::put(const Key &key, SwsContext *ctx)
+{
+    if (!ctx)
+        return;
+    SwsContext *evicted = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (int(m_entries.size()) >= MaxContexts) {
+            evicted = m_entries.front().ctx;
+            m_entries.erase(m_entries.begin());
+        }
+        m_entries.push_back({ key, ctx });
+    }
+    sws_freeContext(evicted);
+}
+
+int QAVSwsCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_entries.size());
+}
+
+void QAVSwsCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto &entry : m_entries)
+        sws_freeContext(entry.ctx);
+    m_entries.clear();
+}
+
+QT_END_NAMESPACE
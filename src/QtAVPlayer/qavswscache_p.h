@@ -0,0 +1,94 @@
+/*********************************************************
+ * Copyright (C) 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVSWSCACHE_P_H
+#define QAVSWSCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QMutex>
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+struct SwsContext;
+
+/**
+ * Keeps the scaling contexts to reuse them for the frames of the same geometry and color,
+ * instead of initializing the filters for every converted frame.
+ * A context is taken by one thread and put back after use,
+ * so several threads get own contexts for the same key.
+ */
+class QAVSwsCache
+{
+public:
+    struct Key
+    {
+        AVPixelFormat srcFormat = AV_PIX_FMT_NONE;
+        int srcWidth = 0;
+        int srcHeight = 0;
+        AVPixelFormat dstFormat = AV_PIX_FMT_NONE;
+        int dstWidth = 0;
+        int dstHeight = 0;
+        AVColorSpace colorspace = AVCOL_SPC_UNSPECIFIED;
+        AVColorRange range = AVCOL_RANGE_UNSPECIFIED;
+
+        friend bool operator==(const Key &a, const Key &b)
+        {
+            return a.srcFormat == b.srcFormat &&
+                   a.srcWidth == b.srcWidth &&
+                   a.srcHeight == b.srcHeight &&
+                   a.dstFormat == b.dstFormat &&
+                   a.dstWidth == b.dstWidth &&
+                   a.dstHeight == b.dstHeight &&
+                   a.colorspace == b.colorspace &&
+                   a.range == b.range;
+        }
+    };
+
+    static const int MaxContexts = 64;
+
+    static QAVSwsCache &instance();
+    ~QAVSwsCache();
+
+    // Returns the cached context or creates new one, nullptr if the conversion is not supported
+    SwsContext *take(const Key &key);
+    // The least recently used contexts are freed if the cache is full
+    void put(const Key &key, SwsContext *ctx);
+
+    int size() const;
+    void clear();
+
+private:
+    struct Entry
+    {
+        Key key;
+        SwsContext *ctx = nullptr;
+    };
+
+    mutable QMutex m_mutex;
+    // Most recently used are at the end
+    std::vector<Entry> m_entries;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -19,7 +19,7 @@ QAVVideoFrame::MapData QAVVideoBuffer_GPU::map()
 {
     auto mapData = m_cpu.map();
     if (mapData.format == AV_PIX_FMT_NONE) {
-        int ret = av_hwframe_transfer_data(m_cpu.frame().frame(), m_frame.frame(), 0);
+        int ret = av_hwframe_transfer_data(m_cpu.frame().frame(), std::as_const(m_frame).frame(), 0);
         if (ret < 0) {
             qWarning() << "Could not av_hwframe_transfer_data:" << ret;
             return {};
@@ -33,6 +33,7 @@ public:
     explicit QAVVideoBuffer(const QAVVideoFrame &frame) : m_frame(frame) { }
     virtual ~QAVVideoBuffer() = default;
     const QAVVideoFrame &frame() const { return m_frame; }
+    QAVVideoFrame &frame() { return m_frame; }
 
     virtual QAVVideoFrame::MapData map() = 0;
     // Returns if the data is mapped to CPU memory
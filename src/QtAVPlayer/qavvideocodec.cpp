@@ -8,6 +8,7 @@
 #include "qavvideocodec_p.h"
 #include "qavhwdevice_p.h"
 #include "qavcodec_p_p.h"
+#include "qavframepool_p.h"
 #include "qavpacket.h"
 #include "qavframe.h"
 #include "qavvideoframe.h"
@@ -24,6 +25,7 @@ class QAVVideoCodecPrivate : public QAVCodecPrivate
 {
 public:
     QSharedPointer<QAVHWDevice> hw_device;
+    QAVFramePool *pool = nullptr;
 };
 
 static bool isSoftwarePixelFormat(AVPixelFormat from)
@@ -135,9 +137,41 @@ QAVVideoCodec::QAVVideoCodec(const AVCodec *codec)
     d_ptr->avctx->get_format = negotiate_pixel_format;
 }
 
+static int get_buffer(AVCodecContext *c, AVFrame *frame, int flags)
+{
+    auto d = reinterpret_cast<QAVVideoCodecPrivate *>(c->opaque);
+    return d->pool->getBuffer(c, frame, flags);
+}
+
 QAVVideoCodec::~QAVVideoCodec()
 {
+    Q_D(QAVVideoCodec);
     av_buffer_unref(&avctx()->hw_device_ctx);
+    // The frames still referencing the buffers keep the pool alive
+    if (d->pool) {
+        d->avctx->get_buffer2 = avcodec_default_get_buffer2;
+        d->pool->deref();
+    }
+}
+
+void QAVVideoCodec::setFramePoolOptions(const QAVFramePoolOptions &options)
+{
+    Q_D(QAVVideoCodec);
+    if (d->pool) {
+        d->avctx->get_buffer2 = avcodec_default_get_buffer2;
+        d->pool->deref();
+        d->pool = nullptr;
+    }
+    if (options.isNull())
+        return;
+    d->pool = new QAVFramePool(options);
+    d->avctx->get_buffer2 = get_buffer;
+}
+
+QAVFramePoolStats QAVVideoCodec::framePoolStats() const
+{
+    Q_D(const QAVVideoCodec);
+    return d->pool ? d->pool->stats() : QAVFramePoolStats();
 }
 
 void QAVVideoCodec::setDevice(const QSharedPointer<QAVHWDevice> &d)
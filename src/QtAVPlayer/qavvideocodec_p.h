@@ -20,6 +20,7 @@
 //
 
 #include "qavframecodec_p.h"
+#include "qavframepool.h"
 
 extern "C" {
 #include <libavutil/hwcontext.h>
@@ -38,6 +39,10 @@ public:
     void setDevice(const QSharedPointer<QAVHWDevice> &d);
     QAVHWDevice *device() const;
 
+    // Should be set before the codec is opened
+    void setFramePoolOptions(const QAVFramePoolOptions &options);
+    QAVFramePoolStats framePoolStats() const;
+
     static QList<AVHWDeviceType> supportedHWDevices(const AVCodec *c);
 
 private:
@@ -63,9 +63,10 @@ int QAVVideoFilter::write(const QAVFrame &frame)
             d->sourceFrame = {};
             return AVERROR(ENOTSUP);
         }
-        QAVFrame ref = d->sourceFrame;
         QMutexLocker locker(&d->graphMutex);
-        int ret = av_buffersrc_add_frame_flags(filter.ctx(), ref.frame(), AV_BUFFERSRC_FLAG_PUSH);
+        // The frame is shared with the caller, so the filter makes own reference and does not change it
+        auto source = const_cast<AVFrame *>(std::as_const(d->sourceFrame).frame());
+        int ret = av_buffersrc_add_frame_flags(filter.ctx(), source, AV_BUFFERSRC_FLAG_KEEP_REF | AV_BUFFERSRC_FLAG_PUSH);
         if (ret < 0)
             return ret;
     }
@@ -93,9 +94,9 @@ int QAVVideoFilter::read(QAVFrame &frame)
         for (int i = 0; i < d->outputs.size(); ++i) {
             const auto &filter = d->outputs[i];
             while (true) {
-                QAVFrame out = d->sourceFrame;
                 // av_buffersink_get_frame_flags allocates frame's data
-                av_frame_unref(out.frame());
+                QAVFrame out;
+                out.setStream(d->sourceFrame.stream());
                 {
                     QMutexLocker locker(&d->graphMutex);
                     ret = av_buffersink_get_frame_flags(filter.ctx(), out.frame(), 0);
@@ -105,10 +106,10 @@ int QAVVideoFilter::read(QAVFrame &frame)
 
 #if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 30, 0)
                 if (!out.frame()->pkt_duration)
-                    out.frame()->pkt_duration = d->sourceFrame.frame()->pkt_duration;
+                    out.frame()->pkt_duration = std::as_const(d->sourceFrame).frame()->pkt_duration;
 #else
                 if (out.frame()->duration == AV_NOPTS_VALUE || out.frame()->duration == 0)
-                    out.frame()->duration = d->sourceFrame.frame()->duration;
+                    out.frame()->duration = std::as_const(d->sourceFrame).frame()->duration;
 #endif
                 out.setFrameRate(av_buffersink_get_frame_rate(filter.ctx()));
                 out.setTimeBase(av_buffersink_get_time_base(filter.ctx()));
@@ -118,7 +119,7 @@ int QAVVideoFilter::read(QAVFrame &frame)
                     : QString(QLatin1String("%1:%2")).arg(d->name).arg(QString::number(i)));
                 if (!out.stream())
                     out.setStream(d->stream);
-                d->outputFrames.push_back(out);
+                d->outputFrames.push_back(std::move(out));
             }
         }
     }
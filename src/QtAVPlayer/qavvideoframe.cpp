@@ -10,7 +10,13 @@
 #include "qavframe_p.h"
 #include "qavvideocodec_p.h"
 #include "qavhwdevice_p.h"
+#include "qavswscache_p.h"
 #include <QSize>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <atomic>
+#include <memory>
 #ifdef QT_AVPLAYER_MULTIMEDIA
     #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
         #include <QAbstractVideoSurface>
@@ -39,42 +45,26 @@ static const QAVVideoCodec *videoCodec(const QAVCodec *c)
     return reinterpret_cast<const QAVVideoCodec *>(c);
 }
 
-class QAVVideoFramePrivate : public QAVFramePrivate
-{
-    Q_DECLARE_PUBLIC(QAVVideoFrame)
-public:
-    QAVVideoFramePrivate(QAVVideoFrame *q) : q_ptr(q) { }
-
-    QAVVideoBuffer &videoBuffer() const
-    {
-        if (!buffer) {
-            auto c = videoCodec(stream.codec().data());
-            auto buf = c && c->device() && frame->format == c->device()->format() ? c->device()->videoBuffer(*q_ptr) : new QAVVideoBuffer_CPU(*q_ptr);
-            const_cast<QAVVideoFramePrivate*>(this)->buffer.reset(buf);
-        }
-
-        return *buffer;
-    }
-
-    QAVVideoFrame *q_ptr = nullptr;
-    QSharedPointer<QAVVideoBuffer> buffer;
-};
-
 QAVVideoFrame::QAVVideoFrame()
-    : QAVFrame(*new QAVVideoFramePrivate(this))
+    : QAVFrame()
 {
 }
 
 QAVVideoFrame::QAVVideoFrame(const QAVFrame &other)
-    : QAVVideoFrame()
+    : QAVFrame(other)
 {
-    operator=(other);
 }
 
 QAVVideoFrame::QAVVideoFrame(const QAVVideoFrame &other)
-    : QAVVideoFrame()
+    : QAVFrame(other)
+    , m_buffer(other.m_buffer)
 {
-    operator=(other);
+}
+
+QAVVideoFrame::QAVVideoFrame(QAVVideoFrame &&other) noexcept
+    : QAVFrame(std::move(other))
+{
+    m_buffer.swap(other.m_buffer);
 }
 
 QAVVideoFrame::QAVVideoFrame(const QSize &size, AVPixelFormat fmt)
@@ -88,20 +78,36 @@ QAVVideoFrame::QAVVideoFrame(const QSize &size, AVPixelFormat fmt)
 
 QAVVideoFrame &QAVVideoFrame::operator=(const QAVFrame &other)
 {
-    Q_D(QAVVideoFrame);
     QAVFrame::operator=(other);
-    d->buffer.reset();
+    m_buffer.reset();
     return *this;
 }
 
 QAVVideoFrame &QAVVideoFrame::operator=(const QAVVideoFrame &other)
 {
-    Q_D(QAVVideoFrame);
     QAVFrame::operator=(other);
-    d->buffer = reinterpret_cast<QAVVideoFramePrivate *>(other.d_ptr.get())->buffer;
+    m_buffer = other.m_buffer;
     return *this;
 }
 
+QAVVideoFrame &QAVVideoFrame::operator=(QAVVideoFrame &&other) noexcept
+{
+    QAVFrame::operator=(std::move(other));
+    m_buffer.swap(other.m_buffer);
+    return *this;
+}
+
+QAVVideoBuffer &QAVVideoFrame::videoBuffer() const
+{
+    if (!m_buffer) {
+        auto c = videoCodec(stream().codec().data());
+        auto buf = c && c->device() && frame()->format == c->device()->format() ? c->device()->videoBuffer(*this) : new QAVVideoBuffer_CPU(*this);
+        m_buffer.reset(buf);
+    }
+
+    return *m_buffer;
+}
+
 QSize QAVVideoFrame::size() const
 {
     Q_D(const QAVFrame);
@@ -110,33 +116,28 @@ QSize QAVVideoFrame::size() const
 
 QAVVideoFrame::MapData QAVVideoFrame::map() const
 {
-    Q_D(const QAVVideoFrame);
-    return d->videoBuffer().map();
+    return videoBuffer().map();
 }
 
 bool QAVVideoFrame::isMapped() const
 {
-    Q_D(const QAVVideoFrame);
-    return d->videoBuffer().isMapped();
+    return videoBuffer().isMapped();
 }
 
 QAVVideoFrame::HandleType QAVVideoFrame::handleType() const
 {
-    Q_D(const QAVVideoFrame);
-    return d->videoBuffer().handleType();
+    return videoBuffer().handleType();
 }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 QVariant QAVVideoFrame::handle(QRhi *rhi) const
 {
-    Q_D(const QAVVideoFrame);
-    return d->videoBuffer().handle(rhi);
+    return videoBuffer().handle(rhi);
 }
 #else
 QVariant QAVVideoFrame::handle() const
 {
-    Q_D(const QAVVideoFrame);
-    return d->videoBuffer().handle();
+    return videoBuffer().handle();
 }
 #endif
 
@@ -150,38 +151,158 @@ QString QAVVideoFrame::formatName() const
     return QLatin1String(av_pix_fmt_desc_get(QAVVideoFrame::format())->name);
 }
 
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+// Rows of big frames are converted in parallel,
+// QT_AVPLAYER_SCALE_THREADS limits the threads, 1 converts in one pass
+static int bandsCount(const QSize &dstSize)
+{
+    bool ok = false;
+    const int threads = qEnvironmentVariableIntValue("QT_AVPLAYER_SCALE_THREADS", &ok);
+    return qBound(1, dstSize.height() / 256, ok && threads > 0 ? threads : QThread::idealThreadCount());
+}
+
+// Frame referencing the planes without owning them, used by the slice API
+static AVFrame *wrapPlanes(AVPixelFormat format, const QSize &size, uint8_t *const data[4], const int linesize[4])
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return nullptr;
+    frame->format = format;
+    frame->width = size.width();
+    frame->height = size.height();
+    for (int i = 0; i < 4; ++i) {
+        frame->data[i] = data[i];
+        frame->linesize[i] = linesize[i];
+    }
+    frame->buf[0] = av_buffer_create(data[0], 0, [](void *, uint8_t *) { }, nullptr, 0);
+    if (!frame->buf[0])
+        av_frame_free(&frame);
+    return frame;
+}
+#endif
+
+static bool scale(const QAVVideoFrame::MapData &src, const QSize &srcSize, const AVFrame *props,
+                  AVPixelFormat dstFormat, const QSize &dstSize, uchar *const dst[4], const int dstStride[4])
+{
+    QAVSwsCache::Key key;
+    key.srcFormat = src.format;
+    key.srcWidth = srcSize.width();
+    key.srcHeight = srcSize.height();
+    key.dstFormat = dstFormat;
+    key.dstWidth = dstSize.width();
+    key.dstHeight = dstSize.height();
+    key.colorspace = props->colorspace;
+    key.range = props->color_range;
+
+    auto &cache = QAVSwsCache::instance();
+    auto ctx = cache.take(key);
+    if (!ctx)
+        return false;
+
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+    // Every thread has own context of the whole frame and receives a band of the output rows,
+    // so the filters see the neighbour rows and the result is the same as of one pass
+    const int bands = bandsCount(dstSize);
+    const int height = dstSize.height();
+    const int align = qMax<int>(1, sws_receive_slice_alignment(ctx));
+    const int bandHeight = FFALIGN((height + bands - 1) / bands, align);
+    if (bands > 1 && bandHeight < height) {
+        std::unique_ptr<AVFrame, void (*)(AVFrame *)> srcFrame(
+            wrapPlanes(src.format, srcSize, src.data, src.bytesPerLine), [](AVFrame *f) { av_frame_free(&f); });
+        std::unique_ptr<AVFrame, void (*)(AVFrame *)> dstFrame(
+            wrapPlanes(dstFormat, dstSize, dst, dstStride), [](AVFrame *f) { av_frame_free(&f); });
+        if (srcFrame && dstFrame) {
+            std::atomic<bool> ok{true};
+            auto convertBand = [&](SwsContext *bandCtx, int y) {
+                if (!bandCtx
+                    || sws_frame_start(bandCtx, dstFrame.get(), srcFrame.get()) < 0
+                    || sws_send_slice(bandCtx, 0, srcSize.height()) < 0
+                    || sws_receive_slice(bandCtx, y, qMin(bandHeight, height - y)) < 0)
+                {
+                    ok = false;
+                }
+                if (bandCtx) {
+                    sws_frame_end(bandCtx);
+                    cache.put(key, bandCtx);
+                }
+            };
+
+            // The first band is converted by the calling thread
+            QVector<QFuture<void>> futures;
+            for (int y = bandHeight; y < height; y += bandHeight)
+                futures.append(QtConcurrent::run(QThreadPool::globalInstance(), [&, y] { convertBand(cache.take(key), y); }));
+            convertBand(ctx, 0);
+            for (auto &future : futures)
+                future.waitForFinished();
+            if (ok)
+                return true;
+            // Converted again in one pass if the slices are not supported
+            ctx = cache.take(key);
+            if (!ctx)
+                return false;
+        }
+    }
+#endif
+
+    sws_scale(ctx, src.data, src.bytesPerLine, 0, srcSize.height(), dst, dstStride);
+    cache.put(key, ctx);
+    return true;
+}
+
 QAVVideoFrame QAVVideoFrame::convertTo(AVPixelFormat fmt) const
 {
     if (fmt == frame()->format)
         return *this;
 
+    return convertTo(fmt, size());
+}
+
+QAVVideoFrame QAVVideoFrame::convertTo(AVPixelFormat fmt, const QSize &size) const
+{
+    if (fmt == frame()->format && (size.isEmpty() || size == this->size()))
+        return *this;
+
+    QAVVideoFrame result;
+    if (!convertTo(fmt, size, result))
+        return QAVVideoFrame();
+    return result;
+}
+
+bool QAVVideoFrame::convertTo(AVPixelFormat fmt, const QSize &size, QAVVideoFrame &dst) const
+{
+    const QSize dstSize = size.isEmpty() ? this->size() : size;
+    // Not detached by the const frame(), so the shared frames are not reused
+    auto f = std::as_const(dst).frame();
+    const bool reuse = dst.isDetached()
+        && f->buf[0]
+        && f->format == fmt
+        && f->width == dstSize.width()
+        && f->height == dstSize.height()
+        && av_frame_is_writable(dst.frame());
+    if (!reuse)
+        dst = QAVVideoFrame(dstSize, fmt);
+    if (!convertTo(fmt, dstSize, dst.frame()->data, dst.frame()->linesize))
+        return false;
+
+    dst.setStream(stream());
+    dst.frame()->pts = frame()->pts;
+    return true;
+}
+
+bool QAVVideoFrame::convertTo(AVPixelFormat fmt, const QSize &size, uchar *const data[4], const int bytesPerLine[4]) const
+{
     auto mapData = map();
     if (mapData.format == AV_PIX_FMT_NONE) {
         qWarning() << __FUNCTION__ << "Could not map:" << formatName();
-        return QAVVideoFrame();
-    }
-    auto ctx = sws_getContext(size().width(), size().height(), mapData.format,
-                              size().width(), size().height(), fmt,
-                              SWS_BICUBIC, NULL, NULL, NULL);
-    if (ctx == nullptr) {
-        qWarning() << __FUNCTION__ << ": Could not get sws context:" << formatName();
-        return QAVVideoFrame();
+        return false;
     }
 
-    int ret = sws_setColorspaceDetails(ctx, sws_getCoefficients(SWS_CS_ITU601),
-                                       0, sws_getCoefficients(SWS_CS_ITU709), 0, 0, 1 << 16, 1 << 16);
-    if (ret == -1) {
-        qWarning() << __FUNCTION__ << "Colorspace not support";
-        return QAVVideoFrame();
+    const QSize dstSize = size.isEmpty() ? this->size() : size;
+    if (!scale(mapData, this->size(), frame(), fmt, dstSize, data, bytesPerLine)) {
+        qWarning() << __FUNCTION__ << ": Could not get sws context:" << formatName();
+        return false;
     }
-
-    QAVVideoFrame result(size(), fmt);
-    result.d_ptr->stream = d_ptr->stream;
-    sws_scale(ctx, mapData.data, mapData.bytesPerLine, 0, result.size().height(), result.frame()->data, result.frame()->linesize);
-    sws_freeContext(ctx);
-    reinterpret_cast<QAVFramePrivate *>(result.d_ptr.get())->frame->pts = reinterpret_cast<QAVFramePrivate *>(d_ptr.get())->frame->pts;
-
-    return result;
+    return true;
 }
 
 #ifdef QT_AVPLAYER_MULTIMEDIA
@@ -530,7 +651,7 @@ QAVVideoFrame::operator QVideoFrame() const
         static_cast<int>(frame()->height - frame()->crop_top - frame()->crop_bottom)
     );
     // Special case when the codec already cropped the frame and need to render only part of the frame
-    auto bufSize = reinterpret_cast<QAVVideoFramePrivate *>(result.d_ptr.get())->videoBuffer().size();
+    auto bufSize = result.videoBuffer().size();
     if (handleType() == GLTextureHandle && bufSize.height() > size().height() && size().height() == viewport.height()) {
         auto diff = bufSize.height() - size().height();
         viewport.setHeight(viewport.height() - diff - 1);
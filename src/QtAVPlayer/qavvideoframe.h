@@ -10,6 +10,7 @@
 
 #include <QtAVPlayer/qavframe.h>
 #include <QVariant>
+#include <QSharedPointer>
 #ifdef QT_AVPLAYER_MULTIMEDIA
 #include <QVideoFrame>
 #endif
@@ -20,7 +21,7 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
-class QAVVideoFramePrivate;
+class QAVVideoBuffer;
 class QAVCodec;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 class QRhi;
@@ -39,10 +40,12 @@ public:
     QAVVideoFrame();
     QAVVideoFrame(const QAVFrame &other);
     QAVVideoFrame(const QAVVideoFrame &other);
+    QAVVideoFrame(QAVVideoFrame &&other) noexcept;
     QAVVideoFrame(const QSize &size, AVPixelFormat fmt);
 
     QAVVideoFrame &operator=(const QAVFrame &other);
     QAVVideoFrame &operator=(const QAVVideoFrame &other);
+    QAVVideoFrame &operator=(QAVVideoFrame &&other) noexcept;
 
     QSize size() const;
 
@@ -65,12 +68,20 @@ public:
     AVPixelFormat format() const;
     QString formatName() const;
     QAVVideoFrame convertTo(AVPixelFormat fmt) const;
+    // Scales to the size if it is not empty
+    QAVVideoFrame convertTo(AVPixelFormat fmt, const QSize &size) const;
+    // Reuses the buffer of the destination frame if it has the same format and size and is not shared
+    bool convertTo(AVPixelFormat fmt, const QSize &size, QAVVideoFrame &dst) const;
+    // Writes to the memory of the caller, which should fit the format and size
+    bool convertTo(AVPixelFormat fmt, const QSize &size, uchar *const data[4], const int bytesPerLine[4]) const;
 #ifdef QT_AVPLAYER_MULTIMEDIA
     operator QVideoFrame() const;
 #endif
 
-protected:
-    Q_DECLARE_PRIVATE(QAVVideoFrame)
+private:
+    QAVVideoBuffer &videoBuffer() const;
+    // Created on first access and shared by the copies of this frame
+    mutable QSharedPointer<QAVVideoBuffer> m_buffer;
 };
 
 Q_DECLARE_METATYPE(QAVVideoFrame)
@@ -47,23 +47,25 @@ QAVVideoInputFilter::QAVVideoInputFilter(const QAVFrame &frame)
     Q_D(QAVVideoInputFilter);
     const auto &frm = frame.frame();
     const auto &stream = frame.stream().stream();
-    // Use codec's hw frame ctx
-    if (!frm->hw_frames_ctx) {
+    auto format = AVPixelFormat(frm->format);
+    auto hw_frames_ctx = frm->hw_frames_ctx;
+    // Use codec's hw frame ctx, the frame is shared with the caller so it is not changed
+    if (!hw_frames_ctx) {
         auto codec = frame.stream().codec();
         auto avctx = codec ? codec->avctx() : nullptr;
         if (avctx && avctx->hw_frames_ctx) {
             auto frames_ctx = (AVHWFramesContext*)(avctx->hw_frames_ctx->data);
-            frm->format = frames_ctx->format; // hw accel pixel format like cuda
-            frm->hw_frames_ctx = av_buffer_ref(avctx->hw_frames_ctx);
+            format = frames_ctx->format; // hw accel pixel format like cuda
+            hw_frames_ctx = avctx->hw_frames_ctx;
         }
     }
-    d->format = frm->format != AV_PIX_FMT_NONE ? AVPixelFormat(frm->format) : AVPixelFormat(stream->codecpar->format);
+    d->format = format != AV_PIX_FMT_NONE ? format : AVPixelFormat(stream->codecpar->format);
     d->width = frm->width ? frm->width : stream->codecpar->width;
     d->height = frm->height ? frm->height : stream->codecpar->height;
     d->sample_aspect_ratio = frm->sample_aspect_ratio.num && frm->sample_aspect_ratio.den ? frm->sample_aspect_ratio : stream->codecpar->sample_aspect_ratio;
     d->time_base = stream->time_base;
     d->frame_rate = stream->avg_frame_rate;
-    d->hw_frames_ctx = frm->hw_frames_ctx;
+    d->hw_frames_ctx = hw_frames_ctx;
 }
 
 QAVVideoInputFilter::QAVVideoInputFilter(const QAVVideoInputFilter &other)
@@ -0,0 +1,9 @@
+TARGET = tst_qavallocations
+INCLUDEPATH += ../../../../src/ ../../../../src/QtAVPlayer
+include(../../../../src/QtAVPlayer/QtAVPlayer.pri)
+
+QT -= gui
+QT += testlib
+CONFIG += testcase console c++17
+SOURCES += \
+    tst_qavallocations.cpp
@@ -0,0 +1,91 @@
+/***************************************************************
+ * Copyright (C) 2020, 2026, Val Doroshchuk <valbok@gmail.com> *
+ *                                                             *
+ * This file is part of QtAVPlayer.                            *
+ * Free Qt Media Player based on FFmpeg.                       *
+ ***************************************************************/
+
+#include "qavplayer.h"
+#include "qavframesink.h"
+#include "qavvideoframe.h"
+
+#include <QDebug>
+#include <QtTest/QtTest>
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+// The global operators are replaced for this binary only
+// to count the heap allocations of each thread separately
+static thread_local qint64 heapAllocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++heapAllocations;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+QT_USE_NAMESPACE
+
+class tst_QAVAllocations : public QObject
+{
+    Q_OBJECT
+private slots:
+    void presentationAllocations();
+};
+
+// Keeps the number of heap allocations of the video thread when the frames are presented
+class AllocationsSink : public QAVFrameSink
+{
+public:
+    AllocationsSink() { allocations.reserve(4096); }
+
+    void videoFrame(const QAVVideoFrame &) override
+    {
+        // Read before the sink does anything
+        const qint64 count = heapAllocations;
+        QMutexLocker locker(&mutex);
+        if (allocations.size() < allocations.capacity())
+            allocations.push_back(count);
+    }
+
+    QMutex mutex;
+    std::vector<qint64> allocations;
+};
+
+void tst_QAVAllocations::presentationAllocations()
+{
+    AllocationsSink sink;
+    QAVPlayer p;
+    p.setFrameSink(&sink);
+    p.setSynced(false);
+    // rgb24 frames, the cache keeps 16 of them to get the steady state soon
+    p.setFrameCacheSize(16 * 64 * 64 * 3);
+    p.setInputFormat("lavfi");
+    p.setSource("testsrc=size=64x64:rate=100:duration=4");
+    p.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 20000);
+    p.setSource({});
+
+    // The demuxing and decoding allocate on own threads,
+    // the presentation of the frames should only reuse the memory.
+    QMutexLocker locker(&sink.mutex);
+    const size_t warmup = 50;
+    QVERIFY(sink.allocations.size() > warmup + 100);
+    QCOMPARE(sink.allocations.back() - sink.allocations[warmup], 0);
+}
+
+QTEST_MAIN(tst_QAVAllocations)
+#include "tst_qavallocations.moc"
@@ -14,16 +14,29 @@
 #include "qaviodevice.h"
 #include "qavvideocodec_p.h"
 #include "qavaudiocodec_p.h"
+#include "qavaudioconverter_p.h"
+#include "qavpacketqueue_p.h"
+#include "qavscheduler_p.h"
+#include "qavswscache_p.h"
+#include "qavpcmring_p.h"
+#include "qavaudiomixer_p.h"
+#include "qavframecache_p.h"
+#include "qavbufferingpolicy.h"
 #if defined(QT_AVPLAYER_LIBASS)
 #include "qavassrenderer.h"
 #endif
 
 #include <QDebug>
 #include <QtTest/QtTest>
+#include <QtConcurrent/QtConcurrent>
+#include <atomic>
+#include <cmath>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 }
 
 #ifndef TEST_DATA_DIR
@@ -65,6 +78,32 @@ private slots:
     void muxerFramesScale_data();
     void muxerFramesScale();
     void chapters();
+    void keyFrameIndex_data();
+    void keyFrameIndex();
+    void packetQueue();
+    void packetQueueGrow();
+    void packetQueueDecodeAhead();
+    void packetQueueScheduler();
+    void packetQueueBenchmark_data();
+    void packetQueueBenchmark();
+    void codecThreading();
+    void codecThreadingBenchmark_data();
+    void codecThreadingBenchmark();
+    void fastOpen();
+    void fastOpenBenchmark_data();
+    void fastOpenBenchmark();
+    void sharedData();
+    void framePool_data();
+    void framePool();
+    void convertCache();
+    void audioConverterBenchmark_data();
+    void audioConverterBenchmark();
+    void audioConverterDiscontinuity();
+    void pcmRing();
+    void audioMixer();
+    void frameCacheGop();
+    void convertBands();
+    void audioMixerPts();
 };
 
 void tst_QAVDemuxer::construction()
@@ -1042,5 +1081,1390 @@ void tst_QAVDemuxer::chapters()
     QVERIFY(!chapters[2].metadata().isEmpty());
 }
 
+void tst_QAVDemuxer::keyFrameIndex_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<bool>("indexed");
+    // MPEG-PS adds the index entries only while the packets are read
+    QTest::newRow("mpeg") << QString("star_trails.mpeg") << true;
+    QTest::newRow("dv") << QString("dv_dsf_1_stype_1.dv") << true;
+    // Container provides own index
+    QTest::newRow("mp4") << QString("colors.mp4") << false;
+}
+
+void tst_QAVDemuxer::keyFrameIndex()
+{
+    QFETCH(QString, path);
+    QFETCH(bool, indexed);
+
+    QAVDemuxer d;
+    QFileInfo file(testData(path));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QVERIFY(!d.currentVideoStreams().isEmpty());
+    QVERIFY(d.keyFrames().isEmpty());
+    const int index = d.currentVideoStreams().first().index();
+
+    QAVPacket p;
+    double lastPts = 0;
+    while (d.read(p) >= 0) {
+        if (p.packet()->stream_index == index)
+            lastPts = qMax(lastPts, p.pts());
+    }
+    QVERIFY(lastPts > 0);
+
+    const auto keyFrames = d.keyFrames();
+    if (indexed)
+        QVERIFY(!keyFrames.isEmpty());
+    if (path.endsWith(".mp4"))
+        QVERIFY(keyFrames.isEmpty());
+    for (int i = 1; i < keyFrames.size(); ++i)
+        QVERIFY(keyFrames[i] > keyFrames[i - 1]);
+
+    // Seek inside already demuxed range and backward
+    for (double pos : {lastPts / 2, lastPts / 4, 0.0}) {
+        QVERIFY(d.seek(pos) >= 0);
+        QCOMPARE(d.eof(), false);
+        bool found = false;
+        while (!found && d.read(p) >= 0) {
+            if (p.packet()->stream_index != index || p.packet()->pts == AV_NOPTS_VALUE)
+                continue;
+            found = true;
+            QVERIFY2(qAbs(p.pts() - pos) < 1.0, qPrintable(QString("%1 != %2").arg(p.pts()).arg(pos)));
+        }
+        QVERIFY(found);
+    }
+
+    // Scrubbing does not break the demuxed ranges
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(d.seek(lastPts * (i % 10) / 10) >= 0);
+        QVERIFY(d.read(p) >= 0);
+    }
+    QVERIFY(d.seek(lastPts / 2) >= 0);
+    bool found = false;
+    while (!found && d.read(p) >= 0) {
+        if (p.packet()->stream_index != index || p.packet()->pts == AV_NOPTS_VALUE)
+            continue;
+        found = true;
+        QVERIFY2(qAbs(p.pts() - lastPts / 2) < 1.0, qPrintable(QString::number(p.pts())));
+    }
+    QVERIFY(found);
+
+    d.unload();
+    QVERIFY(d.keyFrames().isEmpty());
+}
+
+void tst_QAVDemuxer::packetQueue()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("small.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    QAVPacketQueue<QAVFrame> queue(AVMEDIA_TYPE_VIDEO, d, 3);
+    QVERIFY(queue.isEmpty());
+    QCOMPARE(queue.size(), 0);
+    QCOMPARE(queue.bytes(), 0);
+
+    QList<QAVPacket> packets;
+    QAVPacket p;
+    while (packets.size() < 4 && d.read(p) >= 0) {
+        if (d.currentCodecType(p.packet()->stream_index) == AVMEDIA_TYPE_VIDEO)
+            packets.append(p);
+    }
+    QCOMPARE(packets.size(), 4);
+
+    // The capacity is rounded up to 4
+    int bytes = 0;
+    for (const auto &pkt : packets) {
+        queue.enqueue(pkt);
+        bytes += pkt.packet()->size + sizeof(pkt);
+    }
+    QVERIFY(!queue.isEmpty());
+    QCOMPARE(queue.size(), 4);
+    QCOMPARE(queue.bytes(), bytes);
+    QVERIFY(queue.duration(d.currentVideoStreams()) > 0);
+
+    // Full queue parks the producer until a packet is consumed
+    auto producer = QtConcurrent::run([&] { queue.enqueue(packets[0]); });
+    QTest::qWait(50);
+    QVERIFY(!producer.isFinished());
+    QAVFrame frame;
+    queue.frontFrame(frame);
+    producer.waitForFinished();
+    QCOMPARE(queue.size(), 4);
+
+    queue.clear();
+    QVERIFY(queue.isEmpty());
+    QCOMPARE(queue.size(), 0);
+    QCOMPARE(queue.bytes(), 0);
+    QCOMPARE(queue.duration(d.currentVideoStreams()), 0.0);
+
+    // Wake and abort release the consumer
+    queue.wake(true);
+    QVERIFY(!queue.frontFrame(frame));
+    queue.wake(false);
+    auto consumer = QtConcurrent::run([&] { return queue.frontFrame(frame); });
+    QTest::qWait(50);
+    QVERIFY(!consumer.isFinished());
+    queue.abort();
+    QVERIFY(!consumer.result());
+    queue.enqueue(packets[0]);
+    QVERIFY(queue.isEmpty());
+}
+
+void tst_QAVDemuxer::packetQueueGrow()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("small.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    QList<QAVPacket> packets;
+    QAVPacket p;
+    while (d.read(p) >= 0) {
+        if (d.currentCodecType(p.packet()->stream_index) == AVMEDIA_TYPE_VIDEO)
+            packets.append(p);
+    }
+    QVERIFY(!packets.isEmpty());
+
+    // The policy allows more packets than the initial capacity
+    const int count = 10000;
+    QAVBufferingPolicy policy;
+    policy.setMaxBytes(0);
+    policy.setMaxDuration(count * 1.0);
+    QAVPacketQueue<QAVFrame> queue(AVMEDIA_TYPE_VIDEO, d);
+    QCOMPARE(queue.capacity(), 4096);
+    queue.setMaxCapacity(1 << 20);
+
+    auto producer = QtConcurrent::run([&] {
+        for (int i = 0; i < count; ++i)
+            queue.enqueue(packets[i % packets.size()]);
+    });
+    QDeadlineTimer deadline(10000);
+    while (!producer.isFinished() && !deadline.hasExpired())
+        QTest::qWait(10);
+    if (!producer.isFinished()) {
+        queue.abort();
+        producer.waitForFinished();
+        QFAIL("The producer is blocked on the full ring");
+    }
+    QCOMPARE(queue.size(), count);
+    QVERIFY(queue.capacity() >= count);
+    QVERIFY(queue.duration(d.currentVideoStreams()) < policy.maxDuration());
+
+    // The moved packets are decoded from the grown ring
+    QAVFrame frame;
+    int decoded = 0;
+    while (decoded < 16 && !queue.frontFrame(frame))
+        ++decoded;
+    QVERIFY(frame);
+    QCOMPARE(queue.size(), count - decoded - 1);
+    queue.clear();
+    QCOMPARE(queue.size(), 0);
+    QCOMPARE(queue.bytes(), 0);
+
+    // The parked producer grows the ring when the max capacity is raised
+    QAVPacketQueue<QAVFrame> small(AVMEDIA_TYPE_VIDEO, d, 4);
+    for (int i = 0; i < 4; ++i)
+        small.enqueue(packets[i % packets.size()]);
+    auto parked = QtConcurrent::run([&] { small.enqueue(packets[0]); });
+    QTest::qWait(50);
+    QVERIFY(!parked.isFinished());
+    small.setMaxCapacity(8);
+    QTRY_VERIFY(parked.isFinished());
+    QCOMPARE(small.size(), 5);
+    QCOMPARE(small.capacity(), 8);
+}
+
+void tst_QAVDemuxer::packetQueueDecodeAhead()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("small.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    QAVPacketQueue<QAVFrame> queue(AVMEDIA_TYPE_VIDEO, d);
+    QCOMPARE(queue.decodeDepth(), 0);
+    queue.setDecodeDepth(2);
+    QCOMPARE(queue.decodeDepth(), 2);
+
+    QAVPacket p;
+    int packets = 0;
+    while (packets < 20 && d.read(p) >= 0) {
+        if (d.currentCodecType(p.packet()->stream_index) == AVMEDIA_TYPE_VIDEO) {
+            queue.enqueue(p);
+            ++packets;
+        }
+    }
+    QCOMPARE(queue.size(), 20);
+
+    std::atomic_bool quit = false;
+    auto decoder = QtConcurrent::run([&] {
+        while (!quit)
+            queue.decode();
+    });
+
+    // The decoder waits until the decoded frames are presented
+    QTRY_VERIFY(queue.size() < 20);
+    QTest::qWait(50);
+    const int size = queue.size();
+    QVERIFY(size > 0);
+    QTest::qWait(50);
+    QCOMPARE(queue.size(), size);
+
+    QAVFrame frame;
+    double pts = -1;
+    for (int i = 0; i < 10; ++i) {
+        QVERIFY(queue.frontFrame(frame));
+        QVERIFY(frame);
+        QVERIFY(frame.pts() > pts);
+        pts = frame.pts();
+        queue.popFrame();
+    }
+    QVERIFY(!queue.isEmpty());
+
+    // Outdated frames are dropped
+    queue.clear();
+    QVERIFY(queue.isEmpty());
+    QCOMPARE(queue.size(), 0);
+    queue.wake(true);
+    QVERIFY(!queue.frontFrame(frame));
+
+    quit = true;
+    queue.abort();
+    decoder.waitForFinished();
+}
+
+void tst_QAVDemuxer::packetQueueScheduler()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("small.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    QAVScheduler scheduler(2);
+    QCOMPARE(scheduler.threadCount(), 2);
+    QAVPacketQueue<QAVFrame> queue(AVMEDIA_TYPE_VIDEO, d);
+    queue.setDecodeDepth(2);
+    std::atomic_int runs{0};
+    auto task = scheduler.create([&] {
+        ++runs;
+        return queue.tryDecode();
+    });
+    queue.setScheduleCallback([&] { scheduler.schedule(task); });
+
+    // Every enqueued packet schedules the task
+    QAVPacket p;
+    int packets = 0;
+    while (packets < 20 && d.read(p) >= 0) {
+        if (d.currentCodecType(p.packet()->stream_index) == AVMEDIA_TYPE_VIDEO) {
+            queue.enqueue(p);
+            ++packets;
+        }
+    }
+
+    // The task is finished when the ring is full
+    QTRY_VERIFY(queue.size() < 20);
+    QTest::qWait(50);
+    const int size = queue.size();
+    const int count = runs;
+    QVERIFY(size > 0);
+    QTest::qWait(50);
+    QCOMPARE(queue.size(), size);
+    QCOMPARE(int(runs), count);
+
+    // Consumed frames schedule the task again
+    QAVFrame frame;
+    double pts = -1;
+    for (int i = 0; i < 15; ++i) {
+        QVERIFY(queue.frontFrame(frame));
+        QVERIFY(frame.pts() > pts);
+        pts = frame.pts();
+        queue.popFrame();
+    }
+
+    queue.clear();
+    QVERIFY(queue.isEmpty());
+    queue.abort();
+    scheduler.cancel(task);
+    const int cancelled = runs;
+    scheduler.schedule(task);
+    QTest::qWait(50);
+    QCOMPARE(int(runs), cancelled);
+}
+
+namespace {
+// Previous mutex based implementation of the packet queue
+class MutexQueue
+{
+public:
+    void push(const QAVPacket &packet)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_packets.append(packet);
+        m_cond.wakeAll();
+    }
+
+    QAVPacket pop()
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_packets.isEmpty())
+            m_cond.wait(&m_mutex);
+        return m_packets.takeFirst();
+    }
+
+private:
+    QList<QAVPacket> m_packets;
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+};
+}
+
+void tst_QAVDemuxer::packetQueueBenchmark_data()
+{
+    QTest::addColumn<bool>("ring");
+    QTest::newRow("mutex") << false;
+    QTest::newRow("ring") << true;
+}
+
+void tst_QAVDemuxer::packetQueueBenchmark()
+{
+    QFETCH(bool, ring);
+
+    QAVDemuxer d;
+    QFileInfo file(testData("small.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QAVPacket packet;
+    QVERIFY(d.read(packet) >= 0);
+
+    const int count = 100000;
+    QBENCHMARK {
+        if (ring) {
+            QAVRingBuffer<QAVPacket> queue(1024);
+            auto producer = QtConcurrent::run([&] {
+                for (int i = 0; i < count; ++i) {
+                    while (!queue.push(packet))
+                        QThread::yieldCurrentThread();
+                }
+            });
+            QAVPacket p;
+            for (int i = 0; i < count; ++i) {
+                while (!queue.pop(p))
+                    QThread::yieldCurrentThread();
+            }
+            producer.waitForFinished();
+        } else {
+            MutexQueue queue;
+            auto producer = QtConcurrent::run([&] {
+                for (int i = 0; i < count; ++i)
+                    queue.push(packet);
+            });
+            for (int i = 0; i < count; ++i)
+                queue.pop();
+            producer.waitForFinished();
+        }
+    }
+}
+
+void tst_QAVDemuxer::codecThreading()
+{
+    QAVDemuxer d;
+    d.setInputVideoCodec("software");
+    QVERIFY(d.codecThreading().isNull());
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QVERIFY(!d.currentVideoStreams().isEmpty());
+    QVERIFY(!d.currentAudioStreams().isEmpty());
+    const int videoIndex = d.currentVideoStreams().first().index();
+    const int audioIndex = d.currentAudioStreams().first().index();
+    QVERIFY(d.currentVideoStreams().first().codec()->threading().isNull());
+    d.unload();
+
+    QAVCodecThreading threading(2, QAVCodecThreading::FrameThreading);
+    d.setCodecThreading(threading);
+    d.setCodecThreading(QAVCodecThreading::lowDelayPreset(1), audioIndex);
+    QCOMPARE(d.codecThreading(), threading);
+    QCOMPARE(d.codecThreading(videoIndex), threading);
+    QCOMPARE(d.codecThreading(audioIndex), QAVCodecThreading::lowDelayPreset(1));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    auto avctx = d.currentVideoStreams().first().codec()->avctx();
+    QCOMPARE(avctx->thread_count, 2);
+    QCOMPARE(avctx->thread_type, FF_THREAD_FRAME);
+    QVERIFY(!(avctx->flags & AV_CODEC_FLAG_LOW_DELAY));
+    avctx = d.currentAudioStreams().first().codec()->avctx();
+    QCOMPARE(avctx->thread_count, 1);
+    QCOMPARE(avctx->thread_type, FF_THREAD_SLICE);
+    QVERIFY(avctx->flags & AV_CODEC_FLAG_LOW_DELAY);
+
+    // Frame threading adds the delay
+    QAVPacket p;
+    int packets = 0;
+    int frames = 0;
+    while (d.read(p) >= 0) {
+        if (p.packet()->stream_index != videoIndex)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        ++packets;
+        frames += fs.size();
+    }
+    QVERIFY(frames > 0);
+    QVERIFY(frames < packets);
+    d.unload();
+
+    // Low delay disables frame threading
+    d.setCodecThreading(QAVCodecThreading::lowDelayPreset(2));
+    d.setCodecThreading({}, audioIndex);
+    QCOMPARE(d.codecThreading(audioIndex), QAVCodecThreading::lowDelayPreset(2));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    avctx = d.currentVideoStreams().first().codec()->avctx();
+    QCOMPARE(avctx->thread_count, 2);
+    QVERIFY(avctx->flags & AV_CODEC_FLAG_LOW_DELAY);
+    QVERIFY(avctx->active_thread_type != FF_THREAD_FRAME);
+
+    packets = 0;
+    frames = 0;
+    while (d.read(p) >= 0) {
+        if (p.packet()->stream_index != videoIndex)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        ++packets;
+        frames += fs.size();
+    }
+    QCOMPARE(frames, packets);
+}
+
+void tst_QAVDemuxer::codecThreadingBenchmark_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QAVCodecThreading>("threading");
+
+    for (const auto &path : {QString("7_BCL02006_ffv1_20s_1.mkv"), QString("colors.mp4")}) {
+        QTest::newRow(qPrintable(path + " default")) << path << QAVCodecThreading();
+        QTest::newRow(qPrintable(path + " frame")) << path << QAVCodecThreading(0, QAVCodecThreading::FrameThreading);
+        QTest::newRow(qPrintable(path + " slice")) << path << QAVCodecThreading(0, QAVCodecThreading::SliceThreading);
+        QTest::newRow(qPrintable(path + " low delay")) << path << QAVCodecThreading::lowDelayPreset();
+    }
+}
+
+void tst_QAVDemuxer::codecThreadingBenchmark()
+{
+    QFETCH(QString, path);
+    QFETCH(QAVCodecThreading, threading);
+
+    QAVDemuxer d;
+    d.setInputVideoCodec("software");
+    d.setCodecThreading(threading);
+    QFileInfo file(testData(path));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QVERIFY(!d.currentVideoStreams().isEmpty());
+    const int index = d.currentVideoStreams().first().index();
+
+    QList<QAVPacket> packets;
+    QAVPacket p;
+    while (packets.size() < 100 && d.read(p) >= 0) {
+        if (p.packet()->stream_index == index)
+            packets.append(p);
+    }
+    QVERIFY(!packets.isEmpty());
+
+    int frames = 0;
+    QBENCHMARK {
+        d.flushCodecBuffers();
+        for (const auto &pkt : packets) {
+            QList<QAVFrame> fs;
+            QAVDemuxer::decode(pkt, fs);
+            frames += fs.size();
+        }
+    }
+    QVERIFY(frames > 0);
+}
+
+void tst_QAVDemuxer::fastOpen()
+{
+    QAVDemuxer::clearStreamInfoCache();
+    QAVDemuxer d;
+    QCOMPARE(d.isFastOpen(), false);
+    QCOMPARE(d.probeSize(), qint64(0));
+    QCOMPARE(d.analyzeDuration(), qint64(0));
+    d.setProbeSize(1024 * 1024);
+    d.setAnalyzeDuration(1000);
+    QCOMPARE(d.probeSize(), qint64(1024 * 1024));
+    QCOMPARE(d.analyzeDuration(), qint64(1000));
+    d.setProbeSize(0);
+    d.setAnalyzeDuration(0);
+
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d.isStreamInfoRestored(), false);
+    const double duration = d.duration();
+    const double frameRate = d.videoFrameRate();
+    const int streams = d.availableStreams().size();
+    const QSize size = d.currentVideoStreams().first().codec()->size();
+    const int sampleRate = d.currentAudioStreams().first().codec()->avctx()->sample_rate;
+    d.unload();
+
+    // The stream info is cached only by fast open
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d.isStreamInfoRestored(), false);
+    d.unload();
+    d.setFastOpen(true);
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d.isStreamInfoRestored(), false);
+    d.unload();
+
+    QAVDemuxer d2;
+    d2.setFastOpen(true);
+    QVERIFY(d2.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d2.isStreamInfoRestored(), true);
+    QCOMPARE(d2.duration(), duration);
+    QCOMPARE(d2.videoFrameRate(), frameRate);
+    QCOMPARE(d2.availableStreams().size(), streams);
+    QCOMPARE(d2.currentVideoStreams().first().codec()->size(), size);
+    QCOMPARE(d2.currentAudioStreams().first().codec()->avctx()->sample_rate, sampleRate);
+
+    const int index = d2.currentVideoStreams().first().index();
+    QAVPacket p;
+    int frames = 0;
+    while (d2.read(p) >= 0) {
+        if (p.packet()->stream_index != index)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        for (const auto &f : fs) {
+            QAVVideoFrame vf = f;
+            QCOMPARE(vf.size(), size);
+            ++frames;
+        }
+    }
+    QCOMPARE(frames, 375);
+    d2.unload();
+    QCOMPARE(d2.isStreamInfoRestored(), false);
+
+    // The input options are part of the key
+    d2.setInputOptions({{"ignore_editlist", "1"}});
+    QVERIFY(d2.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d2.isStreamInfoRestored(), false);
+    d2.unload();
+    QVERIFY(d2.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d2.isStreamInfoRestored(), true);
+    d2.unload();
+    d2.setInputOptions({});
+
+    QAVDemuxer::clearStreamInfoCache();
+    QVERIFY(d2.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d2.isStreamInfoRestored(), false);
+}
+
+void tst_QAVDemuxer::fastOpenBenchmark_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<bool>("fast");
+    for (const auto &path : {QString("7_BCL02006_ffv1_20s_1.mkv"), QString("colors.mp4"), QString("star_trails.mpeg")}) {
+        QTest::newRow(qPrintable(path + " probe")) << path << false;
+        QTest::newRow(qPrintable(path + " fast")) << path << true;
+    }
+}
+
+// Time to the first decoded video frame
+void tst_QAVDemuxer::fastOpenBenchmark()
+{
+    QFETCH(QString, path);
+    QFETCH(bool, fast);
+
+    QAVDemuxer::clearStreamInfoCache();
+    QFileInfo file(testData(path));
+    if (fast) {
+        QAVDemuxer d;
+        d.setFastOpen(true);
+        QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    }
+
+    QBENCHMARK {
+        QAVDemuxer d;
+        d.setFastOpen(fast);
+        QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+        // MPEG-PS creates the streams while reading, it is probed with less data only
+        if (!path.endsWith(".mpeg"))
+            QCOMPARE(d.isStreamInfoRestored(), fast);
+        QVERIFY(!d.currentVideoStreams().isEmpty());
+        const int index = d.currentVideoStreams().first().index();
+        QList<QAVFrame> fs;
+        QAVPacket p;
+        while (fs.isEmpty() && d.read(p) >= 0) {
+            if (p.packet()->stream_index == index)
+                QAVDemuxer::decode(p, fs);
+        }
+        QVERIFY(!fs.isEmpty());
+    }
+}
+
+void tst_QAVDemuxer::sharedData()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    const int index = d.currentVideoStreams().first().index();
+
+    QList<QAVFrame> fs;
+    QAVPacket p;
+    while (fs.isEmpty() && d.read(p) >= 0) {
+        if (p.packet()->stream_index == index)
+            QAVDemuxer::decode(p, fs);
+    }
+    QVERIFY(!fs.isEmpty());
+
+    // Reading next packet does not change the copy
+    QAVPacket p2 = p;
+    const int size = std::as_const(p2).packet()->size;
+    QCOMPARE(std::as_const(p2).packet(), std::as_const(p).packet());
+    QVERIFY(d.read(p) >= 0);
+    QVERIFY(std::as_const(p2).packet() != std::as_const(p).packet());
+    QCOMPARE(std::as_const(p2).packet()->size, size);
+
+    // Non-const accessor detaches the copy
+    QAVPacket p3 = p2;
+    QVERIFY(p3.packet() != std::as_const(p2).packet());
+    QCOMPARE(std::as_const(p3).packet()->size, size);
+
+    // Moved packets are left empty
+    QAVPacket p4 = std::move(p3);
+    QCOMPARE(std::as_const(p4).packet()->size, size);
+    QVERIFY(!p3);
+    QCOMPARE(std::as_const(p3).packet()->size, 0);
+    QVERIFY(!p3.stream());
+
+    // The copies share the frame until one of them is changed
+    QAVFrame f = fs.at(0);
+    QVERIFY(!f.isDetached());
+    QCOMPARE(std::as_const(f).frame(), fs.at(0).frame());
+    f.setFilterName("test");
+    QVERIFY(f.isDetached());
+    QVERIFY(std::as_const(f).frame() != fs.at(0).frame());
+    QCOMPARE(std::as_const(f).frame()->data[0], fs.at(0).frame()->data[0]);
+    QCOMPARE(f.pts(), fs.at(0).pts());
+    QVERIFY(fs.at(0).filterName().isEmpty());
+
+    f.frame()->pts += 1000;
+    QVERIFY(f.pts() > fs.at(0).pts());
+
+    // Writing to a copy does not change the original
+    QAVFrame f2 = f;
+    f2.frame()->pts += 1000;
+    QVERIFY(f2.pts() > f.pts());
+
+    // Moved frames take the data and are left empty
+    const AVFrame *frame = std::as_const(f).frame();
+    QAVVideoFrame vf = f;
+    QAVVideoFrame vf2 = std::move(vf);
+    QCOMPARE(std::as_const(vf2).frame(), frame);
+    QCOMPARE(vf2.size(), QSize(frame->width, frame->height));
+    QVERIFY(!vf);
+    QCOMPARE(vf.size(), QSize(0, 0));
+    QVERIFY(qIsNaN(vf.pts()));
+    QVERIFY(vf.filterName().isEmpty());
+
+    // The empty data is not changed by the setters of the moved frames
+    QAVVideoFrame vf3 = vf2;
+    QAVVideoFrame vf4 = std::move(vf3);
+    vf.setFilterName("moved");
+    QCOMPARE(vf.filterName(), QString("moved"));
+    QVERIFY(vf3.filterName().isEmpty());
+
+    vf = vf2;
+    QCOMPARE(std::as_const(vf).frame(), frame);
+    QCOMPARE(std::as_const(vf4).frame(), frame);
+}
+
+class TestFrameAllocator : public QAVFrameAllocator
+{
+public:
+    bool allocate(AVPixelFormat format, const QSize &size, int align, Buffer &buffer) override
+    {
+        int linesizes[4] = {};
+        if (av_image_fill_linesizes(linesizes, format, size.width()) < 0)
+            return false;
+        for (int i = 0; i < 4; ++i)
+            linesizes[i] = FFALIGN(linesizes[i], align);
+        uint8_t *offsets[4] = {};
+        const int bytes = av_image_fill_pointers(offsets, format, size.height(), nullptr, linesizes);
+        if (bytes < 0)
+            return false;
+        // Each plane is aligned and padded
+        const int padding = align + 64;
+        auto mem = static_cast<uint8_t *>(av_malloc(bytes + 5 * padding));
+        auto base = reinterpret_cast<uint8_t *>(FFALIGN(reinterpret_cast<quintptr>(mem), quintptr(align)));
+        const int planes = av_pix_fmt_count_planes(format);
+        for (int i = 0; i < planes; ++i) {
+            const quintptr offset = reinterpret_cast<quintptr>(offsets[i]) + i * padding;
+            buffer.data[i] = base + FFALIGN(offset, quintptr(align));
+            buffer.bytesPerLine[i] = linesizes[i];
+        }
+        buffer.opaque = mem;
+        ++allocated;
+        return true;
+    }
+
+    void release(const Buffer &buffer) override
+    {
+        av_free(buffer.opaque);
+        ++released;
+    }
+
+    std::atomic<int> allocated{0};
+    std::atomic<int> released{0};
+};
+
+static QList<QByteArray> decodeFirstLines(QAVDemuxer &d, int count, QList<QAVFrame> *keep = nullptr)
+{
+    QList<QByteArray> lines;
+    const int index = d.currentVideoStreams().first().index();
+    QAVPacket p;
+    while (lines.size() < count && d.read(p) >= 0) {
+        if (p.packet()->stream_index != index)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        for (const auto &f : fs) {
+            auto frame = f.frame();
+            const int bytes = av_image_get_linesize(AVPixelFormat(frame->format), frame->width, 0);
+            lines.append(QByteArray(reinterpret_cast<const char *>(frame->data[0]), bytes));
+            if (keep)
+                keep->append(f);
+        }
+    }
+    return lines;
+}
+
+void tst_QAVDemuxer::framePool_data()
+{
+    QTest::addColumn<QString>("path");
+
+    for (const auto &path : {
+            QString("1.dv"), QString("20190821_075842.jpg"), QString("7_BCL02006_ffv1_20s_1.mkv"),
+            QString("DHC0413_CreaseOrNot.mp4"), QString("av_sample.mkv"), QString("chapters.mp4"),
+            QString("colors.mp4"), QString("colors_subtitles.mkv"), QString("guido.mp4"),
+            QString("rotated_90.mp4"), QString("small.mp4"), QString("star_trails.mpeg"),
+            QString("stream-index.mov"), QString("test.mkv"), QString("test_5beeps.mkv") }) {
+        QTest::newRow(qPrintable(path)) << path;
+    }
+}
+
+void tst_QAVDemuxer::framePool()
+{
+    QFETCH(QString, path);
+    QFileInfo file(testData(path));
+    const int count = 20;
+
+    QAVDemuxer d;
+    d.setInputVideoCodec("software");
+    QVERIFY(d.framePoolOptions().isNull());
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    if (d.currentVideoStreams().isEmpty())
+        QSKIP("No video streams");
+    const auto expected = decodeFirstLines(d, count);
+    QVERIFY(!expected.isEmpty());
+    QCOMPARE(d.framePoolStats().buffersAllocated, 0);
+    d.unload();
+
+    // Same frames are decoded to the pool and the buffers are reused
+    d.setFramePoolOptions({ 0, 128 });
+    QCOMPARE(d.framePoolOptions().alignment(), 128);
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QList<QAVFrame> frames;
+    QCOMPARE(decodeFirstLines(d, count, &frames), expected);
+    auto stats = d.framePoolStats();
+    QVERIFY(stats.buffersAllocated + stats.fallbacks > 0);
+    if (stats.buffersAllocated > 0) {
+        QVERIFY(stats.bytes > 0);
+        QVERIFY(stats.buffersInUse > 0);
+        for (const auto &f : frames) {
+            for (int i = 0; i < 4 && f.frame()->data[i]; ++i) {
+                QCOMPARE(reinterpret_cast<quintptr>(f.frame()->data[i]) % 128, quintptr(0));
+                QCOMPARE(f.frame()->linesize[i] % 128, 0);
+            }
+        }
+        // Released buffers are taken again
+        frames.clear();
+        if (!decodeFirstLines(d, count).isEmpty())
+            QVERIFY(d.framePoolStats().buffersReused > 0);
+    }
+    d.unload();
+
+    // Falls back to FFmpeg when the limit is reached
+    d.setFramePoolOptions({ 1 });
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(decodeFirstLines(d, count), expected);
+    stats = d.framePoolStats();
+    QCOMPARE(stats.buffersAllocated, 0);
+    QVERIFY(stats.fallbacks > 0);
+    d.unload();
+
+    // Decoded to the memory of the allocator
+    TestFrameAllocator allocator;
+    d.setFramePoolOptions({ 0, 0, &allocator });
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(decodeFirstLines(d, count, &frames), expected);
+    stats = d.framePoolStats();
+    QCOMPARE(stats.external, qint64(allocator.allocated));
+    QCOMPARE(stats.buffersAllocated, 0);
+    // Frames keep the buffers after the codecs are destroyed
+    d.unload();
+    QVERIFY(allocator.released < allocator.allocated || allocator.allocated == 0);
+    frames.clear();
+    QCOMPARE(allocator.released.load(), allocator.allocated.load());
+}
+
+static bool samePixels(const AVFrame *frame, const uchar *const data[4], const int bytesPerLine[4])
+{
+    auto format = AVPixelFormat(frame->format);
+    auto desc = av_pix_fmt_desc_get(format);
+    for (int i = 0; i < av_pix_fmt_count_planes(format); ++i) {
+        const int bytes = av_image_get_linesize(format, frame->width, i);
+        const int height = i == 1 || i == 2 ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        for (int y = 0; y < height; ++y) {
+            if (memcmp(frame->data[i] + y * frame->linesize[i], data[i] + y * bytesPerLine[i], bytes) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+void tst_QAVDemuxer::convertCache()
+{
+    QAVDemuxer d;
+    d.setInputFormat("lavfi");
+    QVERIFY(d.load("testsrc=size=1280x720:rate=1:duration=2") >= 0);
+    QVERIFY(!d.currentVideoStreams().isEmpty());
+
+    QAVVideoFrame frame;
+    QAVPacket p;
+    while (!frame && d.read(p) >= 0) {
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        if (!fs.isEmpty())
+            frame = fs.first();
+    }
+    QVERIFY(frame);
+    QCOMPARE(frame.size(), QSize(1280, 720));
+
+    QAVSwsCache::instance().clear();
+    const QAVVideoFrame yuv = frame.convertTo(AV_PIX_FMT_YUV420P);
+    QVERIFY(yuv);
+    QCOMPARE(yuv.format(), AV_PIX_FMT_YUV420P);
+    QCOMPARE(yuv.size(), frame.size());
+    QCOMPARE(yuv.pts(), frame.pts());
+    // Contexts are kept for the next frames
+    const int cached = QAVSwsCache::instance().size();
+    QVERIFY(cached > 0);
+    QVERIFY(cached <= QAVSwsCache::MaxContexts);
+
+    // Same result from the cached contexts
+    auto again = frame.convertTo(AV_PIX_FMT_YUV420P);
+    QVERIFY(samePixels(yuv.frame(), again.frame()->data, again.frame()->linesize));
+    QCOMPARE(QAVSwsCache::instance().size(), cached);
+
+    // Scaled
+    auto scaled = frame.convertTo(AV_PIX_FMT_RGB32, QSize(320, 180));
+    QVERIFY(scaled);
+    QCOMPARE(scaled.size(), QSize(320, 180));
+    QCOMPARE(scaled.format(), AV_PIX_FMT_RGB32);
+
+    // Buffer of the destination frame is reused
+    QAVVideoFrame dst;
+    QVERIFY(frame.convertTo(AV_PIX_FMT_YUV420P, {}, dst));
+    uint8_t *data = dst.frame()->data[0];
+    QVERIFY(frame.convertTo(AV_PIX_FMT_YUV420P, {}, dst));
+    QCOMPARE(dst.frame()->data[0], data);
+    QCOMPARE(dst.pts(), frame.pts());
+    QVERIFY(samePixels(yuv.frame(), dst.frame()->data, dst.frame()->linesize));
+
+    // But not if it is shared
+    QAVVideoFrame copy = dst;
+    QVERIFY(frame.convertTo(AV_PIX_FMT_YUV420P, {}, dst));
+    QVERIFY(dst.frame()->data[0] != copy.frame()->data[0]);
+
+    // Memory of the caller
+    uint8_t *planes[4] = {};
+    int bytesPerLine[4] = {};
+    QByteArray buffer(av_image_get_buffer_size(AV_PIX_FMT_YUV420P, 1280, 720, 32), 0);
+    QVERIFY(av_image_fill_arrays(planes, bytesPerLine, reinterpret_cast<uint8_t *>(buffer.data()), AV_PIX_FMT_YUV420P, 1280, 720, 32) >= 0);
+    QVERIFY(frame.convertTo(AV_PIX_FMT_YUV420P, {}, planes, bytesPerLine));
+    QVERIFY(samePixels(yuv.frame(), planes, bytesPerLine));
+}
+
+void tst_QAVDemuxer::audioConverterBenchmark_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<int>("sampleFormat");
+    QTest::addColumn<int>("sampleRate");
+
+    for (const auto &path : {QString("test.wav"), QString("test.mp3")}) {
+        QTest::newRow(qPrintable(path + " float 48000")) << path << int(QAVAudioFormat::Float) << 48000;
+        QTest::newRow(qPrintable(path + " int16 44100")) << path << int(QAVAudioFormat::Int16) << 44100;
+    }
+}
+
+void tst_QAVDemuxer::audioConverterBenchmark()
+{
+    QFETCH(QString, path);
+    QFETCH(int, sampleFormat);
+    QFETCH(int, sampleRate);
+
+    QAVDemuxer d;
+    QFileInfo file(testData(path));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QVERIFY(!d.currentAudioStreams().isEmpty());
+    const int index = d.currentAudioStreams().first().index();
+
+    QList<QAVAudioFrame> frames;
+    QAVPacket p;
+    while (d.read(p) >= 0) {
+        if (p.packet()->stream_index != index)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        for (const auto &f : fs)
+            frames.append(f);
+    }
+    QVERIFY(frames.size() > 10);
+
+    QAVAudioFormat format;
+    format.setSampleFormat(QAVAudioFormat::SampleFormat(sampleFormat));
+    format.setSampleRate(sampleRate);
+    format.setChannelCount(2);
+
+    // Writes to the memory of the caller
+    QAVAudioConverter conv;
+    QByteArray out(conv.convertedSize(frames.first(), format) * 4, 0);
+    QVERIFY(!out.isEmpty());
+    QVERIFY(conv.convert(frames.first(), format, reinterpret_cast<uchar *>(out.data()), out.size()) > 0);
+    const auto allocations = conv.allocations();
+    qint64 bytes = 0;
+    for (const auto &f : frames) {
+        QVERIFY(conv.convertedSize(f, format) <= out.size());
+        const int ret = conv.convert(f, format, reinterpret_cast<uchar *>(out.data()), out.size());
+        QVERIFY(ret >= 0);
+        bytes += ret;
+    }
+    QVERIFY(bytes > 0);
+    QCOMPARE(conv.allocations(), allocations);
+
+    // Buffer of data() is reused if the previous data is not kept
+    QAVAudioConverter dataConv;
+    const char *ptr = nullptr;
+    quint64 dataAllocations = 0;
+    for (int i = 0; i < 10; ++i) {
+        auto data = dataConv.data(frames[i], format);
+        QVERIFY(!data.isEmpty());
+        if (i > 0 && dataAllocations > 0 && dataConv.allocations() == dataAllocations)
+            QCOMPARE(data.constData(), ptr);
+        ptr = data.constData();
+        dataAllocations = dataConv.allocations();
+    }
+
+    // Frames of one stream share the resampler of the codec
+    QVERIFY(!frames[1].data().isEmpty());
+
+    QBENCHMARK {
+        for (const auto &f : frames)
+            conv.convert(f, format, reinterpret_cast<uchar *>(out.data()), out.size());
+    }
+    QCOMPARE(conv.allocations(), allocations);
+}
+
+void tst_QAVDemuxer::audioConverterDiscontinuity()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("test.mp3"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QVERIFY(!d.currentAudioStreams().isEmpty());
+    const int index = d.currentAudioStreams().first().index();
+
+    QList<QAVAudioFrame> frames;
+    QAVPacket p;
+    while (frames.size() < 4 && d.read(p) >= 0) {
+        if (p.packet()->stream_index != index)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        for (const auto &f : fs)
+            frames.append(f);
+    }
+    QVERIFY(frames.size() >= 4);
+    QVERIFY(!std::isnan(frames[2].pts()));
+
+    // Resampled to keep the delayed samples in the resampler
+    QAVAudioFormat format;
+    format.setSampleFormat(QAVAudioFormat::Float);
+    format.setSampleRate(frames.at(0).frame()->sample_rate == 44100 ? 48000 : 44100);
+    format.setChannelCount(2);
+
+    QAVAudioConverter fresh;
+    const QByteArray first = fresh.data(frames[0], format);
+    QVERIFY(!first.isEmpty());
+    const QByteArray third = QAVAudioConverter().data(frames[2], format);
+    QVERIFY(!third.isEmpty());
+
+    // The skipped frame does not get the samples of the previous one
+    QAVAudioConverter conv;
+    QVERIFY(!conv.data(frames[0], format).isEmpty());
+    QCOMPARE(conv.data(frames[2], format), third);
+    // Neither does the same frame converted again
+    QCOMPARE(conv.data(frames[0], format), first);
+    // The following frame keeps them
+    QVERIFY(conv.data(frames[1], format) != QAVAudioConverter().data(frames[1], format));
+
+    // The converted data is cached in the shared data of the frame
+    QCOMPARE(sizeof(QAVAudioFrame), sizeof(QAVFrame));
+    const QAVAudioFrame copy = frames[3];
+    const QByteArray data = frames[3].data();
+    QVERIFY(!data.isEmpty());
+    QCOMPARE(copy.data().constData(), data.constData());
+    QCOMPARE(frames[3].data().constData(), data.constData());
+}
+
+void tst_QAVDemuxer::pcmRing()
+{
+    QAVPcmRing ring;
+    ring.reset(1000);
+    QCOMPARE(ring.capacity(), size_t(1000));
+    QCOMPARE(ring.size(), size_t(0));
+
+    // Reading from empty ring does not wait
+    char buf[1500] = {};
+    QCOMPARE(ring.read(buf, sizeof(buf)), size_t(0));
+
+    // Exact size and wrapping
+    QByteArray data(700, 'a');
+    QCOMPARE(ring.write(data.constData(), data.size()), size_t(700));
+    QCOMPARE(ring.size(), size_t(700));
+    QCOMPARE(ring.read(buf, 500), size_t(500));
+    QCOMPARE(ring.size(), size_t(200));
+    data.fill('b');
+    QCOMPARE(ring.write(data.constData(), data.size()), size_t(700));
+    QCOMPARE(ring.size(), size_t(900));
+    QCOMPARE(ring.freeSpace(), size_t(100));
+    QCOMPARE(ring.write(data.constData(), data.size()), size_t(100));
+    QCOMPARE(ring.size(), size_t(1000));
+    QCOMPARE(ring.read(buf, sizeof(buf)), size_t(1000));
+    QCOMPARE(QByteArray(buf, 200), QByteArray(200, 'a'));
+    QCOMPARE(QByteArray(buf + 200, 800), QByteArray(800, 'b'));
+
+    // Cleared bytes are not read
+    QCOMPARE(ring.write(data.constData(), data.size()), size_t(700));
+    ring.clear();
+    QCOMPARE(ring.size(), size_t(0));
+    QCOMPARE(ring.freeSpace(), size_t(1000));
+    QCOMPARE(ring.read(buf, sizeof(buf)), size_t(0));
+
+    // Producer and consumer on different threads
+    ring.reset(4096);
+    const int total = 10 * 1024 * 1024;
+    std::atomic<bool> ok{true};
+    auto producer = QtConcurrent::run([&] {
+        char chunk[997];
+        int written = 0;
+        while (written < total) {
+            const int size = qMin(int(sizeof(chunk)), total - written);
+            for (int i = 0; i < size; ++i)
+                chunk[i] = char((written + i) % 251);
+            int done = 0;
+            while (done < size)
+                done += int(ring.write(chunk + done, size_t(size - done)));
+            written += size;
+        }
+    });
+
+    int read = 0;
+    char chunk[1331];
+    while (read < total) {
+        const size_t size = ring.read(chunk, sizeof(chunk));
+        for (size_t i = 0; i < size; ++i) {
+            if (chunk[i] != char((read + int(i)) % 251))
+                ok = false;
+        }
+        read += int(size);
+        QVERIFY(ring.size() <= ring.capacity());
+    }
+    producer.waitForFinished();
+    QVERIFY(ok);
+    QCOMPARE(ring.size(), size_t(0));
+}
+
+static QAVAudioFrame floatFrame(int sampleRate, int samples, float value)
+{
+    QAVAudioFrame frame;
+    AVFrame *f = frame.frame();
+    f->format = AV_SAMPLE_FMT_FLT;
+    f->sample_rate = sampleRate;
+    f->nb_samples = samples;
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+    f->channels = 2;
+    f->channel_layout = AV_CH_LAYOUT_STEREO;
+#else
+    av_channel_layout_default(&f->ch_layout, 2);
+#endif
+    if (av_frame_get_buffer(f, 0) < 0)
+        return {};
+    auto data = reinterpret_cast<float *>(f->data[0]);
+    for (int i = 0; i < samples * 2; ++i)
+        data[i] = value;
+    return frame;
+}
+
+void tst_QAVDemuxer::audioMixer()
+{
+    const int rate = 48000;
+    QAVAudioMixer mixer;
+    mixer.setFormat(rate, 2);
+    QCOMPARE(mixer.format().sampleFormat(), QAVAudioFormat::Float);
+    mixer.setGain(1, 0.5f);
+    mixer.setPan(2, 1.0f);
+    QCOMPARE(mixer.gain(1), 0.5f);
+    QCOMPARE(mixer.pan(2), 1.0f);
+    QCOMPARE(mixer.gain(3), 1.0f);
+
+    // Both inputs are mixed with own gain and pan
+    std::vector<float> out;
+    QVERIFY(mixer.write(1, floatFrame(rate, 480, 0.5f)));
+    QVERIFY(mixer.write(2, floatFrame(rate, 480, 0.25f)));
+    QCOMPARE(mixer.read(out), 480);
+    QCOMPARE(out.size(), size_t(960));
+    QCOMPARE(out[0], 0.25f);
+    QCOMPARE(out[1], 0.5f);
+    QCOMPARE(out[958], 0.25f);
+    QCOMPARE(out[959], 0.5f);
+
+    // Waits for the input which is a bit behind
+    QVERIFY(mixer.write(1, floatFrame(rate, 480, 0.5f)));
+    QCOMPARE(mixer.read(out), 0);
+    QVERIFY(mixer.write(2, floatFrame(rate, 480, 0.25f)));
+    QCOMPARE(mixer.read(out), 480);
+
+    // The stalled input is mixed as silence
+    QVERIFY(mixer.write(1, floatFrame(rate, rate / 2, 0.5f)));
+    QCOMPARE(mixer.read(out), rate / 2);
+    QCOMPARE(out[0], 0.25f);
+    QCOMPARE(out[1], 0.25f);
+
+    mixer.removeInput(2);
+    QCOMPARE(mixer.inputs(), QList<int>{1});
+    mixer.clear();
+    QCOMPARE(mixer.read(out), 0);
+
+    // Vectorized kernel gives the same as scalar one
+    std::vector<float> src(1003), dst(1003), expected(1003);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = float(i % 17) / 17;
+        dst[i] = expected[i] = float(i % 5) / 5;
+    }
+    const float gains[4] = {1.0f, 0.5f, 0.25f, 2.0f};
+    for (size_t i = 0; i < src.size(); ++i)
+        expected[i] += src[i] * gains[i % 4];
+    QAVAudioMixer::mix(dst.data(), src.data(), int(src.size()), gains);
+    for (size_t i = 0; i < dst.size(); ++i)
+        QVERIFY(qAbs(dst[i] - expected[i]) < 1e-6f);
+
+    // Clipped when converted to integers
+    const float samples[3] = {2.0f, -2.0f, 0.0f};
+    qint16 s16[3] = {};
+    QCOMPARE(QAVAudioMixer::store(samples, 3, QAVAudioFormat::Int16, reinterpret_cast<char *>(s16)), 6);
+    QCOMPARE(s16[0], qint16(32767));
+    QCOMPARE(s16[1], qint16(-32767));
+    QCOMPARE(s16[2], qint16(0));
+}
+
+void tst_QAVDemuxer::frameCacheGop()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    const int index = d.currentVideoStreams().first().index();
+
+    const qint64 maxBytes = qint64(1) << 40;
+    QAVFrameCache cache;
+    cache.setMaxBytes(maxBytes);
+    // Nothing is known about the GOPs yet
+    QCOMPARE(cache.budget(), maxBytes);
+
+    auto frameBytes = [](const QAVFrame &f) {
+        qint64 bytes = 0;
+        for (auto buf : f.frame()->buf) {
+            if (buf)
+                bytes += buf->size;
+        }
+        return bytes;
+    };
+    auto isKeyFrame = [](const QAVFrame &f) {
+#ifdef AV_FRAME_FLAG_KEY
+        return (f.frame()->flags & AV_FRAME_FLAG_KEY) != 0;
+#else
+        return f.frame()->key_frame != 0;
+#endif
+    };
+
+    QList<qint64> gops;
+    QAVPacket p;
+    while (d.read(p) >= 0) {
+        if (std::as_const(p).packet()->stream_index != index)
+            continue;
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        for (const auto &f : fs) {
+            if (isKeyFrame(f))
+                gops.append(0);
+            if (!gops.isEmpty())
+                gops.last() += frameBytes(f);
+            cache.insert(f);
+        }
+    }
+    if (gops.size() < 2)
+        QSKIP("The video has only one GOP");
+
+    // The last GOP is not completed
+    gops.removeLast();
+    const qint64 gop = *std::max_element(gops.begin(), gops.end());
+    QCOMPARE(cache.budget(), gop + gop / 8);
+    QVERIFY(cache.bytes() <= cache.budget());
+    QVERIFY(cache.size() > 0);
+
+    // Max bytes caps the budget
+    cache.setMaxBytes(gop / 2);
+    QCOMPARE(cache.budget(), gop / 2);
+    QVERIFY(cache.bytes() <= gop / 2);
+
+    // New media is measured again
+    cache.setMaxBytes(maxBytes);
+    cache.reset();
+    QCOMPARE(cache.size(), 0);
+    QCOMPARE(cache.budget(), maxBytes);
+}
+
+void tst_QAVDemuxer::convertBands()
+{
+    QAVDemuxer d;
+    d.setInputFormat("lavfi");
+    QVERIFY(d.load("testsrc2=size=1280x720:rate=1:duration=1") >= 0);
+
+    QAVVideoFrame frame;
+    QAVPacket p;
+    while (!frame && d.read(p) >= 0) {
+        QList<QAVFrame> fs;
+        QAVDemuxer::decode(p, fs);
+        if (!fs.isEmpty())
+            frame = fs.first();
+    }
+    QVERIFY(frame);
+    // Subsampled chroma is interpolated across the rows of the bands
+    const QAVVideoFrame yuv = frame.convertTo(AV_PIX_FMT_YUV420P);
+    QVERIFY(yuv);
+
+    const QList<QSize> sizes = { yuv.size(), QSize(1920, 1080), QSize(640, 1440) };
+    for (const auto &size : sizes) {
+        qputenv("QT_AVPLAYER_SCALE_THREADS", "1");
+        const QAVVideoFrame single = yuv.convertTo(AV_PIX_FMT_RGB32, size);
+        qputenv("QT_AVPLAYER_SCALE_THREADS", "4");
+        const QAVVideoFrame banded = yuv.convertTo(AV_PIX_FMT_RGB32, size);
+        qunsetenv("QT_AVPLAYER_SCALE_THREADS");
+        QVERIFY(single);
+        QVERIFY(banded);
+        QCOMPARE(banded.size(), size);
+        QVERIFY2(samePixels(single.frame(), banded.frame()->data, banded.frame()->linesize),
+                 qPrintable(QString("%1x%2").arg(size.width()).arg(size.height())));
+    }
+}
+
+// Frame at pts in samples
+static QAVAudioFrame ptsFrame(const QAVStream &stream, int sampleRate, int samples, float value, qint64 pts)
+{
+    QAVAudioFrame frame = floatFrame(sampleRate, samples, value);
+    frame.setStream(stream);
+    frame.setTimeBase(AVRational{1, sampleRate});
+    frame.frame()->pts = pts;
+    return frame;
+}
+
+// All the samples of the channels are equal to the value
+static bool sameSamples(const std::vector<float> &out, int from, int to, float value)
+{
+    for (int i = from * 2; i < to * 2; ++i) {
+        if (out[size_t(i)] != value)
+            return false;
+    }
+    return true;
+}
+
+void tst_QAVDemuxer::audioMixerPts()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("test.wav"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    const QAVStream stream = d.currentAudioStreams().first();
+    const int rate = 48000;
+    std::vector<float> out;
+
+    // Offset pts is placed at the exact sample
+    {
+        QAVAudioMixer mixer;
+        mixer.setFormat(rate, 2);
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 0)));
+        QVERIFY(mixer.write(2, ptsFrame(stream, rate, 480, 0.25f, 100)));
+        QCOMPARE(mixer.read(out), 480);
+        QVERIFY(sameSamples(out, 0, 100, 0.5f));
+        QVERIFY(sameSamples(out, 100, 480, 0.75f));
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 480)));
+        QCOMPARE(mixer.read(out), 100);
+        QVERIFY(sameSamples(out, 0, 100, 0.75f));
+    }
+
+    // Seeks re-anchor the input to its current position, no silence is inserted
+    {
+        QAVAudioMixer mixer;
+        mixer.setFormat(rate, 2);
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, rate)));
+        QCOMPARE(mixer.read(out), 480);
+        // Backward
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 0)));
+        QCOMPARE(mixer.read(out), 480);
+        QVERIFY(sameSamples(out, 0, 480, 0.5f));
+        // Forward
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 20 * rate)));
+        QCOMPARE(mixer.read(out), 480);
+        QVERIFY(sameSamples(out, 0, 480, 0.5f));
+        // Continues from the new anchor
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 20 * rate + 480)));
+        QCOMPARE(mixer.read(out), 480);
+        QVERIFY(sameSamples(out, 0, 480, 0.5f));
+    }
+
+    // Gaps and overlaps up to 2 ms are joined, bigger gaps are filled with silence
+    {
+        QAVAudioMixer mixer;
+        mixer.setFormat(rate, 2);
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 0)));
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 480 + rate / 500)));
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 960 - 50)));
+        QCOMPARE(mixer.read(out), 1440);
+        QVERIFY(sameSamples(out, 0, 1440, 0.5f));
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.5f, 1440 + rate / 500 + 1)));
+        QCOMPARE(mixer.read(out), rate / 500 + 1 + 480);
+        QVERIFY(sameSamples(out, 0, rate / 500 + 1, 0.0f));
+        QVERIFY(sameSamples(out, rate / 500 + 1, rate / 500 + 1 + 480, 0.5f));
+    }
+
+    // The samples behind the mixed position are trimmed
+    {
+        QAVAudioMixer mixer;
+        mixer.setFormat(rate, 2);
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 960, 0.5f, 0)));
+        QCOMPARE(mixer.read(out), 960);
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.25f, 960 - 100)));
+        QCOMPARE(mixer.read(out), 380);
+        QVERIFY(sameSamples(out, 0, 380, 0.25f));
+        // Entirely late
+        QVERIFY(mixer.write(1, ptsFrame(stream, rate, 480, 0.25f, 0)));
+        QCOMPARE(mixer.read(out), 0);
+    }
+}
+
 QTEST_MAIN(tst_QAVDemuxer)
 #include "tst_qavdemuxer.moc"
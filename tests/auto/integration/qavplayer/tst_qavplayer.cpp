@@ -6,13 +6,20 @@
  ***************************************************************/
 
 #include "qavplayer.h"
+#include "qavplaylist.h"
 #include "qavmuxerframes.h"
 #include "qavaudiooutput.h"
 #include "qaviodevice.h"
 #include "qavcodec_p.h"
+#include "qavscheduler_p.h"
+#ifdef QT_AVPLAYER_MULTIMEDIA
+#include "qavaudiooutputdevice_p.h"
+#endif
 
 #include <QDebug>
 #include <QtTest/QtTest>
+#include <atomic>
+#include <vector>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -66,6 +73,8 @@ private slots:
     void cast2QVideoFrame();
     void audioOutput();
     void multiPlayers();
+    void audioOutputClock();
+    void audioDeviceUnderrun();
 #endif
     void setEmptySource();
     void accurateSeek_data();
@@ -115,6 +124,25 @@ private slots:
     void muxerScaleHWSplit();
     void muxerScale_data();
     void muxerScale();
+    void demuxerWakeups();
+    void bufferingPolicy();
+    void stepBackwardCached();
+    void playBackward();
+    void trickPlay();
+    void codecThreading();
+    void sharedDecoderBenchmark_data();
+    void sharedDecoderBenchmark();
+    void playlist();
+    void metrics();
+    void frameDropPolicy();
+    void liveMode();
+    void clockJitter();
+    void masterClock();
+    void frameSink();
+    void frameSinkBenchmark_data();
+    void frameSinkBenchmark();
+    void speedAudioTempo();
+    void sharedDecoding();
 };
 
 void tst_QAVPlayer::initTestCase()
@@ -1959,6 +1987,138 @@ void tst_QAVPlayer::multiPlayers()
     QVERIFY(framesCount2 > 0);
 }
 
+void tst_QAVPlayer::audioOutputClock()
+{
+    QFileInfo file(testData("av_sample.mkv"));
+    QAVAudioOutput out;
+    out.setVolume(0);
+    out.setBufferSize(256 * 1024);
+    QVERIFY(out.time() < 0);
+
+    QAVPlayer p;
+    p.setAudioDeviceClock(&out);
+    QCOMPARE(p.audioDeviceClock(), &out);
+    std::atomic<double> sentPts{-1};
+    QObject::connect(&p, &QAVPlayer::audioFrame, &p, [&](const QAVAudioFrame &f) {
+        if (out.play(f))
+            sentPts = f.pts() + f.duration();
+    }, Qt::DirectConnection);
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_VERIFY(sentPts > 0);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const auto device = QMediaDevices::defaultAudioOutput();
+    const QString deviceName = device.description();
+#else
+    const auto device = QAudioDeviceInfo::defaultOutputDevice();
+    const QString deviceName = device.deviceName();
+#endif
+    // Nothing is played without the audio device
+    if (!device.isNull() && deviceName.toLower() != QLatin1String("null audio device")) {
+        QTRY_VERIFY(out.time() > 0);
+        // The played audio is behind the sent frames by the buffers
+        const double played = out.time();
+        QVERIFY(played <= sentPts + 0.05);
+        QTRY_VERIFY(out.time() > played);
+    }
+
+    out.stop();
+    QVERIFY(out.time() < 0);
+    p.stop();
+    p.setAudioDeviceClock(nullptr);
+}
+
+void tst_QAVPlayer::audioDeviceUnderrun()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("test.wav"));
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    const QAVStream stream = p.currentAudioStreams().first();
+
+    const int rate = 48000;
+    // 100 ms of stereo float samples
+    const int samples = rate / 10;
+    const qint64 bytes = qint64(samples) * 2 * qint64(sizeof(float));
+    auto makeFrame = [&](qint64 pts) {
+        QAVAudioFrame frame;
+        AVFrame *f = frame.frame();
+        f->format = AV_SAMPLE_FMT_FLT;
+        f->sample_rate = rate;
+        f->nb_samples = samples;
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+        f->channels = 2;
+        f->channel_layout = AV_CH_LAYOUT_STEREO;
+#else
+        av_channel_layout_default(&f->ch_layout, 2);
+#endif
+        if (av_frame_get_buffer(f, 0) < 0)
+            return QAVAudioFrame();
+        memset(f->data[0], 0, size_t(bytes));
+        f->pts = pts;
+        frame.setStream(stream);
+        frame.setTimeBase(AVRational{1, rate});
+        return frame;
+    };
+
+    QAVAudioFormat format;
+    format.setSampleFormat(QAVAudioFormat::Float);
+    format.setSampleRate(rate);
+    format.setChannelCount(2);
+    QAVAudioOutputDevice device;
+    device.start(format, 1000);
+    QVERIFY(device.time() < 0);
+    std::vector<char> data(size_t(bytes));
+
+    double last = -1;
+    bool ordered = true;
+    auto time = [&] {
+        const double t = device.time();
+        ordered = ordered && t >= last;
+        last = t;
+        return t;
+    };
+
+    // The first frame is played
+    device.play(makeFrame(0), format);
+    QCOMPARE(device.readData(data.data(), bytes), bytes);
+    device.setProcessedBytes(quint64(bytes));
+    QVERIFY(qAbs(time() - 0.1) < 0.001);
+
+    // Starved, the sink plays the silence and the time stays at the end of the data
+    QCOMPARE(device.readData(data.data(), bytes / 2), bytes / 2);
+    QCOMPARE(device.underruns(), quint64(1));
+    device.setProcessedBytes(quint64(bytes + bytes / 4));
+    QVERIFY(qAbs(time() - 0.1) < 0.001);
+    device.setProcessedBytes(quint64(bytes + bytes / 2));
+    QVERIFY(qAbs(time() - 0.1) < 0.001);
+
+    // Refilled while the queued silence is still being played
+    device.play(makeFrame(samples), format);
+    QCOMPARE(device.readData(data.data(), bytes), bytes);
+    device.setProcessedBytes(quint64(bytes + bytes / 4));
+    QVERIFY(qAbs(time() - 0.1) < 0.001);
+    device.setProcessedBytes(quint64(bytes + bytes / 2));
+    QVERIFY(qAbs(time() - 0.1) < 0.001);
+
+    // The new data does not lag behind by the silence
+    device.setProcessedBytes(quint64(bytes + bytes / 2 + bytes / 2));
+    const double t = time();
+    QVERIFY2(t >= 0.15 - 0.001 && t <= 0.2 + 0.001, qPrintable(QString::number(t)));
+    QTest::qWait(20);
+    QVERIFY(time() >= t);
+    QVERIFY(time() <= 0.2 + 0.001);
+
+    // An older update does not move the time backwards
+    device.setProcessedBytes(quint64(bytes + bytes / 2 + bytes / 4));
+    QVERIFY(time() >= t);
+    // Never goes backwards
+    QVERIFY(ordered);
+    device.stop();
+    QVERIFY(device.time() < 0);
+}
+
 #endif // #ifndef QT_AVPLAYER_MULTIMEDIA
 
 void tst_QAVPlayer::setEmptySource()
@@ -3813,5 +3973,859 @@ void tst_QAVPlayer::muxerScale()
     QCOMPARE(vf.size(), size);
 }
 
+void tst_QAVPlayer::demuxerWakeups()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("colors.mp4"));
+    QSignalSpy spyPaused(&p, &QAVPlayer::paused);
+    p.setSource(file.absoluteFilePath());
+    p.pause();
+    QTRY_COMPARE(spyPaused.count(), 1);
+
+    // Let the demuxer fill the buffers
+    QTest::qWait(200);
+    qint64 wakeups = p.metrics().demuxerWakeups();
+    QTest::qWait(500);
+    // Paused and buffered player does not wake up the demuxer
+    QCOMPARE(p.metrics().demuxerWakeups(), wakeups);
+
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QTest::qWait(200);
+    wakeups = p.metrics().demuxerWakeups();
+    QTest::qWait(500);
+    // Same after EOF
+    QCOMPARE(p.metrics().demuxerWakeups(), wakeups);
+
+    // Seek wakes up the demuxer
+    QSignalSpy spySeeked(&p, &QAVPlayer::seeked);
+    p.seek(100);
+    QTRY_COMPARE(spySeeked.count(), 1);
+    QVERIFY(p.metrics().demuxerWakeups() > wakeups);
+}
+
+void tst_QAVPlayer::bufferingPolicy()
+{
+    QAVBufferingPolicy policy;
+    QCOMPARE(policy, QAVBufferingPolicy());
+    policy.setMaxBytes(64 * 1024);
+    policy.setMaxDuration(0);
+    policy.setMaxBytes(1024, QAVBufferingPolicy::VideoStreams, QAVBufferingPolicy::LiveSource);
+    policy.setLowWatermark(0.3);
+    policy.setHighWatermark(0.8);
+    QVERIFY(policy != QAVBufferingPolicy());
+    QCOMPARE(policy.maxBytes(), qint64(64 * 1024));
+    QCOMPARE(policy.maxDuration(), 0.0);
+    QCOMPARE(policy.maxBytes(QAVBufferingPolicy::VideoStreams), qint64(0));
+    QCOMPARE(policy.maxBytes(QAVBufferingPolicy::VideoStreams, QAVBufferingPolicy::LiveSource), qint64(1024));
+    QCOMPARE(policy.lowWatermark(), 0.3);
+    QCOMPARE(policy.highWatermark(), 0.8);
+
+    QAVPlayer p;
+    p.setBufferingPolicy(policy);
+    QCOMPARE(p.bufferingPolicy(), policy);
+    QCOMPARE(p.bufferingProgress(), 0.0);
+
+    QFileInfo file(testData("av_sample.mkv"));
+    QSignalSpy spyProgress(&p, &QAVPlayer::bufferingProgressChanged);
+    p.setSource(file.absoluteFilePath());
+    p.pause();
+    QTRY_COMPARE(p.bufferingProgress(), 1.0);
+    QVERIFY(spyProgress.count() > 0);
+    QCOMPARE(spyProgress.last()[0].toReal(), 1.0);
+
+    // Bigger limits resume the demuxer
+    policy.setMaxBytes(0);
+    policy.setMaxDuration(100);
+    p.setBufferingPolicy(policy);
+    QTRY_VERIFY(p.bufferingProgress() < 1.0);
+
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QTRY_COMPARE(p.bufferingProgress(), 0.0);
+}
+
+void tst_QAVPlayer::stepBackwardCached()
+{
+    QAVPlayer p;
+    QCOMPARE(p.frameCacheSize(), qint64(256 * 1024 * 1024));
+
+    QFileInfo file(testData("small.mp4"));
+    QAVVideoFrame frame;
+    int framesCount = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frame = f; ++framesCount; });
+    QSignalSpy spySeeked(&p, &QAVPlayer::seeked);
+    QSignalSpy spyStepped(&p, &QAVPlayer::stepped);
+
+    p.setSource(file.absoluteFilePath());
+    p.seek(2500);
+    QTRY_COMPARE(spySeeked.count(), 1);
+    QTRY_COMPARE(framesCount, 1);
+    const double seekedPts = frame.pts();
+
+    // The frames decoded from the keyframe up to the position are cached
+    spySeeked.clear();
+    QList<double> backward;
+    for (int i = 0; i < 5; ++i) {
+        const double prev = frame.pts();
+        framesCount = 0;
+        p.stepBackward();
+        QTRY_COMPARE(spyStepped.count(), i + 1);
+        QTRY_COMPARE(framesCount, 1);
+        QVERIFY(frame.pts() < prev);
+        QCOMPARE(p.position(), qint64(frame.pts() * 1000));
+        backward.push_front(frame.pts());
+    }
+    QCOMPARE(spySeeked.count(), 0);
+    QCOMPARE(p.state(), QAVPlayer::PausedState);
+
+    // Stepping forward goes through the same frames
+    spyStepped.clear();
+    for (int i = 1; i < backward.size(); ++i) {
+        framesCount = 0;
+        p.stepForward();
+        QTRY_COMPARE(spyStepped.count(), i);
+        QTRY_COMPARE(framesCount, 1);
+        QCOMPARE(frame.pts(), backward[i]);
+    }
+    p.stepForward();
+    QTRY_COMPARE(spyStepped.count(), backward.size());
+    QTRY_COMPARE(frame.pts(), seekedPts);
+    // Continues decoding after the cached frames
+    p.stepForward();
+    QTRY_COMPARE(spyStepped.count(), backward.size() + 1);
+    QTRY_VERIFY(frame.pts() > seekedPts);
+    QCOMPARE(spySeeked.count(), 0);
+
+    // No cache, the GOP is decoded again
+    p.setFrameCacheSize(0);
+    p.stepBackward();
+    QTRY_COMPARE(spySeeked.count(), 1);
+    QTRY_COMPARE(frame.pts(), seekedPts);
+}
+
+void tst_QAVPlayer::playBackward()
+{
+    QAVPlayer p;
+
+    QFileInfo file(testData("colors.mp4"));
+    QList<double> frames;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frames.push_back(f.pts()); });
+    QSignalSpy spySeeked(&p, &QAVPlayer::seeked);
+    QSignalSpy spyPaused(&p, &QAVPlayer::paused);
+
+    p.setSource(file.absoluteFilePath());
+    p.seek(1000);
+    QTRY_COMPARE(spySeeked.count(), 1);
+    QTRY_COMPARE(frames.size(), 1);
+
+    // Several GOPs are decoded backward
+    p.setSpeed(-4);
+    p.play();
+    QTRY_COMPARE(p.state(), QAVPlayer::PausedState);
+    QTRY_COMPARE(spyPaused.count(), 1);
+    QVERIFY(frames.size() > 20);
+    for (int i = 1; i < frames.size(); ++i)
+        QVERIFY2(frames[i] < frames[i - 1], qPrintable(QString("%1 >= %2").arg(frames[i]).arg(frames[i - 1])));
+    QVERIFY(frames.last() < 0.05);
+    QCOMPARE(p.position(), qint64(frames.last() * 1000));
+    QCOMPARE(spySeeked.count(), 1);
+
+    // And forward again
+    frames.clear();
+    p.setSpeed(1);
+    p.play();
+    QTRY_VERIFY(frames.size() > 20);
+    for (int i = 1; i < frames.size(); ++i)
+        QVERIFY(frames[i] > frames[i - 1]);
+}
+
+void tst_QAVPlayer::trickPlay()
+{
+    QAVPlayer p;
+    QCOMPARE(p.isTrickPlay(), false);
+    QSignalSpy spyTrickPlay(&p, &QAVPlayer::trickPlayChanged);
+    p.setTrickPlay(true);
+    QCOMPARE(p.isTrickPlay(), true);
+    QCOMPARE(spyTrickPlay.count(), 1);
+
+    QFileInfo file(testData("colors.mp4"));
+    QAVVideoFrame frame;
+    int framesCount = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frame = f; ++framesCount; });
+    QSignalSpy spySeeked(&p, &QAVPlayer::seeked);
+
+    // Only keyframes are decoded, one per 12 frames
+    p.setSource(file.absoluteFilePath());
+    p.setSpeed(4);
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QVERIFY(framesCount > 0);
+    QVERIFY2(framesCount <= 32, qPrintable(QString::number(framesCount)));
+
+    // Seeking stops at the keyframe before the position
+    p.pause();
+    QTRY_VERIFY(frame);
+    spySeeked.clear();
+    p.seek(1000);
+    QTRY_COMPARE(spySeeked.count(), 1);
+    QTRY_COMPARE(frame.pts(), 0.96);
+
+    // All frames are decoded again
+    p.setTrickPlay(false);
+    QCOMPARE(spyTrickPlay.count(), 2);
+    p.seek(1000);
+    QTRY_COMPARE(spySeeked.count(), 2);
+    QTRY_COMPARE(frame.pts(), 1.0);
+
+    framesCount = 0;
+    p.seek(0);
+    QTRY_COMPARE(spySeeked.count(), 3);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QTRY_VERIFY(framesCount > 300);
+}
+
+void tst_QAVPlayer::codecThreading()
+{
+    QAVPlayer p;
+    QVERIFY(p.codecThreading().isNull());
+    QSignalSpy spyThreading(&p, &QAVPlayer::codecThreadingChanged);
+    QAVCodecThreading threading(2, QAVCodecThreading::FrameThreading);
+    p.setCodecThreading(threading);
+    p.setCodecThreading(threading);
+    QCOMPARE(spyThreading.count(), 1);
+    QCOMPARE(p.codecThreading(), threading);
+    QCOMPARE(p.codecThreading(0), threading);
+
+    QFileInfo file(testData("colors.mp4"));
+    int framesCount = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++framesCount; });
+
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    auto avctx = p.currentVideoStreams().first().codec()->avctx();
+    QCOMPARE(avctx->thread_count, 2);
+    QCOMPARE(avctx->thread_type, FF_THREAD_FRAME);
+    // Delayed frames are flushed at the end
+    QTRY_COMPARE(framesCount, 375);
+
+    p.setCodecThreading(QAVCodecThreading::lowDelayPreset());
+    QCOMPARE(spyThreading.count(), 2);
+    framesCount = 0;
+    p.setSource({});
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    avctx = p.currentVideoStreams().first().codec()->avctx();
+    QVERIFY(avctx->flags & AV_CODEC_FLAG_LOW_DELAY);
+    QCOMPARE(avctx->thread_type, FF_THREAD_SLICE);
+    QTRY_COMPARE(framesCount, 375);
+}
+
+void tst_QAVPlayer::sharedDecoderBenchmark_data()
+{
+    QTest::addColumn<int>("players");
+    QTest::addColumn<bool>("shared");
+    for (int players : {1, 8, 32}) {
+        QTest::newRow(qPrintable(QString("%1 own").arg(players))) << players << false;
+        QTest::newRow(qPrintable(QString("%1 shared").arg(players))) << players << true;
+    }
+}
+
+// Threads of the process, -1 if not known
+static int processThreads()
+{
+    QDir dir(QLatin1String("/proc/self/task"));
+    return dir.exists() ? int(dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).size()) : -1;
+}
+
+void tst_QAVPlayer::sharedDecoderBenchmark()
+{
+    QFETCH(int, players);
+    QFETCH(bool, shared);
+
+    QFileInfo file(testData("colors.mp4"));
+    std::atomic_int framesCount{0};
+    // The shared threads are not counted for the players
+    QVERIFY(QAVScheduler::instance().threadCount() > 0);
+    QBENCHMARK {
+        framesCount = 0;
+        const int threadsBefore = processThreads();
+        std::vector<std::unique_ptr<QAVPlayer>> list;
+        for (int i = 0; i < players; ++i) {
+            list.emplace_back(new QAVPlayer);
+            auto p = list.back().get();
+            QObject::connect(p, &QAVPlayer::videoFrame, p, [&](const QAVVideoFrame &) { ++framesCount; }, Qt::DirectConnection);
+            p->setSynced(false);
+            p->setSharedDecoding(shared);
+            p->setSource(file.absoluteFilePath());
+            p->play();
+        }
+        for (auto &p : list)
+            QTRY_COMPARE_WITH_TIMEOUT(p->mediaStatus(), QAVPlayer::EndOfMedia, 60000);
+        QTRY_COMPARE(int(framesCount), players * 375);
+
+        if (threadsBefore >= 0) {
+            // The demuxer and the presentation threads, and the decoders if they are not shared
+            int expected = 0;
+            for (auto &p : list) {
+                const int decoder = shared ? 0 : 1;
+                expected += 1
+                    + (!p->availableVideoStreams().isEmpty() ? 1 + decoder : 0)
+                    + (!p->availableAudioStreams().isEmpty() ? 1 + decoder : 0)
+                    + (!p->availableSubtitleStreams().isEmpty() ? 1 : 0);
+            }
+            const int threads = processThreads() - threadsBefore;
+            QVERIFY2(threads <= expected, qPrintable(QString("%1 > %2").arg(threads).arg(expected)));
+            // Each player used to keep a pool of 4 threads
+            if (shared)
+                QVERIFY2(threads < players * 4, qPrintable(QString::number(threads)));
+        }
+    }
+}
+
+void tst_QAVPlayer::playlist()
+{
+    QAVPlaylist playlist;
+    QCOMPARE(playlist.currentIndex(), -1);
+    QCOMPARE(playlist.state(), QAVPlayer::StoppedState);
+    playlist.append(QFileInfo(testData("colors.mp4")).absoluteFilePath(), 0, 1000);
+    playlist.append(QFileInfo(testData("small.mp4")).absoluteFilePath(), 500, 1500);
+    QCOMPARE(playlist.entries().size(), 2);
+
+    // The players see the device clock through the playlist
+    struct DeviceClock : public QAVClock
+    {
+        double time() const override { return 0.25; }
+    } device;
+    QVERIFY(!playlist.audioDeviceClock());
+    playlist.setAudioDeviceClock(&device);
+    QVERIFY(playlist.audioDeviceClock() == &device);
+    QVERIFY(playlist.currentPlayer()->audioDeviceClock() != nullptr);
+    QVERIFY(playlist.currentPlayer()->audioDeviceClock() != playlist.nextPlayer()->audioDeviceClock());
+    QCOMPARE(playlist.currentPlayer()->audioDeviceClock()->time(), 0.25);
+    playlist.setAudioDeviceClock(nullptr);
+    QVERIFY(!playlist.currentPlayer()->audioDeviceClock());
+
+    QMutex mutex;
+    QList<double> pts;
+    QObject::connect(&playlist, &QAVPlaylist::videoFrame, &playlist, [&](const QAVVideoFrame &frame) {
+        QMutexLocker locker(&mutex);
+        pts.append(frame.pts());
+    }, Qt::DirectConnection);
+    QSignalSpy spyIndex(&playlist, &QAVPlaylist::currentIndexChanged);
+    QSignalSpy spyFinished(&playlist, &QAVPlaylist::finished);
+
+    playlist.play();
+    QCOMPARE(playlist.state(), QAVPlayer::PlayingState);
+    QCOMPARE(playlist.currentIndex(), 0);
+    QTRY_COMPARE_WITH_TIMEOUT(playlist.currentIndex(), 1, 5000);
+    QVERIFY(playlist.position() >= 1000);
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 1, 5000);
+    QCOMPARE(playlist.currentIndex(), -1);
+    QCOMPARE(playlist.state(), QAVPlayer::StoppedState);
+    QCOMPARE(playlist.position(), qint64(2000));
+    QCOMPARE(spyIndex.count(), 3);
+
+    // Only the frames between in and out points are sent
+    QMutexLocker locker(&mutex);
+    int next = 1;
+    while (next < pts.size() && pts[next] > pts[next - 1])
+        ++next;
+    QVERIFY(next < pts.size());
+    QCOMPARE(next, 25);
+    QCOMPARE(pts.first(), 0.0);
+    QVERIFY(pts[next - 1] < 1.0);
+    QCOMPARE(pts.size() - next, 30);
+    QVERIFY2(qAbs(pts[next] - 0.5) < 0.001, qPrintable(QString::number(pts[next])));
+    QVERIFY(pts.last() < 1.5);
+    for (int i = next + 1; i < pts.size(); ++i)
+        QVERIFY(pts[i] > pts[i - 1]);
+}
+
+void tst_QAVPlayer::metrics()
+{
+    QAVPlayer p;
+    QCOMPARE(p.metricsInterval(), 0);
+    auto m = p.metrics();
+    QCOMPARE(m.stream(QAVPlayerMetrics::Video).packetsRead, qint64(0));
+    QCOMPARE(m.stream(QAVPlayerMetrics::Video).decodeTime.count(), qint64(0));
+
+    std::atomic_int framesCount{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++framesCount; }, Qt::DirectConnection);
+    QSignalSpy spyMetrics(&p, &QAVPlayer::metricsChanged);
+    p.setMetricsInterval(10);
+    QCOMPARE(p.metricsInterval(), 10);
+
+    QFileInfo file(testData("colors.mp4"));
+    p.setSynced(false);
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QTRY_COMPARE(int(framesCount), 375);
+    QTRY_VERIFY(spyMetrics.count() > 0);
+
+    m = p.metrics();
+    const auto &video = m.stream(QAVPlayerMetrics::Video);
+    QCOMPARE(video.packetsRead, qint64(375));
+    QVERIFY(video.bytesRead > 0);
+    QCOMPARE(video.packetsBuffered, qint64(0));
+    QCOMPARE(video.framesDecoded, qint64(375));
+    QCOMPARE(video.framesSent, qint64(375));
+    QCOMPARE(video.framesLate, qint64(0));
+    QCOMPARE(video.framesDropped, qint64(0));
+    QVERIFY(video.decodeTime.count() > 0);
+    QVERIFY(video.decodeTime.max() >= video.decodeTime.mean());
+    QVERIFY(video.decodeTime.percentile(0.5) <= video.decodeTime.percentile(0.99));
+    QVERIFY(video.decodeFps() > 0);
+    QVERIFY(video.filterTime.count() >= 375);
+    QCOMPARE(video.clockWaitTime.count(), qint64(375));
+    qint64 buckets = 0;
+    for (int i = 0; i < QAVPlayerMetrics::Histogram::BucketsCount; ++i)
+        buckets += video.decodeTime.bucket(i);
+    QCOMPARE(buckets, video.decodeTime.count());
+
+    QCOMPARE(QAVPlayerMetrics::Histogram::bucketIndex(0), 0);
+    QCOMPARE(QAVPlayerMetrics::Histogram::bucketIndex(1), 0);
+    QCOMPARE(QAVPlayerMetrics::Histogram::bucketIndex(2), 1);
+    QCOMPARE(QAVPlayerMetrics::Histogram::bucketIndex(1000), 9);
+
+    // Reset when new source is loaded
+    p.setSource({});
+    QCOMPARE(p.metrics().stream(QAVPlayerMetrics::Video).packetsRead, qint64(0));
+    p.setMetricsInterval(0);
+    QCOMPARE(p.metricsInterval(), 0);
+}
+
+void tst_QAVPlayer::frameDropPolicy()
+{
+    QAVPlayer p;
+    QCOMPARE(p.frameDropPolicy(), QAVPlayer::NoFrameDrop);
+    QSignalSpy spyPolicy(&p, &QAVPlayer::frameDropPolicyChanged);
+    p.setFrameDropPolicy(QAVPlayer::DropLateFramesAndSkipDecoding);
+    QCOMPARE(p.frameDropPolicy(), QAVPlayer::DropLateFramesAndSkipDecoding);
+    QCOMPARE(spyPolicy.count(), 1);
+
+    // Presenting the video is slower than the audio
+    std::atomic_int framesCount{0};
+    std::atomic_int droppedCount{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) {
+        ++framesCount;
+        QTest::qSleep(80);
+    }, Qt::DirectConnection);
+    QObject::connect(&p, &QAVPlayer::videoFrameDropped, &p, [&](double) { ++droppedCount; }, Qt::DirectConnection);
+
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+    p.seek(12000);
+    p.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QVERIFY(droppedCount > 0);
+    QVERIFY(framesCount > 0);
+    QVERIFY(p.metrics().stream(QAVPlayerMetrics::Video).framesDropped >= droppedCount);
+
+    // All the frames are sent late
+    p.setFrameDropPolicy(QAVPlayer::NoFrameDrop);
+    QCOMPARE(spyPolicy.count(), 2);
+    p.setSource({});
+    framesCount = 0;
+    droppedCount = 0;
+    p.setSource(file.absoluteFilePath());
+    p.seek(12000);
+    p.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QTRY_VERIFY(framesCount >= 70);
+    QCOMPARE(int(droppedCount), 0);
+}
+
+void tst_QAVPlayer::liveMode()
+{
+    QAVPlayer p;
+    QCOMPARE(p.isLiveMode(), false);
+    QCOMPARE(p.liveLatencyTarget(), qint64(200));
+    QSignalSpy spyLive(&p, &QAVPlayer::liveModeChanged);
+    QSignalSpy spyTarget(&p, &QAVPlayer::liveLatencyTargetChanged);
+    p.setLiveMode(true);
+    p.setLiveLatencyTarget(100);
+    QCOMPARE(p.isLiveMode(), true);
+    QCOMPARE(p.liveLatencyTarget(), qint64(100));
+    QCOMPARE(spyLive.count(), 1);
+    QCOMPARE(spyTarget.count(), 1);
+
+    std::atomic_int framesCount{0};
+    std::atomic_bool stall{false};
+    double lastPts = -1;
+    std::atomic<double> maxGap{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &frame) {
+        ++framesCount;
+        if (lastPts >= 0)
+            maxGap = qMax(maxGap.load(), frame.pts() - lastPts);
+        lastPts = frame.pts();
+        if (stall.exchange(false))
+            QTest::qSleep(2000);
+    }, Qt::DirectConnection);
+
+    // Real time source
+    p.setInputFormat("lavfi");
+    p.setSource("testsrc=size=160x120:rate=25,realtime");
+    p.play();
+    QTRY_VERIFY(framesCount > 10);
+    QVERIFY2(p.liveLatency() < 1000, qPrintable(QString::number(p.liveLatency())));
+
+    // The latency grows while the presentation is blocked,
+    // and the packets are dropped instead of catching up slowly
+    QVERIFY(maxGap < 0.5);
+    stall = true;
+    QTRY_VERIFY(!stall);
+    const int count = framesCount;
+    QTRY_VERIFY(framesCount > count + 10);
+    QVERIFY2(maxGap > 1.0, qPrintable(QString::number(maxGap)));
+    QTRY_VERIFY2(p.liveLatency() < 500, qPrintable(QString::number(p.liveLatency())));
+
+    p.stop();
+    QTRY_COMPARE(p.state(), QAVPlayer::StoppedState);
+}
+
+void tst_QAVPlayer::clockJitter()
+{
+    QAVPlayer p;
+    std::atomic_int framesCount{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++framesCount; }, Qt::DirectConnection);
+
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_VERIFY(framesCount > 50);
+
+    // The speed change wakes up the clocks and the frames are sent faster
+    p.setSpeed(4);
+    const int count = framesCount;
+    QTest::qWait(500);
+    QVERIFY2(framesCount - count > 30, qPrintable(QString::number(framesCount - count)));
+    p.pause();
+    QTRY_COMPARE(p.state(), QAVPlayer::PausedState);
+
+    const auto jitter = p.metrics().stream(QAVPlayerMetrics::Video).presentationJitter;
+    QVERIFY(jitter.count() > 0);
+    qDebug() << "Presentation jitter, us: p50" << jitter.percentile(0.5)
+             << "p99" << jitter.percentile(0.99) << "max" << jitter.max();
+    // Loaded machines wake up late
+    if (qEnvironmentVariableIntValue("QT_AVPLAYER_NO_TIMING_TESTS") > 0)
+        QSKIP("Timing checks are disabled by QT_AVPLAYER_NO_TIMING_TESTS");
+    // Sub-millisecond accuracy, polling every 10 ms would be far behind
+    QVERIFY2(jitter.percentile(0.5) < 1000, qPrintable(QString::number(jitter.percentile(0.5))));
+    QVERIFY2(jitter.percentile(0.99) < 5000, qPrintable(QString::number(jitter.percentile(0.99))));
+}
+
+// Wall clock which starts from the offset
+class WallClock : public QAVClock
+{
+public:
+    WallClock(double offset) : m_offset(offset) { m_timer.start(); }
+    double time() const override { return m_offset + m_timer.elapsed() / 1000.0; }
+
+private:
+    double m_offset = 0;
+    QElapsedTimer m_timer;
+};
+
+void tst_QAVPlayer::masterClock()
+{
+    QAVPlayer p;
+    QCOMPARE(p.masterClock(), QAVPlayer::AutoClock);
+    QVERIFY(!p.externalClock());
+    QSignalSpy spyClock(&p, &QAVPlayer::masterClockChanged);
+
+    std::atomic_int videoCount{0};
+    std::atomic_int audioCount{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++videoCount; }, Qt::DirectConnection);
+    QObject::connect(&p, &QAVPlayer::audioFrame, &p, [&](const QAVAudioFrame &) { ++audioCount; }, Qt::DirectConnection);
+
+    // Audio follows the video
+    QFileInfo file(testData("colors.mp4"));
+    p.setMasterClock(QAVPlayer::VideoClock);
+    QCOMPARE(p.masterClock(), QAVPlayer::VideoClock);
+    QCOMPARE(spyClock.count(), 1);
+    p.setSource(file.absoluteFilePath());
+    p.seek(13000);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QVERIFY(videoCount > 0);
+    QVERIFY(audioCount > 0);
+
+    // The frames are sent without delays until they catch up the external clock which is ahead by 8 sec
+    WallClock clock(8.0);
+    p.setExternalClock(&clock);
+    p.setMasterClock(QAVPlayer::ExternalClock);
+    QCOMPARE(p.externalClock(), &clock);
+    QCOMPARE(spyClock.count(), 2);
+    p.setSource({});
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_VERIFY_WITH_TIMEOUT(p.position() > 8000, 4000);
+    // And follow it after that
+    QTest::qWait(500);
+    QVERIFY2(qAbs(p.position() / 1000.0 - clock.time()) < 0.5,
+             qPrintable(QString("%1 vs %2").arg(p.position()).arg(clock.time())));
+
+    p.setSource({});
+    p.setExternalClock(nullptr);
+}
+
+// Keeps moved out video frames
+class FramesSink : public QAVFrameSink
+{
+public:
+    void takeVideoFrame(QAVVideoFrame &&frame) override
+    {
+        QMutexLocker locker(&mutex);
+        videoFrames.push_back(std::move(frame));
+    }
+
+    void audioFrame(const QAVAudioFrame &frame) override
+    {
+        if (frame)
+            ++audioCount;
+    }
+
+    QMutex mutex;
+    std::vector<QAVVideoFrame> videoFrames;
+    std::atomic_int audioCount{0};
+};
+
+void tst_QAVPlayer::frameSink()
+{
+    QAVPlayer p;
+    QVERIFY(!p.frameSink());
+    FramesSink sink;
+    p.setFrameSink(&sink);
+    QCOMPARE(p.frameSink(), &sink);
+
+    std::atomic_int videoCount{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &frame) { if (frame) ++videoCount; }, Qt::DirectConnection);
+
+    QFileInfo file(testData("small.mp4"));
+    p.setSynced(false);
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QTRY_COMPARE(int(videoCount), 165);
+    QTRY_COMPARE(int(sink.audioCount), 259);
+
+    // Signals and the sink receive the same frames, the moved frames keep the data
+    QMutexLocker locker(&sink.mutex);
+    QCOMPARE(int(sink.videoFrames.size()), 165);
+    double pts = -1;
+    for (const auto &frame : sink.videoFrames) {
+        QVERIFY(frame);
+        QCOMPARE(frame.size(), QSize(560, 320));
+        QVERIFY(frame.pts() > pts);
+        pts = frame.pts();
+    }
+    locker.unlock();
+
+    // Unsetting the sink while playing waits for the frame being passed to it
+    p.setSynced(true);
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_VERIFY(sink.audioCount > 259);
+    p.setFrameSink(nullptr);
+    QVERIFY(!p.frameSink());
+    const int count = sink.audioCount;
+    QTest::qWait(100);
+    QCOMPARE(int(sink.audioCount), count);
+    p.setSource({});
+}
+
+void tst_QAVPlayer::frameSinkBenchmark_data()
+{
+    QTest::addColumn<int>("connection");
+    QTest::newRow("direct signal") << int(Qt::DirectConnection);
+    QTest::newRow("queued signal") << int(Qt::QueuedConnection);
+    QTest::newRow("sink") << -1;
+}
+
+// Counts the frames without keeping them
+class CountingSink : public QAVFrameSink
+{
+public:
+    void videoFrame(const QAVVideoFrame &) override { ++count; }
+    std::atomic_int count{0};
+};
+
+void tst_QAVPlayer::frameSinkBenchmark()
+{
+    QFETCH(int, connection);
+
+    // Tiny frames at 240fps, so the delivery takes noticeable part of the time per frame
+    const int frames = 240 * 4;
+    CountingSink sink;
+    qint64 nsecs = 0;
+    QBENCHMARK {
+        QAVPlayer p;
+        sink.count = 0;
+        if (connection < 0)
+            p.setFrameSink(&sink);
+        else
+            QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++sink.count; }, Qt::ConnectionType(connection));
+        p.setSynced(false);
+        p.setInputFormat("lavfi");
+        QElapsedTimer timer;
+        timer.start();
+        p.setSource("testsrc=size=32x32:rate=240:duration=4");
+        p.play();
+        QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 20000);
+        QTRY_COMPARE(int(sink.count), frames);
+        nsecs = timer.nsecsElapsed();
+    }
+    qDebug() << "Per frame:" << nsecs / frames / 1000.0 << "us";
+}
+
+void tst_QAVPlayer::speedAudioTempo()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("test.wav"));
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    const int sampleRate = p.currentAudioStreams().first().stream()->codecpar->sample_rate;
+
+    QMutex mutex;
+    QList<int> rates;
+    qint64 samples = 0;
+    double lastPts = -1;
+    bool ordered = true;
+    bool seeking = false;
+    double seekedPts = -1;
+    QObject::connect(&p, &QAVPlayer::audioFrame, &p, [&](const QAVAudioFrame &f) {
+        QMutexLocker locker(&mutex);
+        if (!rates.contains(f.format().sampleRate()))
+            rates.push_back(f.format().sampleRate());
+        samples += f.frame()->nb_samples;
+        ordered = ordered && f.pts() >= lastPts;
+        lastPts = f.pts();
+        if (seeking && seekedPts < 0)
+            seekedPts = f.pts();
+    }, Qt::DirectConnection);
+
+    p.setSpeed(2.0);
+    p.play();
+    QTest::qWait(100);
+    // Changed on the fly
+    p.setSpeed(1.5);
+    QTest::qWait(100);
+    p.setSpeed(2.0);
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+
+    QMutexLocker locker(&mutex);
+    // The pitch and the sample rate are kept, the audio output is not recreated
+    QCOMPARE(rates, QList<int>{sampleRate});
+    QVERIFY(ordered);
+    // Pts stay in the media time
+    QVERIFY(lastPts > p.duration() / 1000.0 * 0.8);
+    // Fewer samples are played
+    const double played = double(samples) / sampleRate;
+    QVERIFY(played < p.duration() / 1000.0 * 0.8);
+    QVERIFY(played > p.duration() / 1000.0 * 0.3);
+    locker.unlock();
+
+    // The samples kept by atempo are sent at the end, so nothing is cut off
+    p.setSource({});
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(false);
+    p.setSpeed(2.0);
+    locker.relock();
+    samples = 0;
+    lastPts = -1;
+    locker.unlock();
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    const double duration = p.duration() / 1000.0;
+    auto playedMedia = [&] {
+        QMutexLocker l(&mutex);
+        return double(samples) / sampleRate * 2;
+    };
+    QTRY_VERIFY2(playedMedia() > duration - 0.01, qPrintable(QString::number(playedMedia())));
+    QVERIFY(playedMedia() < duration + 0.05);
+    locker.relock();
+    QVERIFY(ordered);
+    locker.unlock();
+
+    // Returning to the normal speed sends the stretched samples before the normal frames
+    p.setSource({});
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(true);
+    p.setSpeed(2.0);
+    locker.relock();
+    lastPts = -1;
+    locker.unlock();
+    p.play();
+    QTest::qWait(100);
+    p.setSpeed(1.0);
+    QTest::qWait(100);
+    p.stop();
+    locker.relock();
+    QVERIFY(ordered);
+    locker.unlock();
+
+    // The samples kept by atempo before the seek are dropped
+    p.setSource({});
+    p.setSource(file.absoluteFilePath());
+    p.setSpeed(2.0);
+    locker.relock();
+    lastPts = -1;
+    locker.unlock();
+    auto played = [&] {
+        QMutexLocker l(&mutex);
+        return lastPts;
+    };
+    QSignalSpy spyPaused(&p, &QAVPlayer::paused);
+    p.play();
+    QTRY_VERIFY(played() > 0.5);
+    p.pause();
+    QTRY_COMPARE(spyPaused.count(), 1);
+    locker.relock();
+    lastPts = -1;
+    seeking = true;
+    locker.unlock();
+    p.seek(100);
+    p.play();
+    QTRY_VERIFY(played() > 0.3);
+    locker.relock();
+    // The first frame after the seek is from the new position
+    QVERIFY2(seekedPts >= 0 && seekedPts < 0.2, qPrintable(QString::number(seekedPts)));
+    QVERIFY(ordered);
+}
+
+void tst_QAVPlayer::sharedDecoding()
+{
+    QAVPlayer p;
+    QVERIFY(!p.isSharedDecoding());
+    QSignalSpy spy(&p, &QAVPlayer::sharedDecodingChanged);
+
+    QFileInfo file(testData("colors.mp4"));
+    std::atomic_int framesCount{0};
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++framesCount; }, Qt::DirectConnection);
+    p.setSynced(false);
+
+    // Same frames from the own threads and from the shared scheduler
+    for (bool shared : {true, false}) {
+        p.setSharedDecoding(shared);
+        QCOMPARE(p.isSharedDecoding(), shared);
+        framesCount = 0;
+        p.setSource({});
+        p.setSource(file.absoluteFilePath());
+        p.play();
+        QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+        QTRY_COMPARE(int(framesCount), 375);
+    }
+    QCOMPARE(spy.count(), 2);
+}
+
 QTEST_MAIN(tst_QAVPlayer)
 #include "tst_qavplayer.moc"